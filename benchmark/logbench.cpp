@@ -0,0 +1,105 @@
+// 日志基准测试
+// 1. 调用耗时：单线程连续写一批日志（不超过缓冲区容量，写线程不参与），对比 LOG_INFO（延迟格式化）与 Log::write（调用线程格式化）
+//    以及低于运行时日志等级、被过滤掉的 LOG_DEBUG
+// 2. 吞吐：1/4/16 个线程同时写 LOG_INFO("Client[%d] in!", fd)，统计写日志线程每行的平均耗时
+//    以及 flush() 完成（全部写入文件）时 每行的平均耗时、缓冲区满丢弃的行数
+// 用法：./logbench [async|sync] [每个线程的行数] [日志目录]
+
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<vector>
+#include<thread>
+#include<chrono>
+
+#include"../code/log/log.h"
+
+
+typedef std::chrono::steady_clock Clock;
+
+static const int QUEUE_CAPACITY = 8192;     // 异步模式的队列容量（行数），同 WebServer 的 logQueSize 参数
+static const int BURST = 4096;              // 测调用耗时时 每批的行数，放得进一个线程的缓冲区
+static const int ROUNDS = 20;
+
+
+// 连续写 BURST 行，每批之间 flush()，返回每次调用的平均纳秒数（取各批的最小值）
+template<class Fn>
+static double callCost(Fn fn)
+{
+    double best = 1e18;
+    for (int r = 0; r < ROUNDS; ++r) {
+        Log::instance()->flush();
+
+        Clock::time_point start = Clock::now();
+        for (int k = 0; k < BURST; ++k) {
+            fn(k);
+        }
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / BURST;
+        if (ns < best) {
+            best = ns;
+        }
+    }
+    return best;
+}
+
+
+int main(int argc, char* argv[])
+{
+    bool async = !(argc > 1 && strcmp(argv[1], "sync") == 0);
+    long lines = (argc > 2) ? atol(argv[2]) : 200000;
+    const char* dir = (argc > 3) ? argv[3] : "/tmp/logbench";
+
+    Log* log = Log::instance();
+    log->init(1, dir, ".log", async ? QUEUE_CAPACITY : 0);
+
+    printf("mode: %s, lines per thread: %ld, log dir: %s\n\n", async ? "async" : "sync", lines, dir);
+
+    printf("%-44s %10s\n", "call", "ns/call");
+    printf("%-44s %10.1f\n", "LOG_INFO(\"Client[%d] in!\", fd)", callCost([](int k) {
+        LOG_INFO("Client[%d] in!", k);
+    }));
+    printf("%-44s %10.1f\n", "LOG_INFO(\"Client[%d](%s:%d) in\", ...)", callCost([](int k) {
+        LOG_INFO("Client[%d](%s:%d) in, UserCount:%d", k, "127.0.0.1", 40000 + k, 10);
+    }));
+    printf("%-44s %10.1f\n", "Log::write(\"Client[%d] in!\", fd)", callCost([log](int k) {
+        log->write(1, "Client[%d] in!", k);
+    }));
+    printf("%-44s %10.1f\n", "LOG_DEBUG (below the runtime level)", callCost([](int k) {
+        LOG_DEBUG("Client[%d] in!", k);
+    }));
+    printf("\n");
+
+    printf("%8s %14s %14s %10s\n", "threads", "write ns/line", "flush ns/line", "dropped");
+
+    for (int threads : { 1, 4, 16 }) {
+        size_t droppedBefore = log->droppedLines();
+        Clock::time_point start = Clock::now();
+
+        std::vector<std::thread> ts;
+        std::vector<double> writeNs(threads);
+        for (int i = 0; i < threads; ++i) {
+            ts.emplace_back([&writeNs, i, lines] {
+                Clock::time_point begin = Clock::now();
+                for (long k = 0; k < lines; ++k) {
+                    LOG_INFO("Client[%d] in!", static_cast<int>(k & 1023));
+                }
+                writeNs[i] = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+            });
+        }
+        for (std::thread& t : ts) {
+            t.join();
+        }
+
+        log->flush();
+        double totalNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+        double sum = 0;
+        for (double ns : writeNs) {
+            sum += ns;
+        }
+        printf("%8d %14.1f %14.1f %10zu\n", threads, sum / threads / lines,
+               totalNs / (threads * lines), log->droppedLines() - droppedBefore);
+    }
+
+    return 0;
+}
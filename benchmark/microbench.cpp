@@ -0,0 +1,581 @@
+// 组件微基准测试：Buffer、HttpRequest::parse、HeapTimer、日志缓冲区、ThreadPool、HttpResponse::makeResponse
+// 每项测试运行 RUNS 次，取中位数与最小值（纳秒/次），结果可写入 JSON 文件，并与保存的基线结果对比
+// 用法：./microbench [-o 结果.json] [-b 基线.json] [名称前缀]
+//   在仓库根目录或 benchmark 目录下运行（makeResponse 需要 resources 目录）
+//   例：./microbench -o base.json 保存基线，修改代码后 ./microbench -b base.json 对比；./microbench http. 只运行解析测试
+
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<string>
+#include<vector>
+#include<map>
+#include<thread>
+#include<atomic>
+#include<chrono>
+#include<random>
+#include<algorithm>
+#include<functional>
+#include<getopt.h>
+#include<sys/socket.h>
+#include<sys/stat.h>
+
+#include"../code/buffer/buffer.h"
+#include"../code/http/httprequest.h"
+#include"../code/http/httpresponse.h"
+#include"../code/http/filecache.h"
+#include"../code/timer/heaptimer.h"
+#include"../code/log/log.h"
+#include"../code/pool/threadpool.hpp"
+
+
+typedef std::chrono::steady_clock SteadyClock;
+
+static const int RUNS = 7;
+
+
+static double elapsedNs(const SteadyClock::time_point& start)
+{
+    return std::chrono::duration<double, std::nano>(SteadyClock::now() - start).count();
+}
+
+
+// 一项测试：运行一次，返回每次操作的平均纳秒数
+struct benchCase {
+    std::string name;
+    std::function<double()> run;
+};
+
+
+struct benchResult {
+    std::string name;
+    double medianNs;
+    double minNs;
+};
+
+
+/* ---------------- Buffer ---------------- */
+
+// 追加 64 字节后全部取走：读写位置不断后移，写满时 makeSpace_ 把（空的）可读数据移到开头
+static double bufferAppend()
+{
+    const int N = 1000000;
+    char data[64];
+    memset(data, 'a', sizeof(data));
+
+    Buffer buff(4096);
+    SteadyClock::time_point start = SteadyClock::now();
+    for (int i = 0; i < N; ++i) {
+        buff.append(data, sizeof(data));
+        buff.retrieve(sizeof(data));
+    }
+    return elapsedNs(start) / N;
+}
+
+
+// 缓冲区中始终有 2KB 未读数据，每次追加、取走 1KB：每两次追加 makeSpace_ 整理一次（移动 2KB）
+static double bufferCompact()
+{
+    const int N = 200000;
+    char data[1024];
+    memset(data, 'a', sizeof(data));
+
+    Buffer buff(4096);
+    buff.append(data, sizeof(data));
+    buff.append(data, sizeof(data));
+
+    SteadyClock::time_point start = SteadyClock::now();
+    for (int i = 0; i < N; ++i) {
+        buff.append(data, sizeof(data));
+        buff.retrieve(sizeof(data));
+    }
+    return elapsedNs(start) / N;
+}
+
+
+// 从默认大小（1KB）开始 分 64 次追加 16KB 的响应，makeSpace_ 多次扩容
+static double bufferGrow()
+{
+    const int N = 20000;
+    char data[256];
+    memset(data, 'a', sizeof(data));
+
+    SteadyClock::time_point start = SteadyClock::now();
+    for (int i = 0; i < N; ++i) {
+        Buffer buff;
+        for (int k = 0; k < 64; ++k) {
+            buff.append(data, sizeof(data));
+        }
+    }
+    return elapsedNs(start) / N;
+}
+
+
+// 从 socket 读取 len 字节：只统计 readFd 的耗时，写入与清空缓冲区不计时
+static double bufferReadFd(size_t len)
+{
+    const int N = 20000;
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        return 0;
+    }
+    int size = 1 << 20;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+    std::string data(len, 'a');
+    Buffer buff;
+    int err = 0;
+    double total = 0;
+
+    for (int i = 0; i < N; ++i) {
+        if (write(fds[0], data.data(), len) != static_cast<ssize_t>(len)) {
+            break;
+        }
+        SteadyClock::time_point start = SteadyClock::now();
+        buff.readFd(fds[1], &err);
+        total += elapsedNs(start);
+        buff.retrieve(buff.readableBytes());
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+    return total / N;
+}
+
+
+/* ---------------- HttpRequest::parse ---------------- */
+
+// curl 发出的最简请求
+static const std::string REQ_CURL =
+    "GET /index.html HTTP/1.1\r\n"
+    "Host: 127.0.0.1:12345\r\n"
+    "User-Agent: curl/7.81.0\r\n"
+    "Accept: */*\r\n"
+    "\r\n";
+
+// 浏览器发出的请求
+static const std::string REQ_BROWSER =
+    "GET /picture HTTP/1.1\r\n"
+    "Host: 127.0.0.1:12345\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "sec-ch-ua: \"Chromium\";v=\"118\", \"Google Chrome\";v=\"118\", \"Not=A?Brand\";v=\"99\"\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "sec-ch-ua-platform: \"Linux\"\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/118.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,image/apng,*/*;q=0.8\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Sec-Fetch-Mode: navigate\r\n"
+    "Sec-Fetch-User: ?1\r\n"
+    "Sec-Fetch-Dest: document\r\n"
+    "Referer: http://127.0.0.1:12345/\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "\r\n";
+
+// 表单 POST（路径不是登录/注册，不访问数据库），包含 url 解码
+static const std::string REQ_POST =
+    "POST /search HTTP/1.1\r\n"
+    "Host: 127.0.0.1:12345\r\n"
+    "Connection: keep-alive\r\n"
+    "Content-Type: application/x-www-form-urlencoded\r\n"
+    "Content-Length: 57\r\n"
+    "\r\n"
+    "username=%E6%B5%8B%E8%AF%95+user&password=p%40ss&remember=1";
+
+
+// 每次追加一个请求 并解析；pieces > 1 时请求分 pieces 次到达，每次到达都解析一次
+static double parseRequest(const std::string& req, int pieces)
+{
+    const int N = 200000;
+    Buffer buff;
+    Arena arena;
+    HttpRequest request(&arena);
+    size_t step = (req.size() + pieces - 1) / pieces;
+
+    SteadyClock::time_point start = SteadyClock::now();
+    for (int i = 0; i < N; ++i) {
+        request.init();
+        HttpRequest::PARSE_RESULT res = HttpRequest::PARSE_AGAIN;
+        for (size_t off = 0; off < req.size(); off += step) {
+            buff.append(req.data() + off, std::min(step, req.size() - off));
+            res = request.parse(buff);
+        }
+        if (res != HttpRequest::PARSE_OK) {     // 语料有误
+            return 0;
+        }
+    }
+    return elapsedNs(start) / N;
+}
+
+
+// 一次到达 depth 个流水线请求，依次解析
+static double parsePipelined(const std::string& req, int depth)
+{
+    const int N = 200000 / depth;
+    std::string batch;
+    for (int k = 0; k < depth; ++k) {
+        batch += req;
+    }
+
+    Buffer buff;
+    Arena arena;
+    HttpRequest request(&arena);
+
+    SteadyClock::time_point start = SteadyClock::now();
+    for (int i = 0; i < N; ++i) {
+        buff.append(batch);
+        for (int k = 0; k < depth; ++k) {
+            request.init();
+            if (request.parse(buff) != HttpRequest::PARSE_OK) {
+                return 0;
+            }
+        }
+    }
+    return elapsedNs(start) / (N * depth);
+}
+
+
+/* ---------------- HeapTimer ---------------- */
+
+static const int TIMERS = 10000;
+static const int TIMEOUT_MS = 60000;
+
+
+// 添加 TIMERS 个定时器（空闲连接）
+static double timerAdd()
+{
+    HeapTimer timer;
+    SteadyClock::time_point start = SteadyClock::now();
+    for (int i = 0; i < TIMERS; ++i) {
+        timer.add(i, TIMEOUT_MS, [] {});
+    }
+    return elapsedNs(start) / TIMERS;
+}
+
+
+// 按随机顺序刷新定时器（连接上的读写事件）
+static double timerAdjust()
+{
+    HeapTimer timer;
+    for (int i = 0; i < TIMERS; ++i) {
+        timer.add(i, TIMEOUT_MS, [] {});
+    }
+
+    std::vector<int> ids(TIMERS * 10);
+    std::mt19937 rng(TIMERS);
+    for (int& id : ids) {
+        id = rng() % TIMERS;
+    }
+
+    SteadyClock::time_point start = SteadyClock::now();
+    for (int id : ids) {
+        timer.adjust(id, TIMEOUT_MS);
+    }
+    return elapsedNs(start) / ids.size();
+}
+
+
+// tick 处理 TIMERS 个已到期的定时器，每个的耗时
+static double timerTick()
+{
+    HeapTimer timer;
+    int fired = 0;
+    for (int i = 0; i < TIMERS; ++i) {
+        timer.add(i, 0, [&fired] { ++fired; });
+    }
+
+    SteadyClock::time_point start = SteadyClock::now();
+    timer.tick();
+    double ns = elapsedNs(start);
+    return fired == TIMERS ? ns / TIMERS : 0;
+}
+
+
+/* ---------------- 日志缓冲区 ---------------- */
+
+// threads 个线程同时写 LOG_INFO，每个线程写一批（放得进本线程的缓冲区，写线程不参与），每次调用的耗时
+// 原先的 BlockDeque 已换成每个线程一个的无锁环形缓冲区，这里测它的写入
+static double logPush(int threads)
+{
+    const int BURST = 4096;
+    Log::instance()->flush();
+
+    std::vector<std::thread> ts;
+    std::vector<double> ns(threads);
+    for (int t = 0; t < threads; ++t) {
+        ts.emplace_back([&ns, t] {
+            SteadyClock::time_point start = SteadyClock::now();
+            for (int k = 0; k < BURST; ++k) {
+                LOG_INFO("Client[%d] in!", k);
+            }
+            ns[t] = elapsedNs(start);
+        });
+    }
+    for (std::thread& t : ts) {
+        t.join();
+    }
+
+    double sum = 0;
+    for (double v : ns) {
+        sum += v;
+    }
+    return sum / (threads * BURST);
+}
+
+
+/* ---------------- ThreadPool ---------------- */
+
+static const int TASKS = 200000;
+
+
+// 提交 TASKS 个空任务，addTask 每次调用的耗时
+static double poolAddTask(ThreadPool& pool)
+{
+    std::atomic<int> done(0);
+    SteadyClock::time_point start = SteadyClock::now();
+    for (int i = 0; i < TASKS; ++i) {
+        pool.addTask([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+    }
+    double ns = elapsedNs(start);
+
+    while (done.load() < TASKS) {
+        std::this_thread::yield();
+    }
+    return ns / TASKS;
+}
+
+
+// 提交 TASKS 个空任务 到全部完成，每个任务的耗时
+static double poolDrain(ThreadPool& pool)
+{
+    std::atomic<int> done(0);
+    SteadyClock::time_point start = SteadyClock::now();
+    for (int i = 0; i < TASKS; ++i) {
+        pool.addTask([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+    }
+    while (done.load() < TASKS) {
+        std::this_thread::yield();
+    }
+    return elapsedNs(start) / TASKS;
+}
+
+
+/* ---------------- HttpResponse::makeResponse ---------------- */
+
+// 生成 path 的响应（状态行、响应头；小文件的内容由 HttpConn 用 writev 发送，不在计时内）
+static double makeResponse(const std::string& srcDir, const std::string& path, size_t cacheBudget)
+{
+    const int N = 100000;
+    FileCache::instance()->init(cacheBudget);
+
+    Buffer buff;
+    Arena arena;
+    HttpResponse response(&arena);
+
+    SteadyClock::time_point start = SteadyClock::now();
+    for (int i = 0; i < N; ++i) {
+        arena.reset();          // 同 HttpConn：开始处理下一个请求时回收
+        response.init(srcDir, path, true);
+        response.makeResponse(buff);
+        buff.retrieve(buff.readableBytes());
+    }
+    double ns = elapsedNs(start) / N;
+
+    response.unmapFile();
+    FileCache::instance()->init(0);
+    return ns;
+}
+
+
+// 生成正文由服务器给出的响应（如 /__metrics）
+static double makeResponseBody()
+{
+    const int N = 200000;
+    std::string body(1024, 'a');
+    Buffer buff;
+    Arena arena;
+    HttpResponse response(&arena);
+
+    SteadyClock::time_point start = SteadyClock::now();
+    for (int i = 0; i < N; ++i) {
+        arena.reset();
+        response.init(".", "/__metrics", true);
+        response.makeResponse(buff, body);
+        buff.retrieve(buff.readableBytes());
+    }
+    return elapsedNs(start) / N;
+}
+
+
+// resources 目录：在仓库根目录 或 benchmark 目录下运行
+static std::string findResources()
+{
+    struct stat st;
+    for (const char* dir : { "resources", "../resources" }) {
+        if (stat(dir, &st) == 0 && S_ISDIR(st.st_mode)) {
+            return dir;
+        }
+    }
+    return "";
+}
+
+
+/* ---------------- 运行、输出 ---------------- */
+
+// 运行 RUNS 次（先预热一次），返回中位数与最小值
+static benchResult runCase(const benchCase& c)
+{
+    c.run();
+
+    std::vector<double> ns;
+    for (int r = 0; r < RUNS; ++r) {
+        ns.push_back(c.run());
+    }
+    std::sort(ns.begin(), ns.end());
+    return { c.name, ns[RUNS / 2], ns[0] };
+}
+
+
+// 一行一个结果，便于读取基线
+static bool writeJson(const char* file, const std::vector<benchResult>& results)
+{
+    FILE* fp = fopen(file, "w");
+    if (!fp) {
+        return false;
+    }
+
+    fprintf(fp, "{\n  \"unit\": \"ns/op\",\n  \"runs\": %d,\n  \"benchmarks\": [\n", RUNS);
+    for (size_t i = 0; i < results.size(); ++i) {
+        fprintf(fp, "    {\"name\": \"%s\", \"median\": %.2f, \"min\": %.2f}%s\n", results[i].name.c_str(),
+                results[i].medianNs, results[i].minNs, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+    return true;
+}
+
+
+// 读取 writeJson 写出的基线：名称 To 中位数
+static std::map<std::string, double> readJson(const char* file)
+{
+    std::map<std::string, double> baseline;
+    FILE* fp = fopen(file, "r");
+    if (!fp) {
+        return baseline;
+    }
+
+    char line[512];
+    char name[256];
+    double median = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, " {\"name\": \"%255[^\"]\", \"median\": %lf", name, &median) == 2) {
+            baseline[name] = median;
+        }
+    }
+    fclose(fp);
+    return baseline;
+}
+
+
+int main(int argc, char* argv[])
+{
+    const char* outFile = nullptr;
+    const char* baseFile = nullptr;
+
+    int ch;
+    while ((ch = getopt(argc, argv, "o:b:h")) != -1) {
+        switch (ch) {
+        case 'o': outFile = optarg; break;
+        case 'b': baseFile = optarg; break;
+        default:
+            fprintf(stderr, "usage: %s [-o result.json] [-b baseline.json] [name prefix]\n", argv[0]);
+            return 1;
+        }
+    }
+    const char* prefix = (optind < argc) ? argv[optind] : "";
+
+    std::map<std::string, double> baseline;
+    if (baseFile) {
+        baseline = readJson(baseFile);
+        if (baseline.empty()) {
+            fprintf(stderr, "cannot read baseline: %s\n", baseFile);
+            return 1;
+        }
+    }
+
+    // 异步日志，等级 1：LOG_DEBUG 被过滤，LOG_INFO 写入缓冲区
+    Log::instance()->init(1, "/tmp/microbench-log", ".log", 8192);
+
+    std::string srcDir = findResources();
+    ThreadPool pool(4);
+
+    std::vector<benchCase> cases = {
+        { "buffer.append.64B", bufferAppend },
+        { "buffer.makeSpace.compact", bufferCompact },
+        { "buffer.makeSpace.grow16KB", bufferGrow },
+        { "buffer.readFd.1KB", [] { return bufferReadFd(1024); } },
+        { "buffer.readFd.16KB", [] { return bufferReadFd(16384); } },
+
+        { "http.parse.curl", [] { return parseRequest(REQ_CURL, 1); } },
+        { "http.parse.browser", [] { return parseRequest(REQ_BROWSER, 1); } },
+        { "http.parse.browser.split3", [] { return parseRequest(REQ_BROWSER, 3); } },
+        { "http.parse.browser.pipeline8", [] { return parsePipelined(REQ_BROWSER, 8); } },
+        { "http.parse.post.urlencoded", [] { return parseRequest(REQ_POST, 1); } },
+
+        { "timer.heap.add", timerAdd },
+        { "timer.heap.adjust", timerAdjust },
+        { "timer.heap.tick", timerTick },
+
+        { "log.push.1thread", [] { return logPush(1); } },
+        { "log.push.4threads", [] { return logPush(4); } },
+
+        { "pool.addTask", [&pool] { return poolAddTask(pool); } },
+        { "pool.drain", [&pool] { return poolDrain(pool); } },
+
+        { "response.makeResponse.body1KB", makeResponseBody },
+    };
+    if (!srcDir.empty()) {
+        cases.push_back({ "response.makeResponse.cached", [srcDir] { return makeResponse(srcDir, "/index.html", 64 << 20); } });
+        cases.push_back({ "response.makeResponse.mmap", [srcDir] { return makeResponse(srcDir, "/index.html", 0); } });
+        cases.push_back({ "response.makeResponse.404", [srcDir] { return makeResponse(srcDir, "/nonexistent", 64 << 20); } });
+    }
+    else {
+        fprintf(stderr, "resources not found, skipping file responses (run from the repository or benchmark directory)\n");
+    }
+
+    if (baseFile) {
+        printf("%-34s %12s %12s %12s %9s\n", "benchmark", "median ns", "min ns", "baseline", "change");
+    }
+    else {
+        printf("%-34s %12s %12s\n", "benchmark", "median ns", "min ns");
+    }
+
+    std::vector<benchResult> results;
+    for (const benchCase& c : cases) {
+        if (c.name.compare(0, strlen(prefix), prefix) != 0) {
+            continue;
+        }
+
+        benchResult res = runCase(c);
+        results.push_back(res);
+
+        if (baseFile && baseline.count(res.name)) {
+            double base = baseline[res.name];
+            printf("%-34s %12.1f %12.1f %12.1f %+8.1f%%\n", res.name.c_str(), res.medianNs, res.minNs,
+                   base, (res.medianNs / base - 1) * 100);
+        }
+        else {
+            printf("%-34s %12.1f %12.1f\n", res.name.c_str(), res.medianNs, res.minNs);
+        }
+        fflush(stdout);
+    }
+
+    if (outFile && !writeJson(outFile, results)) {
+        fprintf(stderr, "cannot write %s\n", outFile);
+        return 1;
+    }
+    return 0;
+}
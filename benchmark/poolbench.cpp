@@ -0,0 +1,78 @@
+// 线程池基准测试：原先的单锁单队列线程池 与 工作窃取线程池 在 4/16/64 个工作线程下
+// 1 个（单 Reactor 的事件循环）或 4 个生产者线程 连续提交小任务，统计每个任务的平均耗时
+
+#include<cstdio>
+#include<cstdlib>
+#include<vector>
+#include<thread>
+#include<chrono>
+#include<atomic>
+#include<functional>
+
+#include"../code/pool/threadpool.hpp"
+#include"mutexpool.hpp"
+
+
+typedef std::chrono::steady_clock Clock;
+
+static const int TASK_SPIN = 50;        // 每个任务的计算量（空循环次数），模拟一次很短的读写处理
+
+
+// 任务：少量计算后 完成计数加一
+static void work(std::atomic<long>* done)
+{
+    for (volatile int i = 0; i < TASK_SPIN; i = i + 1) {
+    }
+    done->fetch_add(1, std::memory_order_relaxed);
+}
+
+
+// producers 个线程 共提交 tasks 个任务，返回 从开始提交 到全部完成 每个任务的平均纳秒数
+template<class Pool>
+static double runBench(int threads, int producers, long tasks)
+{
+    Pool pool(threads);
+    std::atomic<long> done(0);
+
+    Clock::time_point start = Clock::now();
+
+    std::vector<std::thread> ps;
+    for (int p = 0; p < producers; ++p) {
+        ps.emplace_back([&pool, &done, producers, tasks, p] {
+            long n = tasks / producers + (p < tasks % producers ? 1 : 0);
+            for (long i = 0; i < n; ++i) {
+                pool.addTask(std::bind(work, &done));
+            }
+        });
+    }
+    for (std::thread& t : ps) {
+        t.join();
+    }
+
+    while (done.load() < tasks) {
+        std::this_thread::yield();
+    }
+
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / tasks;
+}
+
+
+int main(int argc, char* argv[])
+{
+    long tasks = (argc > 1) ? atol(argv[1]) : 1000000;
+
+    printf("tasks: %ld, cpus: %u\n\n", tasks, std::thread::hardware_concurrency());
+    printf("%8s %10s %18s %12s %12s\n", "threads", "producers", "pool", "ns/task", "Mtasks/s");
+
+    for (int threads : { 4, 16, 64 }) {
+        for (int producers : { 1, 4 }) {
+            double ns = runBench<MutexThreadPool>(threads, producers, tasks);
+            printf("%8d %10d %18s %12.1f %12.2f\n", threads, producers, "mutex-queue", ns, 1e3 / ns);
+
+            ns = runBench<ThreadPool>(threads, producers, tasks);
+            printf("%8d %10d %18s %12.1f %12.2f\n", threads, producers, "work-stealing", ns, 1e3 / ns);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,412 @@
+
+// 请求报文分帧基准测试：找到请求头结束位置，并把每一行切分为 key/value
+// 1. 一次收完整个请求：对比 逐字节 search + 按行拷贝（最初的做法）、逐行 memchr（HttpRequest::parse 的做法）、
+//    手写 SSE2/AVX2 一次扫描同时找 ':' 和换行符
+// 2. 请求分多次到达：对比 每次从行首重新扫描 与 记下已扫描位置继续扫描（HttpRequest::parse 的做法）
+
+#include<cstdio>
+#include<cstring>
+#include<string>
+#include<vector>
+#include<algorithm>
+#include<chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SCAN_X86
+#include<immintrin.h>
+#endif
+
+
+using Clock = std::chrono::steady_clock;
+
+static const int MIN_ROUNDS = 2000;         // 每种请求 每种方法至少重复的次数
+static const double MIN_TIME_NS = 2e8;      // 每种方法至少运行的时间
+
+
+// 在 [begin, end) 中查找 字符 a 或 字符 b 第一次出现的位置，找不到返回 nullptr
+
+static const char* findEitherGeneric(const char* begin, const char* end, char a, char b)
+{
+    for (const char* p = begin; p < end; ++p) {
+        if (*p == a || *p == b) {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+
+#ifdef SCAN_X86
+
+// SSE2 实现，每次比较 16 字节；不足 16 字节时 与前面已比较过的字节重叠加载最后 16 字节
+// 强制内联：AVX2 实现的剩余部分调用它时 按 VEX 编码生成，避免 SSE/AVX 切换的开销
+__attribute__((always_inline))
+static inline const char* findEitherSse2(const char* begin, const char* end, char a, char b)
+{
+    if (end - begin < 16) {
+        return findEitherGeneric(begin, end, a, b);
+    }
+
+    const __m128i targetA = _mm_set1_epi8(a);
+    const __m128i targetB = _mm_set1_epi8(b);
+
+    const char* p = begin;
+    for (;; p += 16) {
+        int skip = 0;
+        if (p + 16 > end) {
+            if (p >= end) {
+                return nullptr;
+            }
+            skip = p - (end - 16);      // 重叠部分已比较过，跳过
+            p = end - 16;
+        }
+
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i eq = _mm_or_si128(_mm_cmpeq_epi8(chunk, targetA), _mm_cmpeq_epi8(chunk, targetB));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(eq)) >> skip;
+        if (mask) {
+            return p + skip + __builtin_ctz(mask);
+        }
+    }
+}
+
+
+static const char* findEitherSse2Entry(const char* begin, const char* end, char a, char b)
+{
+    return findEitherSse2(begin, end, a, b);
+}
+
+
+// AVX2 实现，每次比较 32 字节，剩余部分交给 SSE2 实现
+__attribute__((target("avx2")))
+static const char* findEitherAvx2(const char* begin, const char* end, char a, char b)
+{
+    const __m256i targetA = _mm256_set1_epi8(a);
+    const __m256i targetB = _mm256_set1_epi8(b);
+
+    const char* p = begin;
+    for (; p + 32 <= end; p += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i eq = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, targetA), _mm256_cmpeq_epi8(chunk, targetB));
+        unsigned mask = _mm256_movemask_epi8(eq);
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findEitherSse2(p, end, a, b);
+}
+
+#endif  // SCAN_X86
+
+
+typedef const char* (*findEitherFunc)(const char*, const char*, char, char);
+static findEitherFunc findEither = findEitherGeneric;
+
+
+// 分帧结果，用于校验各方法结果一致
+struct frameResult {
+    size_t headerNum;
+    size_t keyBytes;
+    size_t headEnd;
+};
+
+
+// 原先的做法：std::search 逐字节找 CRLF，每行拷贝成 string 再找 ':'
+static frameResult frameSearch(const char* begin, const char* end)
+{
+    const char CRLF[] = "\r\n";
+    frameResult res = { 0, 0, 0 };
+
+    const char* p = begin;
+    bool first = true;
+    while (p < end) {
+        const char* lineEnd = std::search(p, end, CRLF, CRLF + 2);
+        if (lineEnd == end) {
+            break;
+        }
+
+        std::string line(p, lineEnd);
+        p = lineEnd + 2;
+        if (line.empty()) {
+            res.headEnd = p - begin;
+            break;
+        }
+        if (first) {
+            first = false;
+            continue;
+        }
+
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            ++res.headerNum;
+            res.keyBytes += colon;
+        }
+    }
+
+    return res;
+}
+
+
+// 逐行 memchr 找换行符，再在行内 memchr 找 ':'（与 HttpRequest::parse 相同）
+static frameResult frameMemchr(const char* begin, const char* end)
+{
+    frameResult res = { 0, 0, 0 };
+
+    const char* p = begin;
+    bool first = true;
+    while (p < end) {
+        const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (!lineEnd) {
+            break;
+        }
+
+        const char* line = p;
+        const char* stop = (lineEnd > p && lineEnd[-1] == '\r') ? lineEnd - 1 : lineEnd;
+        p = lineEnd + 1;
+        if (stop == line) {
+            res.headEnd = p - begin;
+            break;
+        }
+        if (first) {
+            first = false;
+            continue;
+        }
+
+        const char* colon = static_cast<const char*>(memchr(line, ':', stop - line));
+        if (colon) {
+            ++res.headerNum;
+            res.keyBytes += colon - line;
+        }
+    }
+
+    return res;
+}
+
+
+// 逐行 一次扫描同时找到 ':' 和换行符，再 memchr 找本行剩余部分的换行符
+static frameResult frameScanner(const char* begin, const char* end)
+{
+    frameResult res = { 0, 0, 0 };
+
+    const char* p = static_cast<const char*>(memchr(begin, '\n', end - begin));   // 跳过请求行
+    if (!p) {
+        return res;
+    }
+    ++p;
+
+    while (p < end) {
+        const char* line = p;
+        const char* hit = findEither(p, end, ':', '\n');
+        if (!hit) {
+            break;
+        }
+
+        if (*hit == ':') {
+            ++res.headerNum;
+            res.keyBytes += hit - line;
+            hit = static_cast<const char*>(memchr(hit + 1, '\n', end - hit - 1));
+            if (!hit) {
+                break;
+            }
+        }
+        else if (hit == line || (hit == line + 1 && *line == '\r')) {     // 空行
+            res.headEnd = hit + 1 - begin;
+            break;
+        }
+        p = hit + 1;
+    }
+
+    return res;
+}
+
+
+// 请求每次到达 chunk 字节，每次到达后 解析已收到的完整行（同 HttpRequest::parse）
+// resume 为 false 时 每次从未处理完的行首重新找换行符；为 true 时 从上次扫描到的位置继续
+static frameResult frameIncremental(const char* begin, const char* end, size_t chunk, bool resume)
+{
+    frameResult res = { 0, 0, 0 };
+
+    size_t total = end - begin;
+    size_t pos = 0, scan = 0;
+    bool first = true;
+    for (size_t readable = std::min(chunk, total); ; readable = std::min(readable + chunk, total)) {
+        while (true) {
+            size_t from = resume ? scan : pos;
+            const char* lineEnd = static_cast<const char*>(memchr(begin + from, '\n', readable - from));
+            if (!lineEnd) {
+                scan = readable;
+                break;
+            }
+
+            const char* line = begin + pos;
+            const char* stop = (lineEnd > line && lineEnd[-1] == '\r') ? lineEnd - 1 : lineEnd;
+            pos = scan = lineEnd + 1 - begin;
+            if (stop == line) {
+                res.headEnd = pos;
+                return res;
+            }
+            if (first) {
+                first = false;
+                continue;
+            }
+
+            const char* colon = static_cast<const char*>(memchr(line, ':', stop - line));
+            if (colon) {
+                ++res.headerNum;
+                res.keyBytes += colon - line;
+            }
+        }
+
+        if (readable == total) {
+            break;
+        }
+    }
+
+    return res;
+}
+
+
+// 构造请求：cookieLen 为 Cookie 请求头的长度，extraHeaders 为额外请求头的数量
+static std::string makeRequest(size_t cookieLen, int extraHeaders)
+{
+    std::string req = "GET /images/profile-photo.jpg?size=large HTTP/1.1\r\n"
+                      "Host: 127.0.0.1:12345\r\n"
+                      "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+                      "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+                      "Accept-Encoding: gzip, deflate, br\r\n"
+                      "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+                      "Connection: keep-alive\r\n";
+
+    for (int i = 0; i < extraHeaders; ++i) {
+        req += "X-Custom-Header-" + std::to_string(i) + ": value-" + std::to_string(i * 7919) + "\r\n";
+    }
+
+    if (cookieLen > 0) {
+        req += "Cookie: ";
+        for (int i = 0; req.size() < cookieLen + 200; ++i) {
+            req += "session_token_" + std::to_string(i) + "=a8f5f167f44f4964e6c998dee827110c; ";
+        }
+        req += "\r\n";
+    }
+
+    req += "\r\n";
+    return req;
+}
+
+
+// 返回 frame 处理一次 req 的平均纳秒数
+template<class Frame>
+static double timeIt(Frame frame, const std::string& req, frameResult* out)
+{
+    const char* begin = req.data();
+    const char* end = begin + req.size();
+
+    size_t sink = 0;
+    long rounds = 0;
+    Clock::time_point start = Clock::now();
+    double elapsed = 0;
+    while (rounds < MIN_ROUNDS || elapsed < MIN_TIME_NS) {
+        for (int i = 0; i < 100; ++i) {
+            // 让编译器认为输入每次都可能不同，避免 memchr 等纯函数被提到循环外
+            __asm__ __volatile__("" : "+r"(begin), "+r"(end));
+            frameResult r = frame(begin, end);
+            sink += r.headerNum;
+            *out = r;
+        }
+        rounds += 100;
+        elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    if (sink == 0) {
+        printf(" ");    // 防止被优化掉
+    }
+    return elapsed / rounds;
+}
+
+
+static bool sameResult(const frameResult& a, const frameResult& b)
+{
+    return a.headerNum == b.headerNum && a.keyBytes == b.keyBytes && a.headEnd == b.headEnd;
+}
+
+
+int main()
+{
+    struct testCase {
+        const char* name;
+        std::string req;
+    };
+    std::vector<testCase> cases = {
+        { "small", "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: keep-alive\r\n\r\n" },
+        { "browser", makeRequest(0, 0) },
+        { "cookie-4k", makeRequest(4096, 20) },
+        { "cookie-16k", makeRequest(16384, 40) },
+    };
+
+    struct scanner {
+        const char* name;
+        findEitherFunc func;
+        bool supported;
+    };
+    std::vector<scanner> scanners = {
+        { "either-generic", findEitherGeneric, true },
+#ifdef SCAN_X86
+        { "either-sse2", findEitherSse2Entry, static_cast<bool>(__builtin_cpu_supports("sse2")) },
+        { "either-avx2", findEitherAvx2, static_cast<bool>(__builtin_cpu_supports("avx2")) },
+#endif
+    };
+
+    printf("== whole request in buffer ==\n");
+    printf("%-12s %8s %-16s %12s %10s\n", "request", "bytes", "method", "ns/request", "GB/s");
+    for (const testCase& tc : cases) {
+        frameResult expect;
+        double base = timeIt(frameSearch, tc.req, &expect);
+        printf("%-12s %8zu %-16s %12.1f %10.2f\n", tc.name, tc.req.size(), "search+copy", base, tc.req.size() / base);
+
+        frameResult res;
+        double ns = timeIt(frameMemchr, tc.req, &res);
+        printf("%-12s %8zu %-16s %12.1f %10.2f\n", tc.name, tc.req.size(), "memchr", ns, tc.req.size() / ns);
+        if (!sameResult(res, expect)) {
+            printf("memchr result mismatch!\n");
+            return 1;
+        }
+
+        for (const scanner& sc : scanners) {
+            if (!sc.supported) {
+                continue;
+            }
+
+            findEither = sc.func;
+            ns = timeIt(frameScanner, tc.req, &res);
+            printf("%-12s %8zu %-16s %12.1f %10.2f\n", tc.name, tc.req.size(), sc.name, ns, tc.req.size() / ns);
+            if (!sameResult(res, expect)) {
+                printf("%s result mismatch!\n", sc.name);
+                return 1;
+            }
+        }
+        printf("\n");
+    }
+
+    printf("== request arriving in chunks ==\n");
+    printf("%-12s %8s %-16s %12s %10s\n", "request", "chunk", "method", "ns/request", "GB/s");
+    const testCase& tc = cases.back();
+    for (size_t chunk : { 1460, 512, 64 }) {
+        frameResult expect;
+        timeIt(frameMemchr, tc.req, &expect);
+
+        for (bool resume : { false, true }) {
+            frameResult res;
+            double ns = timeIt([chunk, resume](const char* begin, const char* end) {
+                return frameIncremental(begin, end, chunk, resume);
+            }, tc.req, &res);
+            const char* name = resume ? "resume" : "rescan";
+            printf("%-12s %8zu %-16s %12.1f %10.2f\n", tc.name, chunk, name, ns, tc.req.size() / ns);
+            if (!sameResult(res, expect)) {
+                printf("%s result mismatch!\n", name);
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
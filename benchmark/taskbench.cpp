@@ -0,0 +1,97 @@
+// 任务分发的耗时：稳定运行时 每次提交并执行一个任务的平均耗时
+// 对比 原先的 std::function + std::bind（单锁单队列线程池）、Task + std::bind、Task 成员函数快速路径
+// 稳定运行时不分配内存 由 test/ 检查
+
+#include<cstdio>
+#include<cstdlib>
+#include<atomic>
+#include<thread>
+#include<chrono>
+#include<functional>
+
+#include"../code/pool/threadpool.hpp"
+#include"mutexpool.hpp"
+
+
+typedef std::chrono::steady_clock Clock;
+
+static const long WARMUP_TASKS = 100000;    // 预热：让任务队列扩容到稳定大小
+static const long MAX_INFLIGHT = 1024;      // 未完成任务数上限，模拟 Reactor 一轮事件的数量
+
+
+// 模拟 Reactor 与连接，onRead_ 即线程池要执行的操作
+struct conn {
+    int fd;
+};
+
+class reactor {
+public:
+    reactor() : done(0) {}
+
+    void onRead_(conn* client) {
+        if (client->fd >= 0) {
+            done.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<long> done;
+};
+
+
+// 用 submit(pool, r, client) 提交 tasks 个任务，返回预热之后的平均耗时（纳秒）
+template<class Pool, class Submit>
+static double runBench(int threads, long tasks, Submit submit)
+{
+    Pool pool(threads);
+    reactor r;
+    conn client = { 5 };
+
+    long submitted = 0;
+    auto run = [&](long n) {
+        for (long i = 0; i < n; ++i) {
+            while (submitted - r.done.load(std::memory_order_relaxed) >= MAX_INFLIGHT) {
+                std::this_thread::yield();
+            }
+            submit(pool, r, client);
+            ++submitted;
+        }
+        while (r.done.load() < submitted) {
+            std::this_thread::yield();
+        }
+    };
+
+    run(WARMUP_TASKS);
+
+    Clock::time_point start = Clock::now();
+    run(tasks);
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+    return ns / tasks;
+}
+
+
+int main(int argc, char* argv[])
+{
+    long tasks = (argc > 1) ? atol(argv[1]) : 1000000;
+    int threads = 4;
+
+    printf("tasks: %ld, threads: %d, Task capacity: %zu bytes\n\n", tasks, threads, Task::CAPACITY);
+    printf("%-36s %12s\n", "dispatch", "ns/task");
+
+    double ns = runBench<MutexThreadPool>(threads, tasks, [](MutexThreadPool& pool, reactor& r, conn& c) {
+        pool.addTask(std::bind(&reactor::onRead_, &r, &c));
+    });
+    printf("%-36s %12.1f\n", "mutex-queue std::function(bind)", ns);
+
+    ns = runBench<ThreadPool>(threads, tasks, [](ThreadPool& pool, reactor& r, conn& c) {
+        pool.addTask(std::bind(&reactor::onRead_, &r, &c));
+    });
+    printf("%-36s %12.1f\n", "work-stealing Task(bind)", ns);
+
+    ns = runBench<ThreadPool>(threads, tasks, [](ThreadPool& pool, reactor& r, conn& c) {
+        pool.addTask(&r, &reactor::onRead_, &c);
+    });
+    printf("%-36s %12.1f\n", "work-stealing Task(obj, method, arg)", ns);
+
+    return 0;
+}
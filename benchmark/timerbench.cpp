@@ -0,0 +1,111 @@
+
+// 定时器基准测试：HeapTimer 与 TimingWheel 在 1万/10万/100万 个定时器下的
+// add、adjust（每次读写事件都会调用）、到期处理 的平均耗时
+
+#include<cstdio>
+#include<cstdlib>
+#include<vector>
+#include<random>
+#include<thread>
+
+#include"../code/timer/heaptimer.h"
+#include"../code/timer/timingwheel.h"
+
+
+static const int TIMEOUT_MS = 60000;        // 与 main.cpp 中的 timeoutMs 相同
+static const int EXPIRE_SPAN_MS = 1000;     // 到期测试中 定时器到期时间的分布范围
+
+
+// 返回 从 start 到现在 经过的纳秒数
+static double elapsedNs(const timeStamp& start)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+
+struct benchResult {
+    double addNs;
+    double adjustNs;
+    double expireNs;
+};
+
+
+template<class Timer>
+static benchResult runBench(int n, const std::vector<int>& ids)
+{
+    benchResult res;
+    int fired = 0;
+    auto cb = [&fired]() { ++fired; };
+
+    // add：n 个空闲连接
+    {
+        Timer timer;
+        timeStamp start = Clock::now();
+        for (int i = 0; i < n; ++i) {
+            timer.add(i, TIMEOUT_MS, cb);
+        }
+        res.addNs = elapsedNs(start) / n;
+
+        // adjust：按随机顺序刷新，模拟连接上的读写事件
+        start = Clock::now();
+        for (size_t i = 0; i < ids.size(); ++i) {
+            timer.adjust(ids[i], TIMEOUT_MS);
+        }
+        res.adjustNs = elapsedNs(start) / ids.size();
+    }
+
+    // 到期：n 个定时器在 EXPIRE_SPAN_MS 内陆续到期，只统计 getNextTick 的耗时
+    {
+        Timer timer;
+        std::mt19937 rng(n);
+        for (int i = 0; i < n; ++i) {
+            timer.add(i, rng() % EXPIRE_SPAN_MS, cb);
+        }
+
+        fired = 0;
+        double total = 0;
+        while (fired < n) {
+            timeStamp start = Clock::now();
+            int next = timer.getNextTick();
+            total += elapsedNs(start);
+
+            if (next > 0) {
+                std::this_thread::sleep_for(MS(next));
+            }
+        }
+        res.expireNs = total / n;
+    }
+
+    return res;
+}
+
+
+int main(int argc, char* argv[])
+{
+    std::vector<int> sizes = { 10000, 100000, 1000000 };
+    if (argc > 1) {
+        sizes.clear();
+        for (int i = 1; i < argc; ++i) {
+            sizes.push_back(atoi(argv[i]));
+        }
+    }
+
+    printf("%-10s %-12s %12s %12s %12s\n", "timers", "impl", "add(ns)", "adjust(ns)", "expire(ns)");
+
+    for (int n : sizes) {
+        // adjust 的 id 序列两者相同
+        std::vector<int> ids(n);
+        std::mt19937 rng(42);
+        for (int i = 0; i < n; ++i) {
+            ids[i] = rng() % n;
+        }
+
+        benchResult heap = runBench<HeapTimer>(n, ids);
+        benchResult wheel = runBench<TimingWheel>(n, ids);
+
+        printf("%-10d %-12s %12.1f %12.1f %12.1f\n", n, "HeapTimer", heap.addNs, heap.adjustNs, heap.expireNs);
+        printf("%-10d %-12s %12.1f %12.1f %12.1f\n", n, "TimingWheel", wheel.addNs, wheel.adjustNs, wheel.expireNs);
+    }
+
+    return 0;
+}
@@ -0,0 +1,127 @@
+
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include<cstddef>
+#include<cstdint>
+#include<cstdlib>
+#include<cstring>
+#include<string_view>
+#include<new>
+#include<assert.h>
+
+
+// 每个连接一个的内存区（bump 分配）：分配只移动指针，不单独释放，reset 时整体回收
+// 用于一个请求及其响应的临时数据（路径、正文、拼接的字符串），开始解析新请求时 reset
+// 一个请求用到多块时，reset 合并为一块，之后同样大小的请求 只用一块、不再向系统分配
+class Arena {
+public:
+    explicit Arena(size_t blockSize = BLOCK_SIZE) : head_(nullptr), ptr_(nullptr), end_(nullptr), blockSize_(blockSize) {}
+
+    ~Arena() {
+        freeBlocks_();
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // 分配 n 字节，按 align 对齐；在 reset 之前有效
+    void* allocate(size_t n, size_t align = alignof(std::max_align_t)) {
+        uintptr_t p = (reinterpret_cast<uintptr_t>(ptr_) + align - 1) & ~(align - 1);
+        if (!ptr_ || p + n > reinterpret_cast<uintptr_t>(end_)) {
+            newBlock_(n + align);
+            p = (reinterpret_cast<uintptr_t>(ptr_) + align - 1) & ~(align - 1);
+        }
+        ptr_ = reinterpret_cast<char*>(p + n);
+        return reinterpret_cast<void*>(p);
+    }
+
+    // 分配 n 个字符，不对齐
+    char* alloc(size_t n) {
+        return static_cast<char*>(allocate(n, 1));
+    }
+
+    // 拷贝字符串，结尾补 '\0'（不计入返回的长度）
+    std::string_view copy(std::string_view s) {
+        char* p = alloc(s.size() + 1);
+        memcpy(p, s.data(), s.size());
+        p[s.size()] = '\0';
+        return std::string_view(p, s.size());
+    }
+
+    // 拼接两个字符串，结尾补 '\0'
+    std::string_view concat(std::string_view a, std::string_view b) {
+        char* p = alloc(a.size() + b.size() + 1);
+        memcpy(p, a.data(), a.size());
+        memcpy(p + a.size(), b.data(), b.size());
+        p[a.size() + b.size()] = '\0';
+        return std::string_view(p, a.size() + b.size());
+    }
+
+    // 回收所有分配；用到多块时合并为一块（超过 MAX_KEEP 的部分不保留）
+    void reset() {
+        if (head_ && head_->prev) {
+            size_t total = 0;
+            for (block* b = head_; b; b = b->prev) {
+                total += b->size;
+            }
+            freeBlocks_();
+            newBlock_(total < MAX_KEEP ? total : MAX_KEEP);
+        }
+        else if (head_ && head_->size > MAX_KEEP) {
+            freeBlocks_();
+        }
+        ptr_ = head_ ? head_->data() : nullptr;
+    }
+
+    // 当前持有的内存
+    size_t capacity() const {
+        size_t total = 0;
+        for (block* b = head_; b; b = b->prev) {
+            total += b->size;
+        }
+        return total;
+    }
+
+    static const size_t BLOCK_SIZE = 4096;      // 默认块大小，常见请求的临时数据 一块足够
+    static const size_t MAX_KEEP = 65536;       // reset 后最多保留的内存，大请求（如大的 POST 正文）之后不长期占用
+
+private:
+    // 块头，数据紧跟其后
+    struct alignas(std::max_align_t) block {
+        block* prev;        // 之前的块
+        size_t size;        // 数据区大小
+        char* data() { return reinterpret_cast<char*>(this + 1); }
+    };
+
+    // 新建一块 作为当前块，数据区至少 need 字节；块在第一次分配时才建立（空闲连接不占内存）
+    void newBlock_(size_t need) {
+        size_t size = need > blockSize_ ? need : blockSize_;
+        block* b = static_cast<block*>(malloc(sizeof(block) + size));
+        if (!b) {
+            throw std::bad_alloc();
+        }
+        b->prev = head_;
+        b->size = size;
+        head_ = b;
+        ptr_ = b->data();
+        end_ = ptr_ + size;
+    }
+
+    void freeBlocks_() {
+        while (head_) {
+            block* prev = head_->prev;
+            free(head_);
+            head_ = prev;
+        }
+        ptr_ = end_ = nullptr;
+    }
+
+    block* head_;           // 当前块
+    char* ptr_;             // 当前块中 下次分配的位置
+    char* end_;             // 当前块的结尾
+    size_t blockSize_;      // 新建块的最小大小
+};
+
+
+#endif  // ARENA_HPP
@@ -110,7 +110,7 @@ char* Buffer::beginWrite()
 
 
 // 往缓冲区写入数据
-void Buffer::append(const std::string& str)
+void Buffer::append(std::string_view str)
 {
     append(str.data(), str.length());
 }
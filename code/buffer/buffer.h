@@ -8,6 +8,7 @@
 #include<unistd.h>
 #include<sys/uio.h>
 #include<vector>
+#include<string_view>
 #include<atomic>
 #include<assert.h>
 
@@ -34,7 +35,7 @@ public:
     const char* beginWriteConst() const;
     char* beginWrite();
 
-    void append(const std::string& str);
+    void append(std::string_view str);
     void append(const char* str, size_t len);
     void append(const void* data, size_t len);
     void append(const Buffer& buff);
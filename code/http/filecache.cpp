@@ -0,0 +1,214 @@
+
+#include"filecache.h"
+using namespace std;
+
+
+FileCache::FileCache()
+{
+    budget_ = 0;
+    maxFileSize_ = 0;
+    used_ = 0;
+    hand_ = 0;
+}
+
+
+FileCache::~FileCache()
+{
+}
+
+
+// 单例模式：局部静态变量的懒汉模式
+FileCache* FileCache::instance()
+{
+    static FileCache cache;
+    return &cache;
+}
+
+
+// 初始化：内存预算（字节），0 表示不缓存；单个文件最多占预算的 1/4
+void FileCache::init(size_t budget)
+{
+    unique_lock<shared_mutex> locker(mtx_);
+
+    budget_ = budget;
+    maxFileSize_ = budget / 4;
+
+    evict_(0);  // 预算变小时 淘汰多出的部分
+}
+
+
+// 查找 path 对应的缓存文件，未缓存 或文件已修改时 返回空
+// 命中时不需要任何文件系统调用（每 REVALIDATE_MS 一次 stat 确认文件未修改）
+FileCache::filePtr FileCache::find(string_view path)
+{
+    filePtr stale;
+    {
+        shared_lock<shared_mutex> locker(mtx_);
+
+        auto it = map_.find(path);
+        if (it == map_.end()) {
+            return nullptr;
+        }
+
+        entry* e = it->second.get();
+        if (!isStale_(e)) {
+            e->referenced.store(true, memory_order_relaxed);
+            return e->file;
+        }
+        stale = e->file;
+    }
+
+    // 文件已修改，移除缓存项（其他线程可能已经移除 或重新加载）
+    unique_lock<shared_mutex> locker(mtx_);
+    auto it = map_.find(path);
+    if (it != map_.end() && it->second->file == stale) {
+        LOG_DEBUG("FileCache: %.*s modified", static_cast<int>(path.size()), path.data());
+        remove_(it->second.get());
+    }
+    return nullptr;
+}
+
+
+// 读取 path 对应的文件并加入缓存，st 为调用者已获取的文件属性
+// 不缓存（预算为 0、不是普通文件、文件过大）或读取失败时 返回空，由调用者自行处理
+FileCache::filePtr FileCache::load(const string& path, const struct stat& st)
+{
+    if (!S_ISREG(st.st_mode) || static_cast<size_t>(st.st_size) > maxFileSize_) {
+        return nullptr;
+    }
+
+    int fd = open(path.data(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    // 读入完整的文件内容
+    shared_ptr<file> f(new file);
+    if (fstat(fd, &f->st) < 0 || !S_ISREG(f->st.st_mode) || static_cast<size_t>(f->st.st_size) > maxFileSize_) {
+        close(fd);
+        return nullptr;
+    }
+
+    size_t size = f->st.st_size;
+    f->data.reset(new char[size]);
+    size_t readBytes = 0;
+    while (readBytes < size) {
+        ssize_t len = read(fd, f->data.get() + readBytes, size - readBytes);
+        if (len <= 0) {
+            break;
+        }
+        readBytes += len;
+    }
+    close(fd);
+
+    if (readBytes != size) {    // 读取时文件被截断 或出错
+        return nullptr;
+    }
+
+    unique_lock<shared_mutex> locker(mtx_);
+
+    // 其他线程已经加载了该文件
+    auto it = map_.find(path);
+    if (it != map_.end()) {
+        it->second->referenced.store(true, memory_order_relaxed);
+        return it->second->file;
+    }
+
+    // 空间不够时 先淘汰
+    evict_(size);
+
+    entry* e = new entry;
+    e->path = path;
+    e->file = f;
+    e->referenced.store(false, memory_order_relaxed);
+    e->checkedMS.store(nowMS_(), memory_order_relaxed);
+    e->slot = ring_.size();
+
+    map_.emplace(e->path, unique_ptr<entry>(e));
+    ring_.push_back(e);
+    used_ += size;
+
+    LOG_DEBUG("FileCache: load %s, size:%zu, used:%zu", path.data(), size, used_);
+
+    return f;
+}
+
+
+// 已缓存的文件总大小
+size_t FileCache::usedBytes()
+{
+    shared_lock<shared_mutex> locker(mtx_);
+    return used_;
+}
+
+
+// 已缓存的文件数量
+size_t FileCache::fileCount()
+{
+    shared_lock<shared_mutex> locker(mtx_);
+    return map_.size();
+}
+
+
+// 当前时间（毫秒）
+int64_t FileCache::nowMS_()
+{
+    return chrono::duration_cast<chrono::milliseconds>(Clock::now().time_since_epoch()).count();
+}
+
+
+// 缓存项对应的文件 是否已被修改（大小、修改时间、inode、权限任一变化）或删除
+bool FileCache::isStale_(entry* e)
+{
+    int64_t now = nowMS_();
+    if (now - e->checkedMS.load(memory_order_relaxed) < REVALIDATE_MS) {
+        return false;
+    }
+
+    struct stat st;
+    const struct stat& old = e->file->st;
+    if (stat(e->path.data(), &st) < 0
+        || st.st_size != old.st_size || st.st_ino != old.st_ino || st.st_mode != old.st_mode
+        || st.st_mtim.tv_sec != old.st_mtim.tv_sec || st.st_mtim.tv_nsec != old.st_mtim.tv_nsec) {
+        return true;
+    }
+
+    e->checkedMS.store(now, memory_order_relaxed);
+    return false;
+}
+
+
+// 移除缓存项，需持有独占锁；正在发送该文件的连接 仍持有文件内容的引用
+void FileCache::remove_(entry* e)
+{
+    used_ -= e->file->st.st_size;
+
+    // 用 CLOCK 环最后一项 填补空位
+    size_t slot = e->slot;
+    ring_[slot] = ring_.back();
+    ring_[slot]->slot = slot;
+    ring_.pop_back();
+    if (hand_ >= ring_.size()) {
+        hand_ = 0;
+    }
+
+    map_.erase(map_.find(e->path));
+}
+
+
+// CLOCK 淘汰，直到能再放下 need 字节；需持有独占锁
+// 指针扫过的缓存项：访问位已置位的 清除访问位 给第二次机会，否则淘汰
+void FileCache::evict_(size_t need)
+{
+    while (used_ + need > budget_ && !ring_.empty()) {
+        entry* e = ring_[hand_];
+        if (e->referenced.load(memory_order_relaxed)) {
+            e->referenced.store(false, memory_order_relaxed);
+            hand_ = (hand_ + 1) % ring_.size();
+        }
+        else {
+            LOG_DEBUG("FileCache: evict %s", e->path.data());
+            remove_(e);     // 最后一项移到了 hand_ 处，指针不用动
+        }
+    }
+}
@@ -0,0 +1,77 @@
+
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include<string>
+#include<string_view>
+#include<memory>
+#include<vector>
+#include<unordered_map>
+#include<atomic>
+#include<mutex>
+#include<shared_mutex>
+#include<chrono>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/stat.h>
+
+#include"../log/log.h"
+
+
+// 进程内共享的静态文件缓存，以文件路径为 key
+// 文件内容只读，由 shared_ptr 引用计数：缓存淘汰后 正在发送它的连接仍持有引用，发送完才释放
+// 总大小受内存预算限制，超出时按 CLOCK（第二次机会）算法淘汰
+class FileCache {
+public:
+    // 缓存的文件，加载后不再修改
+    struct file {
+        std::unique_ptr<char[]> data;   // 文件内容
+        struct stat st;                 // 加载时的文件属性
+    };
+    typedef std::shared_ptr<const file> filePtr;
+
+    static FileCache* instance();
+
+    void init(size_t budget);
+
+    filePtr find(std::string_view path);
+    filePtr load(const std::string& path, const struct stat& st);
+
+    size_t usedBytes();
+    size_t fileCount();
+
+private:
+    FileCache();
+    ~FileCache();
+
+    typedef std::chrono::steady_clock Clock;
+
+    // 缓存项
+    struct entry {
+        std::string path;
+        filePtr file;
+        std::atomic<bool> referenced;       // CLOCK 访问位，命中时置位
+        std::atomic<int64_t> checkedMS;     // 上次确认文件未修改的时间
+        size_t slot;                        // 在 ring_ 中的位置
+    };
+
+    static int64_t nowMS_();
+    bool isStale_(entry* e);
+    void remove_(entry* e);
+    void evict_(size_t need);
+
+    static const int64_t REVALIDATE_MS = 1000;  // 缓存项超过该时间 再次访问时 stat 确认文件未修改
+
+    size_t budget_;         // 内存预算（字节），0 表示不缓存
+    size_t maxFileSize_;    // 单个文件的大小上限，超过的文件不缓存
+    size_t used_;           // 已缓存的文件总大小
+
+    std::unordered_map<std::string_view, std::unique_ptr<entry>> map_;     // 键指向 entry::path，查找时不构造 string
+    std::vector<entry*> ring_;      // CLOCK 环
+    size_t hand_;                   // CLOCK 指针
+
+    std::shared_mutex mtx_;         // 查找共享加锁，插入/淘汰独占加锁
+};
+
+
+#endif  // FILE_CACHE_H
@@ -8,14 +8,27 @@ using namespace std;
 bool HttpConn::isET;
 const char* HttpConn::srcDir;
 atomic<int> HttpConn::userCount;
+atomic<uint64_t> HttpConn::nextId(1);
 
 
-HttpConn::HttpConn()
+HttpConn::HttpConn() : request_(&arena_)
 {
     fd_ = -1;
+    id_ = 0;
     addr_ = { 0 };
 
     isClose_ = true;
+    isKeepAlive_ = false;
+
+    iovIdx_ = 0;
+    toWriteBytes_ = 0;
+    fileResp_ = nullptr;
+    respCnt_ = 0;
+
+    readNS_ = 0;
+    readyNS_ = 0;
+
+    verify_ = VERIFY_NONE;
 }
 
 
@@ -33,9 +46,26 @@ void HttpConn::init(int sockFd, const sockaddr_in& addr)
     ++userCount;    // 静态变量，记录总客户端连接数
 
     fd_ = sockFd;
+    id_ = nextId++;
     addr_ = addr;
 
     isClose_ = false;
+    isKeepAlive_ = false;
+
+    // 清空 上一个使用该槽位的连接 留下的待写入数据
+    iov_.clear();
+    iovIdx_ = 0;
+    toWriteBytes_ = 0;
+    fileResp_ = nullptr;
+    respCnt_ = 0;
+
+    readNS_ = 0;
+    readyNS_ = 0;
+    Metrics::instance()->onAccept();
+
+    // 初始化 请求，上一个使用该槽位的连接可能留下未解析完的请求
+    request_.init();
+    verify_ = VERIFY_NONE;
     
     // 初始化 读写缓冲区
     readBuff_.retrieveAll();
@@ -49,7 +79,9 @@ void HttpConn::init(int sockFd, const sockaddr_in& addr)
 void HttpConn::Close()
 {
     // 解除内存区映射
-    response_.unmapFile();
+    for (HttpResponse& response : responses_) {
+        response.unmapFile();
+    }
 
     if (isClose_ == false) {
         isClose_ = true;
@@ -74,6 +106,10 @@ ssize_t HttpConn::read(int* saveErrno)
         if (len <= 0) {
             break;
         }
+
+        if (readNS_ == 0) {     // 新请求的数据开始到达
+            readNS_ = Metrics::nowNS();
+        }
     } while (isET);     // 如果是ET模式，则一直读 直到读完数据；LT模式则只读一次
 
     return len;
@@ -86,42 +122,88 @@ ssize_t HttpConn::write(int* saveErrno)
     ssize_t len = -1;
 
     do {
-        // 聚集写，将 iovCnt_ 个 iov_ 内的数据 写入到 fd_ 中
-        len = writev(fd_, iov_, iovCnt_);
+        if (iovIdx_ < iov_.size()) {
+            // 聚集写，将 iov_ 中未写完的数据（可能是多个流水线请求的响应）一次写入到 fd_ 中
+            len = writev(fd_, iov(), iovCnt());
+        }
+        else {
+            // iov_ 已写完，sendfile 发送剩余的资源文件；EAGAIN 时文件偏移已保存，下次接着发送
+            assert(fileResp_);
+            len = fileResp_->sendFile(fd_);
+        }
 
         if (len <= 0) {
-            *saveErrno = errno;     // 保存 writev 的 errno
+            *saveErrno = errno;     // 保存 writev/sendfile 的 errno
             break;
         }
 
-        // iov_[0]为写缓冲区中的响应信息，iov_[1]为共享内存区中的响应资源文件
-        if (iov_[0].iov_len + iov_[1].iov_len == 0) {               // 两个 iovec 大小都为零，无数据要写入/写完
+        hasWritten(len);    // 更新 iov_ 至未写入数据的位置
+
+        if (toWriteBytes_ == 0) {   // 全部写完
             break;
         }
-        else if (static_cast<size_t>(len) > iov_[0].iov_len) {      // 第一个 iovec 的数据已写完，第二个不知道写完没
 
-            // iov_[1] 更新 至未写入数据的位置
-            iov_[1].iov_base = (uint8_t*)iov_[1].iov_base + (len - iov_[0].iov_len);
-            iov_[1].iov_len -= (len - iov_[0].iov_len);
+    } while (isET || toWriteBytes() > 10240);   // ET模式：一直写 直到写完；或待写入数据过多，写到待写入数据不那么多
 
-            // iov_[0]已写完，可以清空 iov_[0]
-            if (iov_[0].iov_len) {
-                writeBuff_.retrieveAll();   // iov_[0]映射的是写缓冲区，清空写缓冲区
-                iov_[0].iov_len = 0;
-            }
-        }
-        else {                                                      // 第一个 iovec 的数据没写完，第二个没写
+    return len;
+}
 
-            // 更新 iov_[0] 至未写入位置
-            iov_[0].iov_base = (uint8_t*)iov_[0].iov_base + len;
-            iov_[0].iov_len -= len;
 
-            writeBuff_.retrieve(len);       // 更新写缓冲区
-        }
+// 将已收到的数据 追加到读缓冲区（io_uring 由内核直接完成接收，不经过 read）
+void HttpConn::appendRead(const char* data, size_t len)
+{
+    readBuff_.append(data, len);
 
-    } while (isET || toWriteBytes() > 10240);   // ET模式：一直写 直到写完；或待写入数据过多，写到待写入数据不那么多
+    if (readNS_ == 0) {
+        readNS_ = Metrics::nowNS();
+    }
+}
 
-    return len;
+
+// 返回 第一个未写完的 iovec，供 io_uring 提交聚集写
+struct iovec* HttpConn::iov()
+{
+    return iov_.data() + iovIdx_;
+}
+
+
+// 返回 未写完的 iovec 数量
+int HttpConn::iovCnt() const
+{
+    return static_cast<int>(iov_.size() - iovIdx_);
+}
+
+
+// 已写入 len 字节，更新 iov_ 至未写入数据的位置
+void HttpConn::hasWritten(size_t len)
+{
+    assert(len <= toWriteBytes_);
+    toWriteBytes_ -= len;
+
+    Metrics* metrics = Metrics::instance();
+    metrics->onSent(len);
+
+    // 跳过已写完的 iovec
+    while (iovIdx_ < iov_.size() && len >= iov_[iovIdx_].iov_len) {
+        len -= iov_[iovIdx_].iov_len;
+        ++iovIdx_;
+    }
+
+    // 更新 第一个未写完的 iovec 至未写入数据的位置（iov_ 已写完时 写入的是 sendfile 的资源文件，偏移由 HttpResponse 记录）
+    if (len > 0 && iovIdx_ < iov_.size()) {
+        iov_[iovIdx_].iov_base = (uint8_t*)iov_[iovIdx_].iov_base + len;
+        iov_[iovIdx_].iov_len -= len;
+    }
+
+    // 全部写完，清空写缓冲区；记录本轮的发送耗时 与各请求的总耗时
+    if (toWriteBytes_ == 0) {
+        writeBuff_.retrieveAll();
+
+        int64_t now = Metrics::nowNS();
+        metrics->record(Metrics::WRITE, now - readyNS_);
+        metrics->record(Metrics::TOTAL, now - readNS_, respCnt_);
+        readNS_ = 0;
+    }
 }
 
 
@@ -153,57 +235,190 @@ int HttpConn::getPort() const
 }
 
 
-// 解析 http 请求，生成 http 响应
+// 解析 读缓冲区中所有完整的 http 请求（流水线），按顺序生成 http 响应，之后一次聚集写发出
+// 没有完整的请求时返回 false，等待更多数据
 bool HttpConn::process()
 {
-    // 初始化 请求 对象
-    request_.init();
+    // 上一轮的响应已全部发送，解除文件映射，清空 iov_
+    for (size_t i = 0; i < respCnt_; ++i) {
+        responses_[i].unmapFile();
+    }
+    respCnt_ = 0;
+    writeBuff_.retrieveAll();
+    iov_.clear();
+    iovIdx_ = 0;
+    toWriteBytes_ = 0;
+    fileResp_ = nullptr;
+
+    Metrics* metrics = Metrics::instance();
+    int64_t start = Metrics::nowNS();
+    if (readNS_ == 0) {         // 读缓冲区中上一轮留下的请求
+        readNS_ = start;
+    }
 
-    if (readBuff_.readableBytes() <= 0) {   // 读缓冲区 没有可读取的数据
-        return false;
+    while (respCnt_ < MAX_PIPELINE && (verify_ == VERIFY_DONE || readBuff_.readableBytes() > 0)) {
+
+        HttpRequest::PARSE_RESULT res = HttpRequest::PARSE_OK;
+        if (verify_ == VERIFY_DONE) {           // 检验完成的注册/登录请求，已解析过
+            verify_ = VERIFY_NONE;
+        }
+        else if (verify_ != VERIFY_NONE) {      // 注册/登录请求 仍在等待检验，之后的请求也要等它
+            break;
+        }
+        else {
+            // 读缓冲区中的数据，解析请求信息
+            res = request_.parse(readBuff_);
+            if (res == HttpRequest::PARSE_AGAIN) {  // 请求不完整
+                break;
+            }
+
+            // 注册/登录请求 要访问数据库，不能在这里阻塞：先发送之前的响应，再由 Reactor 交给数据库线程
+            if (res == HttpRequest::PARSE_OK && request_.needVerify()) {
+                verify_ = VERIFY_HELD;
+                break;
+            }
+        }
+
+        int64_t parsed = Metrics::nowNS();
+        metrics->record(Metrics::PARSE, parsed - start);
+
+        if (respCnt_ == responses_.size()) {
+            responses_.emplace_back(&arena_);
+        }
+        HttpResponse& response = responses_[respCnt_++];
+
+        if (res == HttpRequest::PARSE_OK) {
+            LOG_DEBUG("Request resource path: %.*s", static_cast<int>(request_.path().size()), request_.path().data());
+
+            // 初始化 响应，200成功（数据库繁忙时 503）
+            response.init(srcDir, request_.path(), request_.isKeepAlive(), request_.code());
+            isKeepAlive_ = request_.isKeepAlive();
+        }
+        else {                                  // 解析请求失败，不是有效请求
+            // 初始化 响应，400失败（正文过大时 413）
+            response.init(srcDir, request_.path(), false, request_.code());
+            isKeepAlive_ = false;
+        }
+
+        // 生成响应信息，追加到写缓冲区；写缓冲区还可能扩容，先只记录长度
+        size_t headLen = writeBuff_.readableBytes();
+        if (res == HttpRequest::PARSE_OK && request_.path() == Metrics::PATH) {
+            response.makeResponse(writeBuff_, metrics->render());   // 运行指标，不读取资源文件
+        }
+        else {
+            response.makeResponse(writeBuff_);
+        }
+        appendIov_(nullptr, writeBuff_.readableBytes() - headLen);
+
+        // 共享内存区/资源文件
+        if (response.fileLen() > 0 && response.file()) {
+            appendIov_(const_cast<char*>(response.file()), response.fileLen());
+        }
+
+        LOG_DEBUG("%.*s, Resources size: %d", static_cast<int>(response.path().size()), response.path().data(), response.fileLen());
+
+        metrics->onResponse(response.code());
+        start = Metrics::nowNS();
+        metrics->record(Metrics::PROCESS, start - parsed);
+
+        // 用 sendfile 发送的大文件 不在 iov_ 中，只能放在最后发送，本轮不再处理之后的请求
+        if (response.fileFd() >= 0) {
+            fileResp_ = &response;
+            toWriteBytes_ += response.fileRemain();
+            break;
+        }
+
+        if (!isKeepAlive_) {    // 不再保持连接，之后的请求不再处理
+            break;
+        }
     }
-    else if (request_.parse(readBuff_)) {   // 读缓冲区中的数据，解析请求信息
-        LOG_DEBUG("Request resource path: %s", request_.path().c_str());
 
-        // 初始化 响应，200成功
-        response_.init(srcDir, request_.path(), request_.isKeepAlive(), 200);
+    if (respCnt_ == 0) {
+        return false;
     }
-    else {                                  // 解析请求失败，不是有效请求
-        // 初始化 响应，400失败
-        response_.init(srcDir, request_.path(), false, 400);
+    readyNS_ = start;
+
+    // 写缓冲区不再变化，将各响应信息 映射到写缓冲区中对应的位置
+    char* head = const_cast<char*>(writeBuff_.peek());
+    for (struct iovec& iov : iov_) {
+        if (!iov.iov_base) {
+            iov.iov_base = head;
+            head += iov.iov_len;
+        }
     }
 
-    // 生成响应信息
-    response_.makeResponse(writeBuff_);
+    LOG_DEBUG("Responses: %d, iovec: %d, total: %d", static_cast<int>(respCnt_), iovCnt(), toWriteBytes());
 
-    // 将响应信息 映射到 iov_[0]
-    iov_[0].iov_base = const_cast<char*>(writeBuff_.peek());
-    iov_[0].iov_len = writeBuff_.readableBytes();
-    iovCnt_ = 1;
+    return true;
+}
 
-    // 将共享内存区/资源文件 映射到 iov_[1]
-    if (response_.fileLen() > 0 && response_.file()) {
-        iov_[1].iov_base = response_.file();
-        iov_[1].iov_len = response_.fileLen();
-        iovCnt_ = 2;
-    }
 
-    LOG_DEBUG("%s, Response info size: %d, Resources size: %d, total: %d",
-            response_.path().c_str(), iov_[0].iov_len, response_.fileLen(), toWriteBytes());
+// 之前的响应都已发送、有等待检验用户身份的请求时，转为等待状态 并返回 true，由调用者提交给数据库线程
+// 在 process 返回 false 之后调用；等待期间 process 不再处理请求，直到 onVerified
+bool HttpConn::startVerify()
+{
+    if (verify_ != VERIFY_HELD || respCnt_ > 0) {
+        return false;
+    }
 
+    verify_ = VERIFY_WAITING;
     return true;
 }
 
 
-// 返回 待写入的字节数，即 iov_ 总长度
+// 用户身份检验完成，之后的 process 为该请求生成响应 并继续处理之后的请求
+void HttpConn::onVerified(UserStore::RESULT res)
+{
+    assert(verify_ == VERIFY_WAITING);
+
+    request_.setVerified(res);
+    verify_ = VERIFY_DONE;
+}
+
+
+// 返回 当前请求，等待检验时 即为要检验的注册/登录请求
+const HttpRequest& HttpConn::request() const
+{
+    return request_;
+}
+
+
+// 返回 连接编号
+uint64_t HttpConn::getId() const
+{
+    return id_;
+}
+
+
+// 连接是否已关闭
+bool HttpConn::isClosed() const
+{
+    return isClose_;
+}
+
+
+// 在 iov_ 末尾添加一段待写入数据（资源文件只读，iovec 的 iov_base 不是 const，写入时不会修改），base 为空表示写缓冲区中的响应信息，与前一段响应信息相邻时合并
+void HttpConn::appendIov_(char* base, size_t len)
+{
+    if (!base && !iov_.empty() && !iov_.back().iov_base) {
+        iov_.back().iov_len += len;
+    }
+    else {
+        iov_.push_back({ base, len });
+    }
+    toWriteBytes_ += len;
+}
+
+
+// 返回 待写入的字节数
 int HttpConn::toWriteBytes() {
 
-    return iov_[0].iov_len + iov_[1].iov_len;
+    return toWriteBytes_;
 }
 
 
 // 检查是否仍与客户端保持连接
 bool HttpConn::isKeepAlive() const {
 
-    return request_.isKeepAlive();
+    return isKeepAlive_;
 }
@@ -8,10 +8,14 @@
 #include<arpa/inet.h>
 #include<stdlib.h>
 #include<errno.h>
+#include<vector>
+#include<deque>
 
 #include"../log/log.h"
+#include"../log/metrics.h"
 #include"../pool/sqlconnRAII.hpp"
 #include"../buffer/buffer.h"
+#include"../buffer/arena.hpp"
 #include"httprequest.h"
 #include"httpresponse.h"
 
@@ -27,6 +31,11 @@ public:
     ssize_t read(int* saveErrno);
     ssize_t write(int* saveErrno);
 
+    void appendRead(const char* data, size_t len);
+    struct iovec* iov();
+    int iovCnt() const;
+    void hasWritten(size_t len);
+
     int getFd() const;
     sockaddr_in getAddr() const;
     const char* getIP() const;
@@ -34,29 +43,57 @@ public:
 
     bool process();
 
+    bool startVerify();
+    void onVerified(UserStore::RESULT res);
+    const HttpRequest& request() const;
+    uint64_t getId() const;
+    bool isClosed() const;
+
     int toWriteBytes();
     bool isKeepAlive() const;
 
+    static const int MAX_PIPELINE = 128;    // 一次最多处理的流水线请求数，每个响应至多占 2 个 iovec，不超过 IOV_MAX
+
     static bool isET;                   // 是否为 ET边沿触发模式
     static const char* srcDir;          // 存放服务器资源文件的路径
     static std::atomic<int> userCount;  // 原子变量：记录连接的客户端数量
+    static std::atomic<uint64_t> nextId;    // 下一个连接编号
 
 private:
+    // 注册/登录请求 检验用户身份（访问数据库）的状态
+    enum VERIFY_STATE {
+        VERIFY_NONE,        // 没有等待检验的请求
+        VERIFY_HELD,        // 已解析出需要检验的请求，之前的响应发送完后 由 Reactor 提交检验
+        VERIFY_WAITING,     // 已提交给数据库线程，连接挂起（不处理请求、epoll 下不监听读写事件）
+        VERIFY_DONE,        // 检验完成，下一次 process 为它生成响应
+    };
+
+    void appendIov_(char* base, size_t len);
 
     int fd_;
+    uint64_t id_;               // 连接编号，每次 init 递增；异步检验完成时 用于确认仍是同一个连接
     struct sockaddr_in addr_;
 
     bool isClose_;
+    bool isKeepAlive_;          // 最后一个已响应的请求 是否保持连接
 
-    int iovCnt_;                // iovec 数量
-    struct iovec iov_[2];       // iovec：分散读、聚集写
-    // iov_[0]存响应信息/写缓冲区，iov_[1]存资源文件/共享内存区
+    std::vector<struct iovec> iov_;     // iovec：分散读、聚集写
+    // 按请求顺序，每个响应依次为 写缓冲区中的响应信息、资源文件/共享内存区（有的话）
+    size_t iovIdx_;             // 第一个未写完的 iovec
+    size_t toWriteBytes_;       // 待写入的字节数（包括 sendfile 未发送的部分）
+    HttpResponse* fileResp_;    // 用 sendfile 发送资源文件的响应，总是本轮最后一个响应，iov_ 写完后发送
 
     Buffer readBuff_;           // 读缓冲区
-    Buffer writeBuff_;          // 写缓冲区
+    Buffer writeBuff_;          // 写缓冲区，依次存放各响应的响应信息
+
+    int64_t readNS_;            // 待处理的请求 开始到达的时间，0 表示还没有
+    int64_t readyNS_;           // 本轮响应 生成完的时间
 
+    Arena arena_;               // 当前请求 及其响应的临时数据（路径、正文、错误页面），开始解析新请求时回收；需在 request_ 之前构造
     HttpRequest request_;       // 请求
-    HttpResponse response_;     // 响应
+    VERIFY_STATE verify_;       // request_ 检验用户身份的状态
+    std::deque<HttpResponse> responses_;    // 响应，按需增加 重复使用（deque 增加元素时 已有响应不移动）
+    size_t respCnt_;            // 本轮生成的响应数量
 };
 
 
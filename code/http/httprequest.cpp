@@ -15,183 +15,318 @@ const unordered_map<string, int> HttpRequest::DEFAULT_HTML_TAG {
     {"/register.html", 0},  // 注册
     {"/login.html", 1},     // 登录
 };
+// 用户账号的存储后端，由 WebServer 设置
+UserStore* HttpRequest::userStore = nullptr;
 
 
 
-HttpRequest::HttpRequest()
+HttpRequest::HttpRequest(Arena* arena) : arena_(arena)
 {
+    assert(arena_);
+
+    header_.reserve(16);    // 只拓展 capacity，常见请求的请求头不会再分配内存
+    post_.reserve(4);
     init();
 }
 
 
-// 初始化
+// 初始化，开始解析一个新请求
+// 回收 Arena：上一个请求 及其响应（已生成完）的临时数据都不再使用
 void HttpRequest::init()
 {
+    arena_->reset();
+
     state_ = REQUEST_LINE;
+    base_ = nullptr;
+    pos_ = 0;
+    scanPos_ = 0;
+    contentLen_ = 0;
+
+    method_ = version_ = { 0, 0 };
+    path_ = body_ = string_view();
+    header_.clear();
+    isKeepAlive_ = false;
+    post_.clear();
+    needVerify_ = false;
+    isLogin_ = false;
+    code_ = 200;
 }
 
 
 // 从 buff 中获取请求信息，解析请求
-bool HttpRequest::parse(Buffer &buff)
+// 请求完整时 从 buff 中取走该请求的全部数据（之后的数据留给下一个请求）；不完整时不取走数据，记下已扫描的位置，下次接着扫描
+HttpRequest::PARSE_RESULT HttpRequest::parse(Buffer &buff)
 {
-    const char CRLF[] = "\r\n";     // 回车换行
-
-    // 缓冲区无可读
-    if (buff.readableBytes() <= 0) {
-        return false;
+    // 上一个请求已解析完成，开始解析新请求
+    if (state_ == FINISH) {
+        init();
     }
 
-    // 只要 缓冲区可读、state_ 不为 FINISH
-    while (buff.readableBytes() && state_ != FINISH) {
+    // 缓冲区可能已整理或扩容，请求起点要重新获取；各字段保存的是偏移，不受影响
+    base_ = buff.peek();
+    size_t readable = buff.readableBytes();
 
-        // 在缓冲区中 找回车换行，一次只读一行数据
-        const char* lineEnd = search(buff.peek(), buff.beginWriteConst(), CRLF, CRLF + 2);
-        string line(buff.peek(), lineEnd);
+    // 状态机：根据当前请求状态 来处理对应信息
+    while (state_ != FINISH) {
+
+        // 请求正文（GET请求没有），按 Content-Length 等待数据到齐
+        if (state_ == BODY) {
+            if (readable - pos_ < contentLen_) {
+                return PARSE_AGAIN;
+            }
+            parseBody_();
+            break;
+        }
 
-        // 状态机：根据当前请求状态 来处理对应信息
+        // 在缓冲区中 找换行符，一次只处理一行（glibc 的 memchr 按 CPU 在运行时选择 SSE2/AVX2/EVEX 实现）
+        // 找不到说明这一行还没收完，记下已扫描的位置，下次只扫描新到达的数据（长请求头分多次到达时 不重复扫描）
+        const char* lineEnd = static_cast<const char*>(memchr(base_ + scanPos_, '\n', readable - scanPos_));
+        if (!lineEnd) {
+            scanPos_ = readable;
+            return PARSE_AGAIN;
+        }
+
+        size_t begin = pos_;
+        size_t end = lineEnd - base_;
+        pos_ = scanPos_ = end + 1;
+        if (end > begin && base_[end - 1] == '\r') {   // 去掉回车符
+            --end;
+        }
+
+        bool ok = true;
         switch (state_)
         {
         case REQUEST_LINE:      // 请求行
-            if (!parseRequestLine_(line)) {     // 解析请求行
-                return false;
-            }
-            parsePath_();                       // 解析路径
+            ok = parseRequestLine_(begin, end);     // 解析请求行、路径
             break;
         case HEADERS:           // 请求头
-            parseHeader_(line);                 // 解析 headers
-            if (buff.readableBytes() <= 2) {    // 可读字节不够，意味没有 请求正文 可读
-                state_ = FINISH;
+            if (begin == end) {                     // 空行，请求头结束
+                state_ = (contentLen_ > 0) ? BODY : FINISH;
+            }
+            else {
+                ok = parseHeader_(begin, end);      // 解析 headers
             }
             break;
-        case BODY:              // 请求正文（GET请求没有）
-            parseBody_(line);                   // 解析 body
-            break;
-        default:                // FINISH，请求信息已读取、解析完成
+        default:
             break;
         }
 
-        // 读到最后一行数据，跳出循环
-        if (lineEnd == buff.beginWrite()) {
-            break;
+        // 格式错误（或正文过大），丢弃缓冲区中的数据
+        if (!ok) {
+            if (code_ < 400) {
+                code_ = 400;
+            }
+            state_ = FINISH;
+            buff.retrieveAll();
+            return PARSE_ERROR;
         }
-
-        // 移动缓冲区读指针
-        buff.retrieveUntil(lineEnd + 2);
     }
 
-    LOG_DEBUG("[%s], [%s], [%s]", method_.c_str(), path_.c_str(), version_.c_str());
+    // header_中Connection的值为keep-alive 且 version_为1.1，才为有效连接
+    string_view connection = header("Connection");
+    isKeepAlive_ = (connection.size() == 10 && strncasecmp(connection.data(), "keep-alive", 10) == 0 && version() == "1.1");
 
-    return true;
+    // 取走该请求的数据，读位置之前的数据在下次写入缓冲区前仍然有效
+    buff.retrieve(pos_);
+
+    LOG_DEBUG("[%.*s], [%.*s], [%.*s]", static_cast<int>(method_.len), base_ + method_.off, static_cast<int>(path_.size()), path_.data(),
+              static_cast<int>(version_.len), base_ + version_.off);
+
+    return PARSE_OK;
 }
 
 
 // 返回 method_
-string HttpRequest::method() const
+string_view HttpRequest::method() const
 {
-    return method_;
+    return view_(method_);
 }
 
 
 // 返回 path_
-string HttpRequest::path() const
-{
-    return path_;
-}
-
-string& HttpRequest::path()
+string_view HttpRequest::path() const
 {
     return path_;
 }
 
 
 // 返回 version_
-string HttpRequest::version() const
+string_view HttpRequest::version() const
 {
-    return version_;
+    return view_(version_);
 }
 
 
-// 返回 post_表中 key映射的val
-string HttpRequest::getPost(const string& key) const
+// 返回 请求头 key 的值（不区分大小写），不存在时返回空
+string_view HttpRequest::header(const char* key) const
 {
-    assert(key != "");
+    assert(key != nullptr);
 
-    if (post_.count(key) == 1) {
-        return post_.find(key)->second;
+    size_t len = strlen(key);
+    for (const headerField& item : header_) {
+        if (item.key.len == len && strncasecmp(base_ + item.key.off, key, len) == 0) {
+            return view_(item.value);
+        }
     }
 
-    return "";
+    return string_view();
 }
 
-string HttpRequest::getPost(const char* key) const
+
+// 返回 post_表中 key映射的val，不存在时返回空；在开始解析下一个请求之前有效
+string_view HttpRequest::post(const char* key) const
 {
     assert(key != nullptr);
 
-    if (post_.count(key) == 1) {
-        return post_.find(key)->second;
+    for (const postField& item : post_) {
+        if (item.key == key) {
+            return item.value;
+        }
     }
 
-    return "";
+    return string_view();
+}
+
+// 返回 post_表中 key映射的val 的拷贝
+string HttpRequest::getPost(const char* key) const
+{
+    return string(post(key));
 }
 
 
 // 判断是否保持连接
 bool HttpRequest::isKeepAlive() const
 {
-    // header_中Connection的值为keep-alive 且 version_为1.1，才为有效连接
-    if (header_.count("Connection") == 1) {
-        return header_.find("Connection")->second == "keep-alive" && version_ == "1.1";
+    return isKeepAlive_;
+}
+
+
+// 是否为 等待检验用户身份的 注册/登录请求
+bool HttpRequest::needVerify() const
+{
+    return needVerify_;
+}
+
+
+// 是否为 登录请求（否则为注册请求）
+bool HttpRequest::isLogin() const
+{
+    return isLogin_;
+}
+
+
+// 用户身份检验完成，res 为检验结果
+void HttpRequest::setVerified(UserStore::RESULT res)
+{
+    assert(needVerify_);
+
+    needVerify_ = false;
+    if (res == UserStore::BUSY) {
+        code_ = 503;
+    }
+    else {
+        path_ = (res == UserStore::OK) ? "/welcome.html" : "/error.html";     // 常量，不需要拷贝
     }
+}
+
 
-    return false;
+// 返回 响应状态码
+int HttpRequest::code() const
+{
+    return code_;
 }
 
 
-// 解析 请求行
-bool HttpRequest::parseRequestLine_(const string& line)
+// 解析 请求行，[begin, end) 为不含换行符的一行
+bool HttpRequest::parseRequestLine_(size_t begin, size_t end)
 {
-    // 正则表达式
-    regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");     // 请求方法 URI HTTP协议版本
-    smatch subMatch;
+    // 请求方法 URI HTTP/协议版本，以单个空格分隔
+    const char* line = base_ + begin;
+    const char* lineEnd = base_ + end;
+
+    const char* sp1 = static_cast<const char*>(memchr(line, ' ', lineEnd - line));
+    const char* sp2 = sp1 ? static_cast<const char*>(memchr(sp1 + 1, ' ', lineEnd - sp1 - 1)) : nullptr;
 
-    // 正则表达式匹配上，获取请求行信息
-    if (regex_match(line, subMatch, patten)) {
-        method_ = subMatch[1];          // 请求方法
-        path_ = subMatch[2];            // URI
-        version_ = subMatch[3];         // HTTP协议版本
+    if (!sp1 || !sp2 || sp1 == line || sp2 == sp1 + 1 ||
+        lineEnd - sp2 - 1 < 5 || memcmp(sp2 + 1, "HTTP/", 5) != 0 ||
+        memchr(sp2 + 1, ' ', lineEnd - sp2 - 1)) {
 
-        state_ = HEADERS;               // 将解析状态 更新为 解析headers
+        LOG_ERROR("Parse RequestLine Error");
 
-        return true;
+        return false;
     }
 
-    LOG_ERROR("Parse RequestLine Error");
+    method_ = { begin, static_cast<size_t>(sp1 - line) };               // 请求方法
+    version_ = { static_cast<size_t>(sp2 + 6 - base_), static_cast<size_t>(lineEnd - sp2 - 6) };   // HTTP协议版本
+    parsePath_(string_view(sp1 + 1, sp2 - sp1 - 1));                    // URI
+
+    state_ = HEADERS;               // 将解析状态 更新为 解析headers
 
-    return false;
+    return true;
 }
 
 
-// 解析 请求头
-void HttpRequest::parseHeader_(const string& line)
+// 解析 请求头，key: val
+bool HttpRequest::parseHeader_(size_t begin, size_t end)
 {
-    // 正则表达式，key: val
-    regex patten("^([^:]*): ?(.*)$");
-    smatch subMatch;
+    const char* line = base_ + begin;
+    const char* lineEnd = base_ + end;
+
+    const char* colon = static_cast<const char*>(memchr(line, ':', lineEnd - line));
+    if (!colon) {
+        LOG_ERROR("Parse Header Error");
+        return false;
+    }
 
-    // 正则表达式匹配上，加入 header_哈希表
-    if (regex_match(line, subMatch, patten)) {
-        header_[subMatch[1]] = subMatch[2];
+    // 去掉值两端的空白
+    const char* value = colon + 1;
+    while (value < lineEnd && (*value == ' ' || *value == '\t')) {
+        ++value;
     }
-    else {      // 匹配不上、即匹配完所有请求头信息，则将解析状态 更新为 解析请求正文
-        state_ = BODY;
+    const char* valueEnd = lineEnd;
+    while (valueEnd > value && (valueEnd[-1] == ' ' || valueEnd[-1] == '\t')) {
+        --valueEnd;
     }
+
+    headerField item = {
+        { begin, static_cast<size_t>(colon - line) },
+        { static_cast<size_t>(value - base_), static_cast<size_t>(valueEnd - value) },
+    };
+    header_.push_back(item);
+
+    // 记录请求正文长度
+    if (item.key.len == 14 && strncasecmp(line, "Content-Length", 14) == 0) {
+        if (value == valueEnd) {
+            return false;
+        }
+
+        contentLen_ = 0;
+        for (const char* p = value; p < valueEnd; ++p) {
+            if (*p < '0' || *p > '9') {
+                LOG_ERROR("Parse Content-Length Error");
+                return false;
+            }
+            contentLen_ = contentLen_ * 10 + (*p - '0');
+
+            // 正文过大，不等待、不缓存正文，直接拒绝；超过上限后不再累加，不会溢出
+            if (contentLen_ > MAX_BODY) {
+                LOG_WARN("Content-Length too large");
+                code_ = 413;
+                return false;
+            }
+        }
+    }
+
+    return true;
 }
 
 
 // 解析 请求正文，只限于 POST 请求
-void HttpRequest::parseBody_(const string& line)
+void HttpRequest::parseBody_()
 {
-    body_ = line;
+    // 拷贝到 Arena 中，url 解码时原地修改
+    body_ = arena_->copy(string_view(base_ + pos_, contentLen_));
+    pos_ += contentLen_;
 
     // 解析 post 请求（如果为post才真正执行）
     parsePost_();
@@ -199,24 +334,33 @@ void HttpRequest::parseBody_(const string& line)
     // 更新解析状态 为解析完成
     state_ = FINISH;
 
-    LOG_DEBUG("Body:%s, len:%d", line.c_str(), line.size());
+    LOG_DEBUG("Body:%.*s, len:%d", static_cast<int>(body_.size()), body_.data(), body_.size());
+}
+
+
+// 返回 字段 f 的 string_view
+string_view HttpRequest::view_(const field& f) const
+{
+    return string_view(base_ + f.off, f.len);
 }
 
 
-// 解析 请求资源的路径
-void HttpRequest::parsePath_()
+// 解析 请求资源的路径，uri 在读缓冲区中，拷贝到 Arena
+void HttpRequest::parsePath_(string_view uri)
 {
-    if (path_ == "/") {     // 默认主页面
+    if (uri == "/") {       // 默认主页面
         path_ = "/index.html";
+        return;
     }
-    else {                  // 从已有默认html页面中选取
-        for (auto &item : DEFAULT_HTML) {
-            if (item == path_) {
-                path_ += ".html";
-                break;
-            }
+
+    for (auto &item : DEFAULT_HTML) {   // 从已有默认html页面中选取
+        if (item == uri) {
+            path_ = arena_->concat(uri, ".html");
+            return;
         }
     }
+
+    path_ = arena_->copy(uri);
 }
 
 
@@ -224,30 +368,43 @@ void HttpRequest::parsePath_()
 void HttpRequest::parsePost_()
 {
     // 为POST请求，且该 url 被编码过
-    if (method_ == "POST" && header_["Content-Type"] == "application/x-www-form-urlencoded") {
+    if (method() == "POST" && header("Content-Type") == "application/x-www-form-urlencoded") {
         
-        // 将 url 解码
-        parseFromUrlEncoded_();
+        // 将 url 解码（在 Arena 中的正文上原地解码）
+        parseFromUrlEncoded_(const_cast<char*>(body_.data()), body_.size());
 
         // 请求合理
-        if (DEFAULT_HTML_TAG.count(path_)) {
+        auto it = DEFAULT_HTML_TAG.find(string(path_));
+        if (it != DEFAULT_HTML_TAG.end()) {
             
             // 拿到操作对应的 tag
-            int tag = DEFAULT_HTML_TAG.find(path_)->second;
+            int tag = it->second;
 
             // 打印日志
-            LOG_DEBUG("%s, Tag:%d", path_.c_str(), tag);
+            LOG_DEBUG("%.*s, Tag:%d", static_cast<int>(path_.size()), path_.data(), tag);
 
-            // 请求为 注册或登录
+            // 请求为 注册或登录：检验用户身份
+            // 存储后端会阻塞（访问数据库）时，由 Reactor 交给数据库线程异步完成，完成后调用 setVerified；否则在这里直接完成
             if (tag == 0 || tag == 1) {
-                bool isLogin = (tag == 1);  // 是否为登录操作
+                isLogin_ = (tag == 1);      // 是否为登录操作
+
+                string name = getPost("username");     // 通常不超过 std::string 的短字符串长度，不分配内存
+                string pwd = getPost("password");
+                UserCache::RESULT res = UserCache::MISS;
 
-                // 检验用户身份
-                if (userVerify(post_["username"], post_["password"], isLogin)) {
-                    path_ = "/welcome.html";    // 注册/登录成功
+                if (name.empty() || pwd.empty()) {
+                    path_ = "/error.html";  // 错误输入，不需要访问数据库
+                }
+                else if (!userStore->isBlocking()) {
+                    needVerify_ = true;
+                    setVerified(userVerify(name, pwd, isLogin_));
+                }
+                else if ((res = UserCache::instance()->check(name, pwd, isLogin_)) != UserCache::MISS) {
+                    // 缓存可以确定结果，不需要访问数据库
+                    path_ = (res == UserCache::OK) ? "/welcome.html" : "/error.html";
                 }
                 else {
-                    path_ = "/error.html";      // 注册/登录失败
+                    needVerify_ = true;
                 }
             }
         }
@@ -255,49 +412,51 @@ void HttpRequest::parsePost_()
 }
 
 
-// 将 url 解码
-void HttpRequest::parseFromUrlEncoded_()
+// 将 url 解码：body 为 Arena 中的正文，原地修改；键值对指向 body
+void HttpRequest::parseFromUrlEncoded_(char* body, size_t len)
 {
     // 请求正文为空
-    if (body_.size() == 0) {
+    if (len == 0) {
         return;
     }
 
-    string key, value;
+    string_view key, value;
     int num = 0;
-    int n = body_.size();   // 请求正文的长度
+    int n = len;            // 请求正文的长度
     int i = 0, j = 0;
 
     post_.clear();
 
     // 遍历请求正文的每个字符
     for (; i < n; ++i) {
-        char ch = body_[i];
+        char ch = body[i];
         
         switch (ch)
         {
         case '=':   // key=value 键值对
-            key = body_.substr(j, i - j);
+            key = string_view(body + j, i - j);
             j = i + 1;
             break;
             
         case '+':   // 空格符
-            body_[i] = ' ';
+            body[i] = ' ';
             break;
 
-        case '%':   // 十六进制 转 十进制
-            num = converHex(body_[i + 1] * 16 + converHex(body_[i + 2]));
-            body_[i + 2] = num % 10 + '0';
-            body_[i + 1] = num / 10 + '0';
-            i += 2;
+        case '%':   // 十六进制 转 十进制（不完整的 %xx 不解码，不越过正文结尾）
+            if (i + 2 < n) {
+                num = converHex(body[i + 1] * 16 + converHex(body[i + 2]));
+                body[i + 2] = num % 10 + '0';
+                body[i + 1] = num / 10 + '0';
+                i += 2;
+            }
             break;
 
         case '&':   // 结束一对键值对
-            value = body_.substr(j, i - j);
+            value = string_view(body + j, i - j);
             j = i + 1;
-            post_[key] = value;
+            setPost_(key, value, true);
 
-            LOG_DEBUG("%s = %s", key.c_str(), value.c_str());
+            LOG_DEBUG("%.*s = %.*s", static_cast<int>(key.size()), key.data(), static_cast<int>(value.size()), value.data());
             break;
 
         default:
@@ -308,113 +467,58 @@ void HttpRequest::parseFromUrlEncoded_()
     assert(j <= i);
 
     // 补上最后一对 键值对
-    if (post_.count(key) == 0 && j < i) {
-        value = body_.substr(j, i - j);
-        post_[key] = value;
+    if (j < i) {
+        value = string_view(body + j, i - j);
+        setPost_(key, value, false);
         
-        LOG_DEBUG("%s = %s", key.c_str(), value.c_str());
+        LOG_DEBUG("%.*s = %.*s", static_cast<int>(key.size()), key.data(), static_cast<int>(value.size()), value.data());
     }
 }
 
 
-
-// 静态函数
-
-// 检验用户身份
-bool HttpRequest::userVerify(const string& name, const string& pwd, bool isLogin)
+// 记录一对 post 键值对；key 已存在时 overwrite 为 true 则替换，否则保留原来的值
+void HttpRequest::setPost_(string_view key, string_view value, bool overwrite)
 {
-    // 错误输入
-    if (name == "" || pwd == "") {
-        return false;
-    }
-
-    LOG_INFO("UserVerify name:%s pwd:%s", name.c_str(), pwd.c_str());
-
-    // 从 mysql池中 获取一个 mysql 连接对象
-    MYSQL* sql = nullptr;
-    // RAII对象：创建对象时 获取mysql连接对象；销毁对象时，自动销毁mysql连接对象
-    SqlConnRAII(&sql, SqlConnPool::instance());
-    assert(sql);
-
-    bool flag = false;          // true为正确 注册/登录操作，false为错误 注册/登录操作
-
-    char order[256] = { 0 };    // 记录 sql 命令
-    
-    // 注册操作
-    if (!isLogin) {
-        flag = true;
-    }
-
-    // 生成 查询用户、密码 的命令
-    snprintf(order, 256, "SELECT username, password FROM user WHERE username='%s' LIMIT 1", name.c_str());
-    
-    LOG_DEBUG("%s", order);
-
-    // 执行 查询命令
-    if (mysql_query(sql, order)) {          // 执行失败
-        
-        LOG_DEBUG("%s", mysql_error(sql));  // 生成错误原因
-        
-        return false;
-    }
-
-    // 存储 查询结果
-    MYSQL_RES* res = mysql_store_result(sql);
-
-    // 成功查询到 该用户名 的信息
-    while (MYSQL_ROW row = mysql_fetch_row(res)) {      // 返回结果集中下一行的结构
-        // 打印日志
-        LOG_DEBUG("MYSQL ROW: %s | %s", row[0], row[1]);  // username, password
-
-        string password(row[1]);
-
-        if (isLogin) {                  // 登录操作
-
-            if (pwd == password) {          // 成功登录
-                flag = true;
+    for (postField& item : post_) {
+        if (item.key == key) {
+            if (overwrite) {
+                item.value = value;
             }
-            else {                          // 登录失败，密码错误
-                flag = false;
-                LOG_DEBUG("pwd error!");    // 打印日志
-            }
-        }
-        else {                          // 注册操作，数据库已有该用户名、注册失败
-            flag = false;
-            LOG_DEBUG("user used!");
+            return;
         }
     }
+    post_.push_back({ key, value });
+}
 
-    // 释放结果集
-    mysql_free_result(res);
-
-    // 未查询到 该用户名 信息、注册行为、且用户名未被使用
-    if (!isLogin && flag == true) {
 
-        LOG_DEBUG("regirster!");
-        
-        // 生成 插入新用户数据 的命令
-        bzero(order, 256);
-        snprintf(order, 256, "INSERT INTO user(username, password) VALUES('%s', '%s')", name.c_str(), pwd.c_str());
+// 静态函数
 
-        LOG_DEBUG("%s", order);
+// 检验用户身份，由 userStore 完成；userStore 会阻塞时 只在数据库线程中调用
+// timeoutMS 为等待后端资源的最长时间（-1 一直等待），超时返回 BUSY
+UserStore::RESULT HttpRequest::userVerify(const string& name, const string& pwd, bool isLogin, int timeoutMS)
+{
+    // 错误输入
+    if (name == "" || pwd == "") {
+        return UserStore::FAIL;
+    }
 
-        // 执行 插入命令
-        if (mysql_query(sql, order)) {                          // 执行失败
+    assert(userStore);
+    return userStore->verify(name, pwd, isLogin, timeoutMS);
+}
 
-            LOG_DEBUG("Insert error: %s", mysql_error(sql));    // 生成错误原因
-            flag = false;
-        }
 
-        // 执行成功
-        flag = true;
+// 异步检验用户身份：结果通过 done 给出，done 可能在 userStore 的其他线程中调用
+void HttpRequest::userVerifyAsync(const string& name, const string& pwd, bool isLogin, int timeoutMS,
+                                  function<void(UserStore::RESULT)> done)
+{
+    // 错误输入
+    if (name == "" || pwd == "") {
+        done(UserStore::FAIL);
+        return;
     }
 
-    // 关闭连接
-    SqlConnPool::instance()->freeConn(sql);
-
-    LOG_DEBUG("UserVerify done!");       // 完成 UserVerify 操作
-
-    return flag;
+    assert(userStore);
+    userStore->verifyAsync(name, pwd, isLogin, timeoutMS, std::move(done));
 }
 
 
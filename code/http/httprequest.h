@@ -6,16 +6,23 @@
 #include<unordered_map>
 #include<unordered_set>
 #include<string>
-#include<regex>
+#include<string_view>
+#include<vector>
 #include<errno.h>
-#include<mysql/mysql.h>
+#include<string.h>
+#include<strings.h>
 
 #include"../buffer/buffer.h"
+#include"../buffer/arena.hpp"
 #include"../log/log.h"
-#include"../pool/sqlconnpool.h"
-#include"../pool/sqlconnRAII.hpp"
+#include"../pool/userstore.hpp"
+#include"../pool/usercache.h"
 
 
+// 增量解析的 HTTP 请求：直接在读缓冲区上逐行扫描，请求不完整时记录扫描位置，下次数据到达后接着解析
+// 方法、版本、请求头 以 相对于请求起点的偏移 保存，不拷贝、不分配内存；
+// 解析完成后 通过 string_view 访问，在读缓冲区再次写入数据之前有效
+// 路径、正文 拷贝到连接的 Arena 中，在开始解析下一个请求（init 回收 Arena）之前有效
 class HttpRequest {
 public:
     // 解析状态
@@ -26,38 +33,89 @@ public:
         FINISH,
     };
 
-    HttpRequest();
+    // 解析结果
+    enum PARSE_RESULT {
+        PARSE_OK,           // 解析完成一个请求，已从缓冲区取走
+        PARSE_AGAIN,        // 请求不完整，等待更多数据
+        PARSE_ERROR,        // 请求格式错误
+    };
+
+    explicit HttpRequest(Arena* arena);
     ~HttpRequest() = default;
 
     void init();
-    bool parse(Buffer &buff);
+    PARSE_RESULT parse(Buffer &buff);
 
-    std::string method() const;
-    std::string path() const;
-    std::string& path();
-    std::string version() const;
-    std::string getPost(const std::string& key) const;
+    std::string_view method() const;
+    std::string_view path() const;
+    std::string_view version() const;
+    std::string_view header(const char* key) const;
+    std::string_view post(const char* key) const;
     std::string getPost(const char* key) const;
 
     bool isKeepAlive() const;
 
+    bool needVerify() const;
+    bool isLogin() const;
+    void setVerified(UserStore::RESULT res);
+    int code() const;
+
+    static UserStore::RESULT userVerify(const std::string& name, const std::string& pwd, bool isLogin, int timeoutMS = -1);
+    static void userVerifyAsync(const std::string& name, const std::string& pwd, bool isLogin, int timeoutMS,
+                                std::function<void(UserStore::RESULT)> done);
+
+    static UserStore* userStore;        // 用户账号的存储后端
+
+    static constexpr size_t MAX_BODY = 65536;   // 请求正文的最大长度（注册/登录表单很小），超过时返回 413
+
 private:
-    bool parseRequestLine_(const std::string& line);
-    void parseHeader_(const std::string& line);
-    void parseBody_(const std::string& line);
+    // 字段在请求中的位置：相对于请求起点的偏移、长度
+    struct field {
+        size_t off;
+        size_t len;
+    };
 
-    void parsePath_();
-    void parsePost_();
-    void parseFromUrlEncoded_();
+    // 一个请求头
+    struct headerField {
+        field key;
+        field value;
+    };
+
+    // 一个 post 键值对，指向 Arena 中解码后的正文
+    struct postField {
+        std::string_view key;
+        std::string_view value;
+    };
+
+    bool parseRequestLine_(size_t begin, size_t end);
+    bool parseHeader_(size_t begin, size_t end);
+    void parseBody_();
 
-    static bool userVerify(const std::string& name, const std::string& pwd, bool isLogin);
+    std::string_view view_(const field& f) const;
+
+    void parsePath_(std::string_view uri);
+    void parsePost_();
+    void parseFromUrlEncoded_(char* body, size_t len);
+    void setPost_(std::string_view key, std::string_view value, bool overwrite);
 
     static int converHex(char ch);
 
+    Arena* arena_;                                          // 所属连接的 Arena，路径、正文 从中分配
+
     PARSE_STATE state_;                                     // 解析的状态
-    std::string method_, path_, version_, body_;            // 方法、路径、版本、body
-    std::unordered_map<std::string, std::string> header_;   // header 映射
-    std::unordered_map<std::string, std::string> post_;     // 记录 post 请求中的 键值对(username/password)
+    const char* base_;                                      // 请求起点，即最近一次解析时 缓冲区的读位置
+    size_t pos_;                                            // 下一行的起点
+    size_t scanPos_;                                        // 当前行 下次开始扫描换行符的位置
+    size_t contentLen_;                                     // 请求正文长度
+
+    field method_, version_;                                // 方法、版本
+    std::string_view path_, body_;                          // 路径（可能被改写）、body，在 Arena 中 或为常量
+    std::vector<headerField> header_;                       // 请求头，清空时保留容量
+    bool isKeepAlive_;                                      // 是否保持连接，解析完成时确定
+    std::vector<postField> post_;                           // 记录 post 请求中的 键值对(username/password)，清空时保留容量
+    bool needVerify_;                                       // 注册/登录请求 等待检验用户身份（访问数据库）
+    bool isLogin_;                                          // 是否为登录请求
+    int code_;                                              // 响应状态码，数据库繁忙时为 503，解析失败时为 400/413
 
     static const std::unordered_set<std::string> DEFAULT_HTML;          // 默认的 html 页面 哈希集合
     static const std::unordered_map<std::string, int> DEFAULT_HTML_TAG; // 默认的 html tag 映射
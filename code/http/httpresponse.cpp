@@ -34,6 +34,8 @@ const unordered_map<int, string> HttpResponse::CODE_STATUS {
     { 400, "Bad Request" },
     { 403, "Forbidden" },
     { 404, "Not Found" },
+    { 413, "Payload Too Large" },
+    { 503, "Service Unavailable" },
 };
 
 // 状态码 To html页面路径
@@ -41,16 +43,24 @@ const unordered_map<int, string> HttpResponse::CODE_PATH {
     { 400, "/400.html" },
     { 403, "/403.html" },
     { 404, "/404.html" },
+    { 413, "/413.html" },
+    { 503, "/503.html" },
 };
 
+size_t HttpResponse::sendfileThreshold = 0;
 
 
-HttpResponse::HttpResponse()
+
+HttpResponse::HttpResponse(Arena* arena) : arena_(arena)
 {
+    assert(arena_);
+
     code_ = -1;
     isKeepAlive_ = false;
 
     mmFile_ = nullptr;
+    fileFd_ = -1;
+    fileOffset_ = 0;
     mmFileStat_ = { 0 };
 }
 
@@ -62,21 +72,20 @@ HttpResponse::~HttpResponse()
 
 
 // 初始化
-//void init(const std::string& srcDir, std::string& path, bool isKeepAlive = false, int code = -1);
-void HttpResponse::init(const string& srcDir, string& path, bool isKeepAlive, int code)
+//void init(std::string_view srcDir, std::string_view path, bool isKeepAlive = false, int code = -1);
+void HttpResponse::init(string_view srcDir, string_view path, bool isKeepAlive, int code)
 {
-    assert(srcDir != "");
+    assert(!srcDir.empty());
 
-    // 如果 mmFile_ 不为空，先解除映射
-    if (mmFile_) {
-        unmapFile();
-    }
+    // 先释放上一个响应的资源文件
+    unmapFile();
 
     code_ = code;
     isKeepAlive_ = isKeepAlive;
 
     path_ = path;
     srcDir_ = srcDir;
+    filePath_ = string_view();
 
     mmFile_ = nullptr;
     mmFileStat_ = { 0 };
@@ -86,16 +95,18 @@ void HttpResponse::init(const string& srcDir, string& path, bool isKeepAlive, in
 // 做出响应，响应信息保存在 buff
 void HttpResponse::makeResponse(Buffer& buff)
 {
-    // 判断请求的资源文件
-    // 文件不存在 或所请求资源为目录
-    if (stat((srcDir_ + path_).data(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode)) {
-        code_ = 404;
-    }
-    else if (!(mmFileStat_.st_mode & S_IROTH)) {    // 文件权限为 other不可读，即资源不可获取
-        code_ = 403;
-    }
-    else if (code_ == -1) {                         // code_ 未设置，则成功获取资源
-        code_ = 200;
+    // 判断请求的资源文件；已确定为错误状态（请求格式错误、正文过大、数据库繁忙）时 不访问请求的资源
+    if (code_ < 400) {
+        // 文件不存在 或所请求资源为目录
+        if (!statFile_() || S_ISDIR(mmFileStat_.st_mode)) {
+            code_ = 404;
+        }
+        else if (!(mmFileStat_.st_mode & S_IROTH)) {    // 文件权限为 other不可读，即资源不可获取
+            code_ = 403;
+        }
+        else if (code_ == -1) {                         // code_ 未设置，则成功获取资源
+            code_ = 200;
+        }
     }
 
     // 处理400系列的页面
@@ -108,9 +119,30 @@ void HttpResponse::makeResponse(Buffer& buff)
 }
 
 
-// 解除 文件映射
+// 做出正文为 body 的响应（由服务器生成的内容，不读取资源文件），响应信息与正文都保存在 buff
+void HttpResponse::makeResponse(Buffer& buff, const string& body)
+{
+    code_ = 200;
+
+    addStateLine_(buff);
+    addHeader_(buff);
+
+    addContentLength_(buff, body.size());
+    buff.append(body);
+}
+
+
+// 释放资源文件：解除文件映射，释放缓存文件的引用，关闭 sendfile 的文件
 void HttpResponse::unmapFile()
 {
+    cache_.reset();
+
+    if (fileFd_ >= 0) {
+        close(fileFd_);
+        fileFd_ = -1;
+        fileOffset_ = 0;
+    }
+
     if (mmFile_) {
         munmap(mmFile_, mmFileStat_.st_size);
         mmFile_ = nullptr;
@@ -118,9 +150,12 @@ void HttpResponse::unmapFile()
 }
 
 
-// 返回 共享内存区的映射地址 mmFile_
-char* HttpResponse::file()
+// 返回 资源文件内容：缓存的文件 或共享内存区的映射地址 mmFile_
+const char* HttpResponse::file()
 {
+    if (cache_) {
+        return cache_->data.get();
+    }
     return mmFile_;
 }
 
@@ -132,29 +167,48 @@ size_t HttpResponse::fileLen() const
 }
 
 
-// 根据message、生成对应的html错误页面、写入到buff中
-void HttpResponse::errorContent(Buffer& buff, string message)
+// 返回 用 sendfile 发送的资源文件，-1 表示不使用 sendfile
+int HttpResponse::fileFd() const
 {
-    string body;    // 生成的html错误页面
-    string status;  // 状态原因信息
+    return fileFd_;
+}
 
-    body += "<html><title>Error</title>";
-    body += "<body bgcolor=\"ffffff\">";
 
-    if (CODE_STATUS.count(code_) == 1) {
-        status = CODE_STATUS.find(code_)->second;
-    }
-    else {
-        status = "Bad Request";                     // 非法请求
+// 返回 sendfile 还未发送的字节数
+size_t HttpResponse::fileRemain() const
+{
+    return fileFd_ < 0 ? 0 : mmFileStat_.st_size - fileOffset_;
+}
+
+
+// 用 sendfile 将资源文件 从 fileOffset_ 开始发送到 sockFd，数据直接从页缓存发出 不经过用户空间
+// 返回值、errno 同 sendfile；发送了部分数据（如 EAGAIN 前）时 fileOffset_ 已更新，下次从这里继续
+ssize_t HttpResponse::sendFile(int sockFd)
+{
+    assert(fileFd_ >= 0);
+    return sendfile(sockFd, fileFd_, &fileOffset_, fileRemain());
+}
+
+
+// 根据message、生成对应的html错误页面、写入到buff中（页面在 Arena 中生成）
+void HttpResponse::errorContent(Buffer& buff, string_view message)
+{
+    const char* status = "Bad Request";     // 状态原因信息，没有状态 就是非法请求
+    auto it = CODE_STATUS.find(code_);
+    if (it != CODE_STATUS.end()) {
+        status = it->second.c_str();
     }
 
-    body += to_string(code_) + " : " + status + "\n";       // 状态码 : 状态原因信息
-    body += "<p>" + message + "</p>";                       // 错误内容
-    body += "<hr><em>TinyWebServer</em></body></html>";
+    // 生成的html错误页面：状态码 : 状态原因信息，错误内容
+    size_t cap = message.size() + strlen(status) + 128;
+    char* body = arena_->alloc(cap);
+    int len = snprintf(body, cap,
+                       "<html><title>Error</title><body bgcolor=\"ffffff\">%d : %s\n<p>%.*s</p><hr><em>TinyWebServer</em></body></html>",
+                       code_, status, static_cast<int>(message.size()), message.data());
 
     // 将生成的错误信息 写入到缓冲区
-    buff.append("Content-length: " + to_string(body.size()) + "\r\n\r\n");
-    buff.append(body);
+    addContentLength_(buff, len);
+    buff.append(body, len);
 }
 
 
@@ -166,19 +220,34 @@ int HttpResponse::code() const
 
 
 // 返回 path_
-string& HttpResponse::path()
+string_view HttpResponse::path() const
 {
     return path_;
 }
 
 
+// 获取资源文件属性：命中文件缓存时 直接使用缓存的属性，否则 stat
+bool HttpResponse::statFile_()
+{
+    filePath_ = arena_->concat(srcDir_, path_);
+
+    cache_ = FileCache::instance()->find(filePath_);
+    if (cache_) {
+        mmFileStat_ = cache_->st;
+        return true;
+    }
+
+    return stat(filePath_.data(), &mmFileStat_) == 0;
+}
+
+
 // 设置400系列具体页面路径、获取资源文件属性
 void HttpResponse::errorHtml_()
 {
     // 状态码为400系列，error
     if (CODE_PATH.count(code_) == 1) {
         path_ = CODE_PATH.find(code_)->second;          // 设置对应的 具体页面路径
-        stat((srcDir_ + path_).data(), &mmFileStat_);   // 获取资源文件的 文件属性信息
+        statFile_();                                    // 获取资源文件的 文件属性信息
     }
 }
 
@@ -186,18 +255,18 @@ void HttpResponse::errorHtml_()
 // 添加 响应状态行
 void HttpResponse::addStateLine_(Buffer &buff)
 {
-    string status;      // 状态原因信息
-
-    if (CODE_STATUS.count(code_) == 1) {
-        status = CODE_STATUS.find(code_)->second;
-    }
-    else {                                      // 没有状态 就是400非法请求
+    auto it = CODE_STATUS.find(code_);
+    if (it == CODE_STATUS.end()) {          // 没有状态 就是400非法请求
         code_ = 400;
-        status = CODE_STATUS.find(400)->second;
+        it = CODE_STATUS.find(400);
     }
 
     // 生成 状态行，添加到缓冲区
-    buff.append("HTTP/1.1 " + to_string(code_) + " " + status + "\r\n");
+    char line[32];
+    int len = snprintf(line, sizeof(line), "HTTP/1.1 %d ", code_);
+    buff.append(line, len);
+    buff.append(it->second);            // 状态原因信息
+    buff.append("\r\n", 2);
 }
 
 
@@ -214,21 +283,46 @@ void HttpResponse::addHeader_(Buffer &buff)
         buff.append("close\r\n");
     }
 
-    buff.append("Content-type: " + getFileType_() + "\r\n");    // 响应的资源类型
+    buff.append("Content-type: ");  // 响应的资源类型
+    buff.append(getFileType_());
+    buff.append("\r\n", 2);
 }
 
 
 // 添加 响应正文
 void HttpResponse::addContent_(Buffer &buff)
 {
-    // 只读方式 打开资源
-    int srcFd = open((srcDir_ + path_).data(), O_RDONLY);
+    // 大文件：保持打开，发送时用 sendfile，不映射到内存
+    if (!cache_ && sendfileThreshold > 0 && static_cast<size_t>(mmFileStat_.st_size) >= sendfileThreshold) {
+        fileFd_ = open(filePath_.data(), O_RDONLY);
+        if (fileFd_ < 0) {
+            errorContent(buff, "File NotFound!");
+            return;
+        }
+
+        fileOffset_ = 0;
+        addContentLength_(buff, mmFileStat_.st_size);
+        return;
+    }
+
+    // 不在缓存中的文件 先尝试读入缓存，之后的请求 直接共享缓存中的内容
+    if (!cache_) {
+        cache_ = FileCache::instance()->load(string(filePath_), mmFileStat_);   // 读入文件的代价远大于这次拷贝
+    }
+    if (cache_) {
+        mmFileStat_ = cache_->st;
+        addContentLength_(buff, mmFileStat_.st_size);
+        return;
+    }
+
+    // 不缓存的文件（过大 或未开启缓存、不使用 sendfile），只读方式 打开资源 映射到内存
+    int srcFd = open(filePath_.data(), O_RDONLY);
     if (srcFd < 0) {
         errorContent(buff, "File NotFound!");   // 找不到资源文件
         return;
     }
 
-    LOG_DEBUG("Response file path: %s", (srcDir_ + path_).data());
+    LOG_DEBUG("Response file path: %s", filePath_.data());
 
     // 将文件映射到内存 提高文件的访问速度
     // MAP_PRIVATE 建立一个写入时拷贝的私有映射，速度更快
@@ -244,22 +338,32 @@ void HttpResponse::addContent_(Buffer &buff)
     close(srcFd);
     
     // 将文件大小信息 添加到缓冲区
-    buff.append("Content-length: " + to_string(mmFileStat_.st_size) + "\r\n\r\n");
+    addContentLength_(buff, mmFileStat_.st_size);
+}
+
+
+// 添加 正文长度 及响应头结束的空行
+void HttpResponse::addContentLength_(Buffer &buff, size_t len)
+{
+    char line[48];
+    int n = snprintf(line, sizeof(line), "Content-length: %zu\r\n\r\n", len);
+    buff.append(line, n);
 }
 
 
 // 获取文件类型，返回对应的资源类型
-string HttpResponse::getFileType_()
+string_view HttpResponse::getFileType_()
 {
     // 判断文件类型
-    string::size_type idx = path_.find_last_of('.');
-    if (idx == string::npos) {      // 没有找到 文件类型后缀
+    string_view::size_type idx = path_.find_last_of('.');
+    if (idx == string_view::npos) { // 没有找到 文件类型后缀
         return "text/plain";        // 返回空白页面
     }
 
-    string suffix = path_.substr(idx);              // 获取文件后缀
-    if (SUFFIX_TYPE.count(suffix) == 1) {
-        return SUFFIX_TYPE.find(suffix)->second;    // 返回对应的资源类型
+    string suffix(path_.substr(idx));               // 获取文件后缀（短字符串，不分配内存）
+    auto it = SUFFIX_TYPE.find(suffix);
+    if (it != SUFFIX_TYPE.end()) {
+        return it->second;                          // 返回对应的资源类型
     }
 
     return "text/plain";
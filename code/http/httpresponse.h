@@ -4,45 +4,67 @@
 #define HTTP_RESPONSE_H
 
 #include<unordered_map>
+#include<string_view>
 #include<fcntl.h>
 #include<unistd.h>
 #include<sys/stat.h>
 #include<sys/mman.h>
+#include<sys/sendfile.h>
 
 #include"../buffer/buffer.h"
+#include"../buffer/arena.hpp"
 #include"../log/log.h"
+#include"filecache.h"
 
 
+// 路径等临时数据在所属连接的 Arena 中，响应信息生成完（makeResponse 返回）后不再使用
 class HttpResponse {
 public:
-    HttpResponse();
+    explicit HttpResponse(Arena* arena);
     ~HttpResponse();
 
-    void init(const std::string& srcDir, std::string& path, bool isKeepAlive = false, int code = -1);
+    HttpResponse(const HttpResponse&) = delete;             // 持有文件映射，不可拷贝
+    HttpResponse& operator=(const HttpResponse&) = delete;
+
+    void init(std::string_view srcDir, std::string_view path, bool isKeepAlive = false, int code = -1);
     void makeResponse(Buffer& buff);
+    void makeResponse(Buffer& buff, const std::string& body);
     void unmapFile();
-    char* file();
+    const char* file();
     size_t fileLen() const;
-    void errorContent(Buffer& buff, std::string message);
+    int fileFd() const;
+    size_t fileRemain() const;
+    ssize_t sendFile(int sockFd);
+    void errorContent(Buffer& buff, std::string_view message);
     int code() const;
-    std::string& path();
+    std::string_view path() const;
+
+    static size_t sendfileThreshold;    // 资源文件不小于该大小时 用 sendfile 发送，0 表示不使用
 
 private:
+    bool statFile_();
     void errorHtml_();
     
     void addStateLine_(Buffer &buff);
     void addHeader_(Buffer &buff);
     void addContent_(Buffer &buff);
+    void addContentLength_(Buffer &buff, size_t len);
 
-    std::string getFileType_();
+    std::string_view getFileType_();
 
     int code_;                  // 要返回的http状态码
     bool isKeepAlive_;          // 是否保持连接
 
-    std::string path_;          // 具体资源所在路径
-    std::string srcDir_;        // 工作目录
+    Arena* arena_;              // 所属连接的 Arena
+
+    std::string_view path_;     // 具体资源所在路径（请求的 Arena 中，或为常量）
+    std::string_view srcDir_;   // 工作目录
+    std::string_view filePath_; // 资源文件的完整路径，在 Arena 中，以 '\0' 结尾
 
-    char* mmFile_;              // 内存区的映射地址
+    FileCache::filePtr cache_;  // 共享文件缓存中的资源文件，命中缓存时使用，不需要文件系统调用
+    char* mmFile_;              // 内存区的映射地址，资源文件不缓存（过大）时使用
+    int fileFd_;                // 用 sendfile 发送的资源文件，-1 表示不使用 sendfile
+    off_t fileOffset_;          // sendfile 下次发送的文件偏移
     struct stat mmFileStat_;    // 文件属性结构体
 
     static const std::unordered_map<std::string, std::string> SUFFIX_TYPE;  // 后缀类型To路径
@@ -8,10 +8,25 @@ using namespace std;
 Log::Log()
 {
     lineCount_ = 0;
+    toDay_ = 0;
+
+    isOpen_ = false;
+    level_.store(1);
+    isAsync_ = false;
 
     fp_ = nullptr;
 
-    deque_ = nullptr;
+    ringCapacity_ = 0;
+    wakeup_.store(false);
+    flushRequest_ = 0;
+    flushDone_ = 0;
+    isClosing_ = false;
+    droppedTotal_.store(0);
+
+    baseStamp_ = nowStamp_ = 0;
+    baseNS_ = nowNS_ = 0;
+    nsPerTick_ = 1.0;
+
     writeThread_ = nullptr;
 }
 
@@ -20,19 +35,19 @@ Log::~Log()
 {
     // 开启异步/有写线程 且写线程可被回收
     if (writeThread_ && writeThread_->joinable()) {
-
-        while (!deque_->empty()) {      // 弹出异步阻塞队列所有节点，写入所有日志
-            deque_->flush();
+        {
+            lock_guard<mutex> locker(ringsMtx_);
+            isClosing_ = true;
         }
+        cond_.notify_one();
 
-        deque_->Close();                // 关闭阻塞队列
-        writeThread_->join();           // 回收写线程
+        writeThread_->join();           // 写线程退出前 写入所有缓冲区中的日志
     }
 
     if (fp_) {
         lock_guard<mutex> locker(mtx_);
 
-        flush();                        // 刷新缓冲区、马上写入所有日志数据到文件
+        fflush(fp_);                    // 马上写入所有日志数据到文件
         fclose(fp_);                    // 关闭文件
     }
 }
@@ -42,23 +57,30 @@ Log::~Log()
 // void init(
 //         // 日志等级，日志存放路径
 //         // 日志文件后缀，异步队列容量（输入有效容量才开启异步，否则同步）
-//         int level = 1, const char* path = "./log", 
+//         int level = 1, const char* path = "./log",
 //         const char* suffix = ".log", int maxQueueCapacity = 1024);
 void Log::init(
-    int level, const char* path, 
+    int level, const char* path,
     const char* suffix, int maxQueueCapacity)
 {
     isOpen_ = true;
-    level_ = level;
+    level_.store(level);
 
     // 有效的最大容量
     if (maxQueueCapacity > 0) {
         isAsync_ = true;            // 异步
 
-        if (!deque_) {      // 阻塞队列未创建
-            // 初始化 阻塞队列
-            unique_ptr<BlockDeque<string>> newDeque(new BlockDeque<string>);
-            deque_ = move(newDeque);
+        if (!writeThread_) {        // 写线程未创建
+            // 每个线程的缓冲区大小：按队列容量（行数）估算，取 2 的幂
+            size_t want = static_cast<size_t>(maxQueueCapacity) * RING_BYTES_PER_LINE;
+            ringCapacity_ = 4096;
+            while (ringCapacity_ < want) {
+                ringCapacity_ <<= 1;
+            }
+
+            calibrate_();
+            baseStamp_ = nowStamp_;
+            baseNS_ = nowNS_;
 
             // 初始化 写线程
             unique_ptr<thread> newThread(new thread(flushLogThread));
@@ -69,44 +91,19 @@ void Log::init(
         isAsync_ = false;           // 同步
     }
 
-    //lineCount_ = 0;
-
     time_t timer = time(nullptr);               // 返回当前的时间
-    struct tm* sysTime = localtime(&timer);     // 将 time_t 转换成 struct tm，获取更多的时间信息
-    struct tm t = *sysTime;
-    
-    path_ = path;
-    suffix_ = suffix;
-    toDay_ = t.tm_mday;
-
-    // 文件名
-    char fileName[LOG_NAME_LEN] = { 0 };
-
-    // 生成日志文件的路径
-    snprintf(fileName, LOG_NAME_LEN - 1, "%s/%04d_%02d_%02d%s",
-            path_, t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, suffix_);
+    struct tm t;
+    localtime_r(&timer, &t);                    // 将 time_t 转换成 struct tm，获取更多的时间信息
 
     // 创建日志文件
     {
         lock_guard<mutex> locker(mtx_);
 
-        // 先清空缓冲区，以备后用
-        buff_.retrieveAll();
-
-        // 如果已经有指向的文件结构体，先关闭
-        if (fp_) {
-            flush();            // 刷新缓冲区、马上写入日志
-            fclose(fp_);
-        }
-
-        // 以 append 追加方式 打开日志文件，文件不存在即自动创建
-        fp_ = fopen(fileName, "a");
-        if (fp_ == nullptr) {           // 打开文件失败，可能是给定路径不是有效的目录
-            mkdir(path_, 0777);         // 先创建对应的目录
-            fp_ = fopen(fileName, "a"); // 再尝试打开文件
-        }
+        path_ = path;
+        suffix_ = suffix;
+        toDay_ = t.tm_mday;
 
-        assert(fp_ != nullptr);
+        openFile_(t);
     }
 }
 
@@ -119,166 +116,420 @@ Log* Log::instance()
 }
 
 
-// 写线程的工作函数，即不断从异步阻塞队列中取出节点数据、完成日志的写入
+// 写线程的工作函数，即不断收集各线程缓冲区中的日志、完成日志的写入
 void Log::flushLogThread()
 {
-    // 完成一次异步写，将阻塞队列中的所有内容 写入到日志文件中
     Log::instance()->AsyncWrite_();
 }
 
 
-// 写日志，level：日志等级、类型，format：附加参数的数量
+// 写日志，level：日志等级、类型，format：格式字符串，后接参数
+// 在调用线程完成格式化；异步模式下只写入本线程的缓冲区，不加任何锁
 void Log::write(int level, const char* format, ...)
 {
-    // 获取当前的精确时间，微秒级
-    struct timeval now = { 0, 0 };
-    gettimeofday(&now, nullptr);
-    
-    // 拿到秒数，转换成 更多的时间信息
-    time_t tSec = now.tv_sec;
-    struct tm* sysTime = localtime(&tSec);
-    struct tm t = *sysTime;
+    char rec[sizeof(recordHeader) + LINE_SIZE];
+    char* line = rec + sizeof(recordHeader);
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    struct tm t;
+    size_t n = formatPrefix_(line, level, now, &t);
 
     // 可变参数列表：variable arguments list，保存可变参数的信息
     va_list vaList;
+    va_start(vaList, format);
 
-    // 如果 日期发生了变化、或 刚好写够 MAX_LINES行 日志，生成新的日志文件
-    if (toDay_ != t.tm_mday || (lineCount_ && (lineCount_ % MAX_LINES == 0)))
-    {
-        unique_lock<mutex> locker(mtx_);
-        // 先解锁
-        locker.unlock();
-
-        char newFile[LOG_NAME_LEN];
-        char tail[36] = { 0 };          // 日期信息
-        snprintf(tail, 36, "%04d_%02d_%02d", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+    // 将格式化数据 写入到缓冲区，超长时截断；留出换行符的位置
+    int m = vsnprintf(line + n, LINE_SIZE - n - 1, format, vaList);
+    va_end(vaList);
 
-        // 生成日志文件路径，路径+日期信息+日志数+后缀
-        if (toDay_ != t.tm_mday) {      // 日期发生变化的情况
-            snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s%s", path_, tail, suffix_);
-            toDay_ = t.tm_mday;         // 更新日期
-            lineCount_ = 0;
-        }
-        else {                          // 写满日志的情况
-            snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s-%d%s", path_, tail, (lineCount_ / MAX_LINES), suffix_);
-        }
-
-        // 加锁
-        locker.lock();
+    if (m > 0) {
+        n += min(static_cast<size_t>(m), LINE_SIZE - n - 2);
+    }
+    line[n++] = '\n';
 
-        flush();                    // 刷新缓冲区、马上写入日志到文件
-        fclose(fp_);                // 关闭旧日志文件
-        fp_ = fopen(newFile, "a");  // 打开新日志文件
+    if (isAsync_) {     // 已格式化的一行日志，format 为空
+        recordHeader header;
+        memset(&header, 0, sizeof(header));
+        header.size = sizeof(header) + n;
+        header.level = level;
+        memcpy(rec, &header, sizeof(header));
 
-        assert(fp_ != nullptr);
+        push_(rec, header.size);
     }
+    else {      // 同步，马上写入到日志文件中
+        lock_guard<mutex> locker(mtx_);
 
-    // 正常的写日志
-    {
-        unique_lock<mutex> locker(mtx_);
-
-        // 增加写日志行数
-        ++lineCount_;
-
-        // 写入：年-月-日 hour:min:sec.usec
-        int n = snprintf(buff_.beginWrite(), 128, "%d-%02d-%02d %02d:%02d:%02d.%06ld ",
-                        t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
-                        t.tm_hour, t.tm_min, t.tm_sec, now.tv_usec);
-        buff_.hasWritten(n);        // 移动写缓冲区指针
-
-        // 缓冲区添加日志类型标头
-        appendLogLevelTitle_(level);
-
-        // 初始化 va_list，传入附加参数的数量
-        va_start(vaList, format);
-        
-        // 将格式化数据 写入到缓冲区
-        int m = vsnprintf(buff_.beginWrite(), buff_.writableBytes(), format, vaList);
-        
-        // 停止使用 va_list，销毁 va_list
-        va_end(vaList);
-
-        buff_.hasWritten(m);        // 移动写缓冲区指针
-        buff_.append("\n\0", 2);    // 输出一个换行符
-
-        // 异步 且队列未满
-        if (isAsync_ && deque_ && !deque_->full()) {
-            deque_->push_back(buff_.retrieveAllToStr());    // 先将缓冲区数据添加进异步阻塞队列，再等待flush写入
-        }
-        else {      // 同步 或异步阻塞队列已满
-            fputs(buff_.peek(), fp_);                       // 马上将缓冲区的数据写出到日志文件中
-        }
-
-        // 完成一次写日志，清空缓冲区
-        buff_.retrieveAll();
+        writeLines_(line, n, t);
+        fflush(fp_);
     }
 }
 
 
-// 如果异步、弹出异步阻塞队列所有节点，刷新系统缓冲区
+// 马上写入所有日志：异步时 等待写线程完成一次刷新，同步时 刷新系统缓冲区
 void Log::flush()
 {
-    // 如果开启异步，弹出阻塞队列所有节点
-    if (isAsync_) {
-        deque_->flush();
+    if (isAsync_ && writeThread_) {
+        unique_lock<mutex> locker(ringsMtx_);
+
+        uint64_t request = ++flushRequest_;
+        cond_.notify_one();
+
+        flushedCond_.wait(locker, [this, request] {
+            return flushDone_ >= request || isClosing_;
+        });
+        return;
     }
 
-    // 马上刷新一次系统缓冲区，写入所有未写入的数据
-    fflush(fp_);
+    lock_guard<mutex> locker(mtx_);
+    if (fp_) {
+        fflush(fp_);
+    }
 }
 
 
-// 返回 日志等级/类型
-int Log::getLevel()
+// 本线程的缓冲区，第一次写日志时创建并注册
+Log::threadRing* Log::localRing_()
 {
-    lock_guard<mutex> locker(mtx_);
+    static thread_local ringHolder holder;
 
-    return level_;
+    if (!holder.ring) {
+        threadRing* ring = new threadRing(ringCapacity_);
+        {
+            lock_guard<mutex> locker(ringsMtx_);
+            rings_.emplace_back(ring);
+        }
+        holder.ring = ring;
+    }
+    return holder.ring;
 }
 
 
-// 设置 日志等级/类型
-void Log::setLevel(int level)
+// 放入本线程的缓冲区
+void Log::push_(const char* rec, size_t size)
 {
-    lock_guard<mutex> locker(mtx_);
+    threadRing* ring = localRing_();
+    size_t used = ring->push(rec, size);
+    if (used == 0) {
+        // 缓冲区满（写线程跟不上），丢弃这条日志，由写线程记录丢弃的行数
+        if (ring->dropped.fetch_add(1, memory_order_relaxed) == 0) {
+            wakeup_.store(true);
+            cond_.notify_one();
+        }
+        return;
+    }
 
-    level_ = level;
+    // 缓冲区刚超过一半，提前唤醒写线程（不加锁通知，错过时 最多等一个刷新周期）
+    size_t half = ring->capacity / 2;
+    if (used >= half && used - size < half) {
+        wakeup_.store(true);
+        cond_.notify_one();
+    }
 }
 
 
-// 添加日志等级标题
-void Log::appendLogLevelTitle_(int level)
+// 生成日志行的开头：年-月-日 hour:min:sec.usec [level]: ，返回长度；t 为 ts 对应的日期时间
+size_t Log::formatPrefix_(char* line, int level, const struct timespec& ts, struct tm* t)
+{
+    // 同一秒内 复用本线程上次转换的日期时间，localtime_r 每秒最多调用一次
+    static thread_local time_t cachedSec = -1;
+    static thread_local struct tm cachedTm;
+    static thread_local char cachedTime[32];
+    static thread_local size_t cachedLen = 0;
+
+    if (ts.tv_sec != cachedSec) {
+        time_t tSec = ts.tv_sec;
+        localtime_r(&tSec, &cachedTm);
+        cachedLen = snprintf(cachedTime, sizeof(cachedTime), "%d-%02d-%02d %02d:%02d:%02d.",
+                            cachedTm.tm_year + 1900, cachedTm.tm_mon + 1, cachedTm.tm_mday,
+                            cachedTm.tm_hour, cachedTm.tm_min, cachedTm.tm_sec);
+        cachedSec = tSec;
+    }
+    *t = cachedTm;
+
+    // 日期时间
+    size_t n = cachedLen;
+    memcpy(line, cachedTime, n);
+
+    // 微秒，6 位
+    long usec = ts.tv_nsec / 1000;
+    for (int i = 5; i >= 0; --i) {
+        line[n + i] = '0' + usec % 10;
+        usec /= 10;
+    }
+    n += 6;
+    line[n++] = ' ';
+
+    // 日志类型标头
+    memcpy(line + n, levelTitle_(level), 9);
+    n += 9;
+
+    return n;
+}
+
+
+// 日志等级标题，长度均为 9
+const char* Log::levelTitle_(int level)
 {
     switch (level)
     {
     case 0:
-        buff_.append("[debug]: ", 9);
-        break;
+        return "[debug]: ";
     case 1:
-        buff_.append("[info]:  ", 9);
-        break;
+        return "[info]:  ";
     case 2:
-        buff_.append("[warn]:  ", 9);
-        break;
+        return "[warn]:  ";
     case 3:
-        buff_.append("[error]: ", 9);
-        break;
+        return "[error]: ";
     default:
-        buff_.append("[info]:  ", 9);
-        break;
+        return "[info]:  ";
+    }
+}
+
+
+// 收集所有线程缓冲区中的日志记录到 recordBuff_，回收已退出线程的缓冲区；返回各缓冲区丢弃的行数之和
+size_t Log::collect_()
+{
+    size_t dropped = 0;
+
+    lock_guard<mutex> locker(ringsMtx_);
+
+    for (size_t i = 0; i < rings_.size(); ) {
+        threadRing* ring = rings_[i].get();
+
+        bool closed = ring->closed.load(memory_order_acquire);     // 先看是否已退出，再读出，保证读完了全部内容
+        ring->drainTo(recordBuff_);
+        dropped += ring->dropped.exchange(0, memory_order_relaxed);
+
+        if (closed) {
+            rings_[i] = move(rings_.back());
+            rings_.pop_back();
+        }
+        else {
+            ++i;
+        }
     }
+
+    return dropped;
 }
 
 
-// 异步写，写线程工作使用的函数；拿到异步阻塞队列节点的数据 输出到日志文件中
+// 记录当前的原始时间戳与实际时间，由 init() 以来的时间 更新换算比例
+void Log::calibrate_()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    nowStamp_ = rawTime_();
+    nowNS_ = static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+
+    if (nowStamp_ > baseStamp_ && baseNS_ > 0) {
+        nsPerTick_ = static_cast<double>(nowNS_ - baseNS_) / (nowStamp_ - baseStamp_);
+    }
+}
+
+
+// 原始时间戳 换算为实际时间：以最近一次 calibrate_() 为基准往前推
+struct timespec Log::toRealTime_(uint64_t stamp)
+{
+    int64_t ns = nowNS_ - static_cast<int64_t>((static_cast<int64_t>(nowStamp_ - stamp)) * nsPerTick_);
+
+    struct timespec ts;
+    ts.tv_sec = ns / 1000000000;
+    ts.tv_nsec = ns % 1000000000;
+    return ts;
+}
+
+
+// 把收集到的日志记录 格式化为日志行，追加到 writeBuff_
+void Log::decodeRecords_()
+{
+    const char* p = recordBuff_.peek();
+    const char* end = p + recordBuff_.readableBytes();
+    struct tm t;
+
+    while (p < end) {
+        recordHeader header;
+        memcpy(&header, p, sizeof(header));     // 记录在缓冲区中不一定对齐，复制出来
+        const char* body = p + sizeof(header);
+
+        if (header.format == nullptr) {         // 已格式化的日志行
+            writeBuff_.append(body, header.size - sizeof(header));
+        }
+        else {
+            writeBuff_.ensureWritable(LINE_SIZE);
+            char* line = writeBuff_.beginWrite();
+
+            size_t n = formatPrefix_(line, header.level, toRealTime_(header.stamp), &t);
+            int m = header.decode(line + n, LINE_SIZE - n - 1, header.format, body);
+            if (m > 0) {
+                n += min(static_cast<size_t>(m), LINE_SIZE - n - 2);
+            }
+            line[n++] = '\n';
+
+            writeBuff_.hasWritten(n);
+        }
+
+        p += header.size;
+    }
+
+    recordBuff_.retrieveAll();
+}
+
+
+// 写入若干完整的日志行，t 为当前日期时间；日期变化、或刚好写够 MAX_LINES 行日志时 切换到新的日志文件
+// 需持有 mtx_
+void Log::writeLines_(const char* data, size_t len, const struct tm& t)
+{
+    while (len > 0) {
+        if (toDay_ != t.tm_mday || (lineCount_ && (lineCount_ % MAX_LINES == 0))) {
+            openFile_(t);
+        }
+
+        // 当前文件还能写入的行数，找到对应的位置
+        int room = MAX_LINES - lineCount_ % MAX_LINES;
+        const char* end = data + len;
+        const char* p = data;
+        int lines = 0;
+        while (lines < room && p < end) {
+            const char* lf = static_cast<const char*>(memchr(p, '\n', end - p));
+            p = lf ? lf + 1 : end;
+            ++lines;
+        }
+
+        fwrite(data, 1, p - data, fp_);
+        lineCount_ += lines;
+
+        len -= p - data;
+        data = p;
+    }
+}
+
+
+// 打开日志文件：路径/日期+后缀，写满 MAX_LINES 行后为 路径/日期-序号+后缀
+// 需持有 mtx_
+void Log::openFile_(const struct tm& t)
+{
+    if (toDay_ != t.tm_mday) {      // 日期发生变化
+        toDay_ = t.tm_mday;         // 更新日期
+        lineCount_ = 0;
+    }
+
+    char fileName[LOG_NAME_LEN] = { 0 };
+    char tail[36] = { 0 };          // 日期信息
+    snprintf(tail, 36, "%04d_%02d_%02d", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+
+    if (lineCount_ < MAX_LINES) {
+        snprintf(fileName, LOG_NAME_LEN - 72, "%s/%s%s", path_, tail, suffix_);
+    }
+    else {
+        snprintf(fileName, LOG_NAME_LEN - 72, "%s/%s-%d%s", path_, tail, (lineCount_ / MAX_LINES), suffix_);
+    }
+
+    // 如果已经有指向的文件结构体，先关闭
+    if (fp_) {
+        fflush(fp_);
+        fclose(fp_);
+    }
+
+    // 以 append 追加方式 打开日志文件，文件不存在即自动创建
+    fp_ = fopen(fileName, "a");
+    if (fp_ == nullptr) {           // 打开文件失败，可能是给定路径不是有效的目录
+        mkdir(path_, 0777);         // 先创建对应的目录
+        fp_ = fopen(fileName, "a"); // 再尝试打开文件
+    }
+
+    assert(fp_ != nullptr);
+}
+
+
+// 异步写，写线程工作使用的函数
+// 每个刷新周期（或被唤醒时）收集所有线程缓冲区中的日志，一次 fwrite 写入日志文件
 void Log::AsyncWrite_()
 {
-    string str;
-    // 只要异步阻塞队列没有关闭，就弹出队列的节点；弹出需要等到消费者条件变量
-    while (deque_->pop(str)) {              // 只有这一个地方调用了pop，因此队列为空阻塞时、只要调用flush就可继续写
+    unique_lock<mutex> locker(ringsMtx_);
+
+    while (true) {
+        cond_.wait_for(locker, chrono::milliseconds(FLUSH_INTERVAL_MS), [this] {
+            return isClosing_ || flushRequest_ != flushDone_ || wakeup_.load();
+        });
+        wakeup_.store(false);
+        uint64_t request = flushRequest_;
+        bool closing = isClosing_;
+        locker.unlock();
 
-        lock_guard<mutex> locker(mtx_);
-    
-        fputs(str.c_str(), fp_);            // 将弹出的所有节点的数据 写入到日志文件
+        size_t dropped = collect_();
+        if (dropped > 0) {      // 记录丢弃的行数（写入本线程的缓冲区，马上再收集一次）
+            droppedTotal_.fetch_add(dropped, memory_order_relaxed);
+            write(2, "Log: %zu lines dropped, log buffer full", dropped);
+            collect_();
+        }
+        calibrate_();           // 收集之后取基准，所有记录的时间戳都不晚于它
+        decodeRecords_();
+
+        if (writeBuff_.readableBytes() > 0) {
+            time_t timer = time(nullptr);
+            struct tm t;
+            localtime_r(&timer, &t);
+
+            lock_guard<mutex> fileLocker(mtx_);
+
+            writeLines_(writeBuff_.peek(), writeBuff_.readableBytes(), t);
+            fflush(fp_);
+        }
+        writeBuff_.retrieveAll();
+
+        locker.lock();
+        flushDone_ = request;
+        flushedCond_.notify_all();
+
+        if (closing) {
+            break;
+        }
+    }
+}
+
+
+Log::threadRing::threadRing(size_t cap)
+    : data(new char[cap]), capacity(cap), head(0), tail(0), dropped(0), closed(false)
+{
+    assert(cap > 0 && (cap & (cap - 1)) == 0);
+}
+
+
+// 放入一条记录，只由所属线程调用
+size_t Log::threadRing::push(const char* src, size_t len)
+{
+    size_t t = tail.load(memory_order_relaxed);
+    size_t h = head.load(memory_order_acquire);
+    if (capacity - (t - h) < len) {
+        return 0;
     }
+
+    // 可能绕回缓冲区开头，分两段复制
+    size_t pos = t & (capacity - 1);
+    size_t first = min(len, capacity - pos);
+    memcpy(data.get() + pos, src, first);
+    memcpy(data.get(), src + first, len - first);
+
+    tail.store(t + len, memory_order_release);
+    return t + len - h;
+}
+
+
+// 读出全部内容，只由写线程调用
+void Log::threadRing::drainTo(Buffer& buff)
+{
+    size_t h = head.load(memory_order_relaxed);
+    size_t t = tail.load(memory_order_acquire);
+    size_t len = t - h;
+    if (len == 0) {
+        return;
+    }
+
+    size_t pos = h & (capacity - 1);
+    size_t first = min(len, capacity - pos);
+    buff.append(data.get() + pos, first);
+    buff.append(data.get(), len - first);
+
+    head.store(t, memory_order_release);
 }
@@ -1,76 +1,275 @@
-
-
 #ifndef LOG_H
 #define LOG_H
 
 #include<mutex>
 #include<string>
 #include<thread>
+#include<atomic>
+#include<memory>
+#include<vector>
+#include<tuple>
+#include<type_traits>
+#include<condition_variable>
+#include<time.h>
 #include<sys/time.h>
 #include<string.h>
+#include<stdint.h>
 #include<stdarg.h>
 #include<assert.h>
 #include<sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include<x86intrin.h>
+#endif
 
-#include"blockqueue.hpp"
 #include"../buffer/buffer.h"
 
 
+// 日志参数的二进制保存：算术类型、枚举、指针按值保存
+template<class T, class Enable = void>
+struct logArg {
+    static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value,
+                  "log argument must be arithmetic, enum, pointer or C string");
+
+    typedef T type;
+
+    static size_t size(const T&) { return sizeof(T); }
+    static char* encode(char* p, const T& v) { memcpy(p, &v, sizeof(T)); return p + sizeof(T); }
+    static T decode(const char*& p) { T v; memcpy(&v, p, sizeof(T)); p += sizeof(T); return v; }
+};
+
+// C 字符串：调用返回后可能失效，复制内容（长度 + 内容 + '\0'），格式化时指向记录中的副本
+template<class T>
+struct logArg<T, typename std::enable_if<std::is_same<T, const char*>::value || std::is_same<T, char*>::value>::type> {
+    typedef const char* type;
+
+    static const uint32_t NULL_STR = UINT32_MAX;
+
+    static size_t size(const char* s) { return sizeof(uint32_t) + (s ? strlen(s) + 1 : 0); }
+
+    static char* encode(char* p, const char* s) {
+        uint32_t len = s ? strlen(s) : NULL_STR;
+        memcpy(p, &len, sizeof(len));
+        p += sizeof(len);
+        if (s) {
+            memcpy(p, s, len + 1);
+            p += len + 1;
+        }
+        return p;
+    }
+
+    static const char* decode(const char*& p) {
+        uint32_t len;
+        memcpy(&len, p, sizeof(len));
+        p += sizeof(len);
+        if (len == NULL_STR) {
+            return nullptr;
+        }
+        const char* s = p;
+        p += len + 1;
+        return s;
+    }
+};
+
+
+// 异步日志：每个线程把日志记录写入自己的环形缓冲区（单生产者单消费者，无锁）
+// 后台写线程每个刷新周期（或某个缓冲区过半时）收集所有线程的日志，一次 fwrite 写入文件
+// 缓冲区满时丢弃日志并计数，不阻塞工作线程；同步模式下 每行加锁直接写入文件
+// LOG_XXX 使用延迟格式化：只记录 格式字符串指针、时间戳、参数的二进制值，由写线程格式化
 class Log {
 public:
     void init(
         // 日志等级，日志存放路径
         // 日志文件后缀，异步队列容量（输入有效容量才开启异步，否则同步）
-        int level = 1, const char* path = "./log", 
+        int level = 1, const char* path = "./log",
         const char* suffix = ".log", int maxQueueCapacity = 1024);
-    
+
     static Log* instance();
     static void flushLogThread();
 
     void write(int level, const char* format, ...);
     void flush();
 
-    int getLevel();
-    void setLevel(int level);
+    // 延迟格式化：异步模式下只保存 格式字符串指针、时间戳与参数，由写线程调用 snprintf
+    // format 必须在程序运行期间一直有效（字符串字面量）；Deferrable 为 false 时 马上格式化
+    template<bool Deferrable = true, class... Args>
+    void record(int level, const char* format, Args... args) {
+        if (!Deferrable || !isAsync_) {     // 同步，直接格式化
+            write(level, format, args...);
+            return;
+        }
+
+        size_t size = sizeof(recordHeader) + argsSize_(args...);
+        if (size > LINE_SIZE) {             // 参数太长，直接格式化
+            write(level, format, args...);
+            return;
+        }
+
+        char rec[LINE_SIZE];
+        recordHeader header;
+        header.size = size;
+        header.level = level;
+        header.stamp = rawTime_();
+        header.format = format;
+        header.decode = &decode_<Args...>;
+        memcpy(rec, &header, sizeof(header));
+
+        char* p = rec + sizeof(header);
+        (void)p;
+        ((p = logArg<Args>::encode(p, args)), ...);
+
+        push_(rec, size);
+    }
+
+    // 格式字符串能否延迟格式化：参数中有 * 宽度/精度（如 %.*s）时 字符串不以 '\0' 结尾，不能只按 C 字符串复制
+    static constexpr bool deferrable(const char* format) {
+        for (const char* p = format; *p; ++p) {
+            if (*p == '*') {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 日志等级为原子变量，写日志前的检查不加锁
+    int getLevel() { return level_.load(std::memory_order_relaxed); }
+    void setLevel(int level) { level_.store(level, std::memory_order_relaxed); }
     bool isOpen() { return isOpen_; }
+    size_t droppedLines() { return droppedTotal_.load(std::memory_order_relaxed); }    // 缓冲区满丢弃的总行数
 
 private:
     Log();
     virtual ~Log();
-    void appendLogLevelTitle_(int level);
+
+    // 日志记录的头部，后接参数（延迟格式化）或 一行已格式化的日志（format 为空）
+    struct recordHeader {
+        uint32_t size;              // 整条记录的字节数，含头部
+        int32_t level;              // 日志等级
+        uint64_t stamp;             // 原始时间戳 rawTime_()，由写线程换算为日期时间
+        const char* format;         // 格式字符串
+        int (*decode)(char* out, size_t size, const char* format, const char* args);  // 还原参数 并格式化
+    };
+
+    // 从记录中按顺序还原参数，调用 snprintf
+    template<class... Args>
+    static int decode_(char* out, size_t size, const char* format, [[maybe_unused]] const char* args) {
+        std::tuple<typename logArg<Args>::type...> values{ logArg<Args>::decode(args)... };     // 花括号初始化 保证按顺序求值
+        return std::apply([out, size, format](auto... v) {
+            return snprintf(out, size, format, v...);
+        }, values);
+    }
+
+    // 原始时间戳：x86 上为 TSC 计数（不需要系统调用、不换算），其他平台为 CLOCK_REALTIME 纳秒
+    static uint64_t rawTime_() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+    }
+
+    template<class... Args>
+    static size_t argsSize_(const Args&... args) {
+        return (size_t(0) + ... + logArg<Args>::size(args));
+    }
+
+    // 线程的日志缓冲区：环形，只有本线程写入、后台写线程读出
+    struct threadRing {
+        explicit threadRing(size_t cap);
+
+        size_t push(const char* src, size_t len);   // 生产者：放入一条记录，返回放入后未读出的字节数，空间不够时返回 0
+        void drainTo(Buffer& buff);                 // 消费者：读出全部内容
+
+        std::unique_ptr<char[]> data;
+        const size_t capacity;                      // 容量，2 的幂
+
+        alignas(64) std::atomic<size_t> head;       // 读位置，只由后台写线程修改
+        alignas(64) std::atomic<size_t> tail;       // 写位置，只由所属线程修改
+        std::atomic<size_t> dropped;                // 缓冲区满 丢弃的行数
+        std::atomic<bool> closed;                   // 所属线程已退出，读完后回收
+    };
+
+    // 线程局部变量：本线程的缓冲区，线程退出时标记缓冲区关闭
+    struct ringHolder {
+        ~ringHolder() {
+            if (ring) {
+                ring->closed.store(true, std::memory_order_release);
+            }
+        }
+        threadRing* ring = nullptr;
+    };
+
+    threadRing* localRing_();
+    void push_(const char* rec, size_t size);
+    size_t formatPrefix_(char* line, int level, const struct timespec& ts, struct tm* t);
+    void calibrate_();
+    struct timespec toRealTime_(uint64_t stamp);
+    void decodeRecords_();
+    static const char* levelTitle_(int level);
+    size_t collect_();
+    void writeLines_(const char* data, size_t len, const struct tm& t);
+    void openFile_(const struct tm& t);
     void AsyncWrite_();         // 异步写
 
 
     static const int LOG_PATH_LEN = 256;    // 日志文件路径最大长度
     static const int LOG_NAME_LEN = 256;    // 日志文件名的最大长度
     static const int MAX_LINES = 50000;     // 单个日志文件的最大写入行数
+    static const int LINE_SIZE = 2048;      // 单行日志的最大长度，超出截断
+    static const int RING_BYTES_PER_LINE = 128;     // 按每行的平均长度，由异步队列容量（行数）计算缓冲区大小
+    static constexpr int FLUSH_INTERVAL_MS = 1000;  // 后台写线程的刷新周期
 
     const char* path_;      // 日志文件路径
     const char* suffix_;    // 文件后缀名
-    
+
     int lineCount_;     // 写入日志总行数
     int toDay_;         // 当前日期（day）
 
     bool isOpen_;       // 文件是否打开
-    
-    Buffer buff_;       // 缓冲区
-    int level_;         // 日志等级
+
+    std::atomic<int> level_;    // 日志等级
     bool isAsync_;      // 是否开启异步
 
     FILE* fp_;          // 日志文件结构体指针
-    std::unique_ptr<BlockDeque<std::string>> deque_;    // 异步阻塞队列，开启异步才使用
+    std::mutex mtx_;    // 保护日志文件
+
+    size_t ringCapacity_;                               // 每个线程的缓冲区大小
+    std::vector<std::unique_ptr<threadRing>> rings_;    // 所有线程的缓冲区
+    std::mutex ringsMtx_;                               // 保护 rings_ 及以下的写线程状态（线程第一次写日志时注册，不在写日志的路径上）
+    std::condition_variable cond_;                      // 唤醒写线程
+    std::condition_variable flushedCond_;               // 写线程完成了一次刷新
+    std::atomic<bool> wakeup_;                          // 有缓冲区过半，需要尽快刷新
+    uint64_t flushRequest_;                             // flush() 请求的刷新次数
+    uint64_t flushDone_;                                // 写线程已完成的请求
+    bool isClosing_;                                    // 写线程退出
+    std::atomic<size_t> droppedTotal_;                  // 丢弃的总行数
+
+    uint64_t baseStamp_;                                // 时间戳换算：init() 时的原始时间戳 与 实际时间（纳秒）
+    int64_t baseNS_;
+    uint64_t nowStamp_;                                 // 本次收集后的原始时间戳 与 实际时间
+    int64_t nowNS_;
+    double nsPerTick_;                                  // 每个原始时间戳单位的纳秒数
+
+    Buffer recordBuff_;                                 // 写线程收集日志记录用的缓冲区
+    Buffer writeBuff_;                                  // 格式化后的日志，一次写入文件
     std::unique_ptr<std::thread> writeThread_;          // 写线程，开启异步才使用
-    std::mutex mtx_;
 };
 
 
-// 完成一次写日志操作，即生成一行日志信息、并马上写入到文件
+// 编译期的最低日志等级，低于它的 LOG_XXX 整个不编译（包括参数的求值），如 make LOG_MIN_LEVEL=1 去掉所有 DEBUG 日志
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+// 完成一次写日志操作；异步模式下只记录格式字符串、时间戳和参数，由后台写线程格式化并批量写入文件
 #define LOG_BASE(level, format, ...) \
     do {\
-        Log* log = Log::instance();\
-        if (log->isOpen() && log->getLevel() <= level) {\
-            log->write(level, format, ##__VA_ARGS__);\
-            log->flush();\
+        if constexpr ((level) >= LOG_MIN_LEVEL) {\
+            Log* log = Log::instance();\
+            if (log->isOpen() && log->getLevel() <= level) {\
+                log->record<Log::deferrable(format)>(level, format, ##__VA_ARGS__);\
+            }\
         }\
     } while(0);
 
@@ -0,0 +1,211 @@
+
+
+#include"metrics.h"
+using namespace std;
+
+
+const char* Metrics::PATH = "/__metrics";
+
+
+Metrics::threadStats::threadStats()
+{
+    accepts.store(0);
+    sentBytes.store(0);
+    for (int i = 0; i < MAX_CODE; ++i) {
+        codes[i].store(0);
+    }
+    for (int s = 0; s < STAGE_COUNT; ++s) {
+        for (int i = 0; i < BUCKETS; ++i) {
+            stages[s].buckets[i].store(0);
+        }
+        stages[s].count.store(0);
+        stages[s].sumNS.store(0);
+    }
+}
+
+
+// 单例模式：局部静态变量的懒汉模式
+Metrics* Metrics::instance()
+{
+    static Metrics inst;
+    return &inst;
+}
+
+
+// 接受了一个新连接
+void Metrics::onAccept()
+{
+    add_(local_()->accepts, 1);
+}
+
+
+// 生成了一个状态码为 code 的响应
+void Metrics::onResponse(int code)
+{
+    if (code >= 0 && code < MAX_CODE) {
+        add_(local_()->codes[code], 1);
+    }
+}
+
+
+// 发送了 bytes 字节
+void Metrics::onSent(size_t bytes)
+{
+    add_(local_()->sentBytes, bytes);
+}
+
+
+// 记录 count 次 耗时为 ns 的 stage 阶段
+void Metrics::record(STAGE stage, int64_t ns, uint64_t count)
+{
+    histogram& h = local_()->stages[stage];
+    add_(h.buckets[bucket_(ns)], count);
+    add_(h.count, count);
+    add_(h.sumNS, static_cast<uint64_t>(ns > 0 ? ns : 0) * count);
+}
+
+
+// 注册一个当前值指标，输出时调用 value 获取
+void Metrics::addGauge(const string& name, const string& help, function<double()> value)
+{
+    lock_guard<mutex> locker(mtx_);
+    gauges_.push_back({ name, help, move(value), false });
+}
+
+
+// 注册一个计数器指标（由其他模块维护 只增不减），输出时调用 value 获取
+void Metrics::addCounter(const string& name, const string& help, function<double()> value)
+{
+    lock_guard<mutex> locker(mtx_);
+    gauges_.push_back({ name, help, move(value), true });
+}
+
+
+// 移除所有注册的指标（回调引用的对象即将销毁）
+void Metrics::clearGauges()
+{
+    lock_guard<mutex> locker(mtx_);
+    gauges_.clear();
+}
+
+
+// 汇总所有线程的计数，生成 Prometheus 文本格式
+string Metrics::render()
+{
+    static const char* STAGE_NAME[STAGE_COUNT] = { "parse", "process", "write", "total", "sql_wait" };
+
+    uint64_t accepts = 0;
+    uint64_t sentBytes = 0;
+    vector<uint64_t> codes(MAX_CODE, 0);
+    vector<uint64_t> buckets(STAGE_COUNT * BUCKETS, 0);
+    uint64_t count[STAGE_COUNT] = { 0 };
+    uint64_t sumNS[STAGE_COUNT] = { 0 };
+
+    string out;
+    char line[256];
+
+    lock_guard<mutex> locker(mtx_);
+
+    for (const unique_ptr<threadStats>& st : stats_) {
+        accepts += st->accepts.load(memory_order_relaxed);
+        sentBytes += st->sentBytes.load(memory_order_relaxed);
+        for (int i = 0; i < MAX_CODE; ++i) {
+            codes[i] += st->codes[i].load(memory_order_relaxed);
+        }
+        for (int s = 0; s < STAGE_COUNT; ++s) {
+            for (int i = 0; i < BUCKETS; ++i) {
+                buckets[s * BUCKETS + i] += st->stages[s].buckets[i].load(memory_order_relaxed);
+            }
+            count[s] += st->stages[s].count.load(memory_order_relaxed);
+            sumNS[s] += st->stages[s].sumNS.load(memory_order_relaxed);
+        }
+    }
+
+    // 注册的当前值、计数器
+    for (const gauge& g : gauges_) {
+        snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n%s %.15g\n",
+                g.name.c_str(), g.help.c_str(), g.name.c_str(), g.isCounter ? "counter" : "gauge", g.name.c_str(), g.value());
+        out += line;
+    }
+
+    // 计数器，每秒的速率由 Prometheus 的 rate() 计算
+    snprintf(line, sizeof(line), "# HELP webserver_accepts_total Accepted connections.\n"
+            "# TYPE webserver_accepts_total counter\nwebserver_accepts_total %lu\n", accepts);
+    out += line;
+
+    snprintf(line, sizeof(line), "# HELP webserver_sent_bytes_total Bytes sent to clients.\n"
+            "# TYPE webserver_sent_bytes_total counter\nwebserver_sent_bytes_total %lu\n", sentBytes);
+    out += line;
+
+    out += "# HELP webserver_responses_total Responses by status code.\n# TYPE webserver_responses_total counter\n";
+    for (int i = 0; i < MAX_CODE; ++i) {
+        if (codes[i] > 0) {
+            snprintf(line, sizeof(line), "webserver_responses_total{code=\"%d\"} %lu\n", i, codes[i]);
+            out += line;
+        }
+    }
+
+    // 延迟直方图，桶的计数为累计值
+    out += "# HELP webserver_stage_duration_seconds Request handling latency by stage.\n"
+            "# TYPE webserver_stage_duration_seconds histogram\n";
+    for (int s = 0; s < STAGE_COUNT; ++s) {
+        uint64_t cumulative = 0;
+        for (int i = 0; i < BUCKETS - 1; ++i) {
+            cumulative += buckets[s * BUCKETS + i];
+            snprintf(line, sizeof(line), "webserver_stage_duration_seconds_bucket{stage=\"%s\",le=\"%.9g\"} %lu\n",
+                    STAGE_NAME[s], bucketBound_(i) / 1e9, cumulative);
+            out += line;
+        }
+        snprintf(line, sizeof(line), "webserver_stage_duration_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %lu\n"
+                "webserver_stage_duration_seconds_sum{stage=\"%s\"} %.9g\n"
+                "webserver_stage_duration_seconds_count{stage=\"%s\"} %lu\n",
+                STAGE_NAME[s], count[s], STAGE_NAME[s], sumNS[s] / 1e9, STAGE_NAME[s], count[s]);
+        out += line;
+    }
+
+    return out;
+}
+
+
+// ns 所在的桶：0 号桶 < 2^MIN_EXP，之后每个 2 的幂区间 [2^e, 2^(e+1)) 有 SUB_BUCKETS 个桶，最后一个桶为溢出
+int Metrics::bucket_(int64_t ns)
+{
+    if (ns < (int64_t(1) << MIN_EXP)) {
+        return 0;
+    }
+
+    int e = 63 - __builtin_clzll(static_cast<uint64_t>(ns));
+    if (e >= MAX_EXP) {
+        return BUCKETS - 1;
+    }
+
+    int sub = (ns >> (e - SUB_BITS)) & (SUB_BUCKETS - 1);
+    return 1 + (e - MIN_EXP) * SUB_BUCKETS + sub;
+}
+
+
+// 第 idx 个桶的上界（纳秒）
+int64_t Metrics::bucketBound_(int idx)
+{
+    if (idx == 0) {
+        return int64_t(1) << MIN_EXP;
+    }
+
+    int e = MIN_EXP + (idx - 1) / SUB_BUCKETS;
+    int sub = (idx - 1) % SUB_BUCKETS;
+    return (int64_t(1) << e) + (int64_t(sub + 1) << (e - SUB_BITS));
+}
+
+
+// 本线程的计数，第一次记录时创建并注册
+Metrics::threadStats* Metrics::local_()
+{
+    static thread_local threadStats* stats = nullptr;
+
+    if (!stats) {
+        stats = new threadStats;
+        lock_guard<mutex> locker(mtx_);
+        stats_.emplace_back(stats);
+    }
+    return stats;
+}
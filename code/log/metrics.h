@@ -0,0 +1,102 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include<string>
+#include<vector>
+#include<memory>
+#include<atomic>
+#include<mutex>
+#include<functional>
+#include<time.h>
+#include<stdint.h>
+
+
+// 服务器运行指标，由 /__metrics 以 Prometheus 文本格式输出
+// 计数器与延迟直方图 每个线程一份，只由本线程写入（不加锁、不用原子的读-改-写），输出时汇总所有线程
+// 连接数、队列长度等当前值，以及其他模块自己维护的计数器 由注册的回调函数在输出时获取
+class Metrics {
+public:
+    // 请求处理的各阶段
+    enum STAGE {
+        PARSE,          // 解析一个请求
+        PROCESS,        // 生成一个响应（查找资源文件、生成响应信息）
+        WRITE,          // 一轮响应 从生成完 到全部发送完
+        TOTAL,          // 一个请求 从读到数据 到响应全部发送完
+        SQL_WAIT,       // 等待一个空闲的数据库连接
+        STAGE_COUNT
+    };
+
+    static Metrics* instance();
+
+    void onAccept();
+    void onResponse(int code);
+    void onSent(size_t bytes);
+    void record(STAGE stage, int64_t ns, uint64_t count = 1);
+
+    void addGauge(const std::string& name, const std::string& help, std::function<double()> value);
+    void addCounter(const std::string& name, const std::string& help, std::function<double()> value);
+    void clearGauges();
+
+    std::string render();
+
+    // 单调时钟，纳秒
+    static int64_t nowNS() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    static const char* PATH;        // 输出指标的请求路径
+
+private:
+    Metrics() = default;
+    ~Metrics() = default;
+
+    // 对数-线性分桶（HDR 风格）：每个 2 的幂区间 再等分为 SUB_BUCKETS 个桶，相对误差不超过 1/SUB_BUCKETS
+    static const int SUB_BITS = 2;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int MIN_EXP = 10;          // 第一个桶：< 2^10 ns（约 1us）
+    static const int MAX_EXP = 35;          // 最后一个有上界的桶：< 2^35 ns（约 34s），更大的值计入 +Inf
+    static const int BUCKETS = 1 + (MAX_EXP - MIN_EXP) * SUB_BUCKETS + 1;
+    static const int MAX_CODE = 600;        // 状态码 [0, 600)
+
+    struct histogram {
+        std::atomic<uint64_t> buckets[BUCKETS];
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sumNS;
+    };
+
+    // 一个线程的计数，按缓存行对齐 避免伪共享
+    struct alignas(64) threadStats {
+        threadStats();
+
+        std::atomic<uint64_t> accepts;
+        std::atomic<uint64_t> sentBytes;
+        std::atomic<uint64_t> codes[MAX_CODE];
+        histogram stages[STAGE_COUNT];
+    };
+
+    // 注册的指标：当前值（gauge），或只增不减的计数器（counter，名称以 _total 结尾）
+    struct gauge {
+        std::string name;
+        std::string help;
+        std::function<double()> value;
+        bool isCounter;
+    };
+
+    // 只由所属线程修改，不需要原子的读-改-写
+    static void add_(std::atomic<uint64_t>& v, uint64_t n) {
+        v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static int bucket_(int64_t ns);
+    static int64_t bucketBound_(int idx);
+    threadStats* local_();
+
+    std::vector<std::unique_ptr<threadStats>> stats_;   // 所有线程的计数，线程退出后保留
+    std::vector<gauge> gauges_;
+    std::mutex mtx_;                                    // 保护 stats_、gauges_（线程第一次记录时注册，不在记录的路径上）
+};
+
+
+#endif  // METRICS_H
@@ -10,7 +10,13 @@ int main() {
     WebServer server(
         12345, 3, 60000, false,                  // 监听端口，ET模式，timeoutMs，优雅退出
         3306, "root", "Kjr22165.", "yourdb",     // Mysql：端口，用户名，密码，数据库名
-        12, 6, true, 1, 1024                     // 连接池大小，线程池大小，日志开关、等级、异步队列容量
+        12, 6, true, 1, 1024,                    // 连接池大小，线程池大小，日志开关、等级、异步队列容量
+        1, 0,                                    // Reactor数量：1为单Reactor+线程池，>1为多Reactor（SO_REUSEPORT）
+                                                 // IO后端：0为epoll，1为io_uring
+        64, 256,                                 // 静态文件缓存大小（MB），0为不缓存
+                                                 // 不小于该大小（KB）的资源文件用 sendfile 发送，0为不使用
+        4,                                       // 连接池最少连接数：空闲时收缩到该数量，繁忙时增加到连接池大小
+        nullptr                                  // 账号文件：nullptr 为使用 MySQL，否则账号存放在进程内并追加写入该文件
     );
 
     server.start();
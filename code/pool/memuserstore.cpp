@@ -0,0 +1,209 @@
+
+#include"memuserstore.h"
+using namespace std;
+
+
+MemUserStore::MemUserStore() : fd_(-1)
+{
+}
+
+
+MemUserStore::~MemUserStore()
+{
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+
+// 打开账号文件 path（不存在则创建），重放其中的记录；path 为空时只保存在内存中
+// 文件末尾不完整的记录（写入时进程退出）被截掉；中间有损坏的记录时 返回 false，不修改文件
+bool MemUserStore::open(const string& path)
+{
+    if (path.empty()) {
+        return true;
+    }
+
+    int fd = ::open(path.data(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        LOG_ERROR("MemUserStore: open %s error!", path.data());
+        return false;
+    }
+
+    // 读取整个文件
+    string data;
+    char buf[65536];
+    ssize_t len;
+    while ((len = read(fd, buf, sizeof(buf))) > 0) {
+        data.append(buf, len);
+    }
+    if (len < 0) {
+        LOG_ERROR("MemUserStore: read %s error!", path.data());
+        close(fd);
+        return false;
+    }
+
+    size_t valid = 0;
+    if (!load_(data, valid)) {
+        LOG_ERROR("MemUserStore: %s has a corrupt record at offset %zu, not loaded", path.data(), valid);
+        close(fd);
+        return false;
+    }
+    if (valid < data.size()) {
+        LOG_WARN("MemUserStore: %s has %zu trailing bytes of an incomplete record, truncated", path.data(), data.size() - valid);
+        if (ftruncate(fd, valid) != 0) {
+            LOG_ERROR("MemUserStore: truncate %s error!", path.data());
+            close(fd);
+            return false;
+        }
+    }
+
+    fd_ = fd;
+    LOG_INFO("MemUserStore: %zu users loaded from %s", size(), path.data());
+    return true;
+}
+
+
+// 登录：比较密码；注册：用户名未被使用时 先追加到文件，再加入哈希表
+// 同一分片的检查与插入在一把锁内完成，同一用户名的并发注册只有一个成功
+UserStore::RESULT MemUserStore::verify(const string& name, const string& pwd, bool isLogin, int)
+{
+    shard& s = shard_(name);
+    lock_guard<mutex> locker(s.mtx);
+
+    auto it = s.users.find(name);
+    if (isLogin) {
+        return (it != s.users.end() && it->second == pwd) ? OK : FAIL;
+    }
+
+    if (it != s.users.end()) {      // 用户名已被使用
+        return FAIL;
+    }
+    if (!append_(name, pwd)) {      // 写文件失败，不能保证重启后仍存在
+        return BUSY;
+    }
+    s.users.emplace(name, pwd);
+    return OK;
+}
+
+
+// 账号总数
+size_t MemUserStore::size()
+{
+    size_t n = 0;
+    for (shard& s : shards_) {
+        lock_guard<mutex> locker(s.mtx);
+        n += s.users.size();
+    }
+    return n;
+}
+
+
+MemUserStore::shard& MemUserStore::shard_(const string& name)
+{
+    return shards_[hash<string>()(name) % SHARDS];
+}
+
+
+// 解析 pos 处的一条记录：用户名长度:密码长度:用户名密码\n（用户名、密码可以包含任意字节）
+// 完整时 name、pwd 为用户名、密码的位置，end 为下一条记录的位置
+MemUserStore::RECORD MemUserStore::parseRecord_(const string& data, size_t pos, size_t& name, size_t& pwd, size_t& end)
+{
+    size_t len[2] = { 0, 0 };
+    size_t p = pos;
+
+    // 解析 两个长度
+    for (size_t& n : len) {
+        size_t start = p;
+        while (p < data.size() && data[p] >= '0' && data[p] <= '9' && p - start < 10) {
+            n = n * 10 + (data[p] - '0');
+            ++p;
+        }
+        if (p >= data.size()) {                 // 记录头不完整
+            return RECORD_TORN;
+        }
+        if (p == start || data[p] != ':') {     // 记录头损坏
+            return RECORD_BAD;
+        }
+        ++p;
+    }
+
+    if (data.size() - p < len[0] + len[1] + 1) {   // 记录不完整
+        return RECORD_TORN;
+    }
+    if (data[p + len[0] + len[1]] != '\n') {       // 记录损坏
+        return RECORD_BAD;
+    }
+
+    name = p;
+    pwd = p + len[0];
+    end = pwd + len[1] + 1;
+    return RECORD_OK;
+}
+
+
+// 重放文件内容，valid 返回完整记录的总长度
+// 只有文件结尾 不完整的记录（写入时进程退出，是一条记录的前一部分）可以截掉；
+// 中间的记录损坏时返回 false，不能截断文件（之后的记录仍有效）
+bool MemUserStore::load_(const string& data, size_t& valid)
+{
+    size_t pos = 0;
+    while (pos < data.size()) {
+        size_t name, pwd, end;
+        RECORD res = parseRecord_(data, pos, name, pwd, end);
+        if (res != RECORD_OK) {
+            valid = pos;
+            return res == RECORD_TORN && isTornTail_(data, pos);
+        }
+
+        string user = data.substr(name, pwd - name);
+        shard_(user).users[user] = data.substr(pwd, end - 1 - pwd);
+        pos = end;
+    }
+
+    valid = pos;
+    return true;
+}
+
+
+// pos 之后的内容 是否为写入中断留下的 一条记录的前一部分：
+// 不比一条记录长，且之后不再有完整的记录（长度损坏的记录 看起来也不完整，但之后还有有效的记录）
+bool MemUserStore::isTornTail_(const string& data, size_t pos)
+{
+    if (data.size() - pos > MAX_RECORD) {
+        return false;
+    }
+
+    for (size_t i = pos; i < data.size(); ++i) {
+        size_t name, pwd, end;
+        if (data[i] == '\n' && parseRecord_(data, i + 1, name, pwd, end) == RECORD_OK) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// 追加一条记录到文件；没有文件时直接成功
+// 一次 write 写入整条记录，写入不完整时截掉，不留下半条记录
+bool MemUserStore::append_(const string& name, const string& pwd)
+{
+    if (fd_ < 0) {
+        return true;
+    }
+
+    string record = to_string(name.size()) + ":" + to_string(pwd.size()) + ":" + name + pwd + "\n";
+
+    lock_guard<mutex> locker(fileMtx_);
+
+    off_t end = lseek(fd_, 0, SEEK_END);
+    ssize_t len = write(fd_, record.data(), record.size());
+    if (len != static_cast<ssize_t>(record.size())) {
+        LOG_ERROR("MemUserStore: append error!");
+        if (len > 0 && end >= 0 && ftruncate(fd_, end) != 0) {
+            LOG_ERROR("MemUserStore: truncate error!");
+        }
+        return false;
+    }
+    return true;
+}
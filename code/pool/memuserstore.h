@@ -0,0 +1,61 @@
+
+#ifndef MEM_USER_STORE_H
+#define MEM_USER_STORE_H
+
+#include<string>
+#include<unordered_map>
+#include<mutex>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/stat.h>
+
+#include"userstore.hpp"
+#include"../log/log.h"
+
+
+// 进程内的用户账号存储，不需要数据库：按用户名哈希分片的哈希表，每个分片一把锁
+// 注册时把记录追加到文件（只追加，不修改），启动时重放文件恢复全部账号
+// 不阻塞（没有网络访问，追加写只进入页缓存），在解析请求时直接完成注册/登录
+class MemUserStore : public UserStore {
+public:
+    MemUserStore();
+    ~MemUserStore();
+
+    bool open(const std::string& path);
+
+    RESULT verify(const std::string& name, const std::string& pwd, bool isLogin, int timeoutMS) override;
+    bool isBlocking() const override { return false; }
+
+    size_t size();
+
+private:
+    // 一个分片，按缓存行对齐 避免伪共享
+    struct alignas(64) shard {
+        std::mutex mtx;
+        std::unordered_map<std::string, std::string> users;     // 用户名 To 密码
+    };
+
+    // 账号文件中 一条记录的解析结果
+    enum RECORD {
+        RECORD_OK,          // 完整的记录
+        RECORD_TORN,        // 不完整，到文件结尾为止 是一条记录的前一部分
+        RECORD_BAD,         // 损坏
+    };
+
+    shard& shard_(const std::string& name);
+    static RECORD parseRecord_(const std::string& data, size_t pos, size_t& name, size_t& pwd, size_t& end);
+    bool load_(const std::string& data, size_t& valid);
+    static bool isTornTail_(const std::string& data, size_t pos);
+    bool append_(const std::string& name, const std::string& pwd);
+
+    static const int SHARDS = 16;       // 分片数
+    static const size_t MAX_RECORD = 1 << 17;   // 一条记录的最大长度（用户名、密码来自请求正文，正文不超过 64KB）
+
+    shard shards_[SHARDS];
+
+    int fd_;                // 追加写的文件，-1 表示不持久化
+    std::mutex fileMtx_;    // 保证每条记录完整写入、不与其他记录交错
+};
+
+
+#endif  // MEM_USER_STORE_H
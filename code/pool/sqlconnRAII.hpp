@@ -10,11 +10,12 @@
 class SqlConnRAII {
 public:
     // 在构造函数中申请内存资源，即从连接池中获取一个 mysql 连接对象；sql 为传入传出参数
-    SqlConnRAII(MYSQL** sql, SqlConnPool* connPool) {
+    // timeoutMS 为最多等待的时间（-1 一直等待），超时 *sql 为空
+    SqlConnRAII(MYSQL** sql, SqlConnPool* connPool, int timeoutMS = -1) {
 
         assert(connPool);
 
-        *sql = connPool->getConn();
+        *sql = connPool->getConn(timeoutMS);
         sql_ = *sql;
         connPool_ = connPool;
     }
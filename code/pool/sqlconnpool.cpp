@@ -13,38 +13,83 @@ SqlConnPool* SqlConnPool::instance()
 
 
 // 从连接队列中 获取一个连接
-MYSQL* SqlConnPool::getConn()
+// timeoutMS：-1 一直等待，0 不等待，>0 最多等待的时间；超时返回空，由调用者处理（如返回 503）
+// 没有空闲连接时 唤醒后台线程建立新连接（不超过最多连接数）；数据库不可用（没有任何连接、且建立连接失败）时不等待，直接返回空
+// 等待时间记录在运行指标中，用于估计 连接池的大小是否合适；等待超时 与 数据库不可用 分别计数
+MYSQL* SqlConnPool::getConn(int timeoutMS)
 {
     MYSQL* sql = nullptr;
+    bool down = false;
+    int64_t start = Metrics::nowNS();
 
-    // 连接队列为空
-    if (connQue_.empty()) {
-        LOG_WARN("SqlConnPool busy!");
-        return nullptr;                 // 返回空后 将中断程序，UserVerify函数中有断言
-    }
+    {
+        unique_lock<mutex> locker(mtx_);
 
-    // 等待信号量
-    sem_wait(&semId_);
+        if (connQue_.empty() && !isDown_ && timeoutMS != 0) {
+            ++waiters_;
+            maintainCond_.notify_one();
 
-    // 获取连接队列头节点
-    {
-        lock_guard<mutex> locker(mtx_);
-        sql = connQue_.front();
-        connQue_.pop();
+            auto ready = [this] { return !connQue_.empty() || isDown_ || isClose_; };
+            if (timeoutMS < 0) {
+                cond_.wait(locker, ready);
+            }
+            else {
+                cond_.wait_for(locker, chrono::milliseconds(timeoutMS), ready);
+            }
+            --waiters_;
+        }
+
+        if (!connQue_.empty()) {
+            sql = connQue_.back();      // 最近放回的连接，最可能仍然可用
+            connQue_.pop_back();
+        }
+        else {
+            down = isDown_;
+        }
     }
 
+    Metrics::instance()->record(Metrics::SQL_WAIT, Metrics::nowNS() - start);
+
+    if (!sql && down) {         // 数据库不可用
+        unavailables_.fetch_add(1, memory_order_relaxed);
+        LOG_WARN("SqlConnPool: database unavailable!");
+    }
+    else if (!sql) {            // 超时
+        timeouts_.fetch_add(1, memory_order_relaxed);
+        LOG_WARN("SqlConnPool busy!");
+    }
     return sql;
 }
 
 
-// 将 sql 添加回数据库池连接队列，重新等待使用需求
+// 将 sql 添加回数据库池连接队列，重新等待使用需求；使用中出错的连接 交给后台线程检查
 void SqlConnPool::freeConn(MYSQL* sql)
 {
     assert(sql);
 
     lock_guard<mutex> locker(mtx_);
-    connQue_.push(sql);
-    sem_post(&semId_);              // 增加信号量，唤醒等待的进程
+
+    connInfo* info = conns_.at(sql).get();
+    if (info->broken) {
+        brokenQue_.push_back(sql);
+        maintainCond_.notify_one();
+        return;
+    }
+
+    info->lastUsed = info->lastCheck = Clock::now();
+    connQue_.push_back(sql);
+    cond_.notify_one();         // 唤醒等待的线程
+}
+
+
+// 标记 持有的连接 sql 出错（连接可能已断开）：关闭其上的预处理语句，放回时由后台线程 ping 检查，不可用则重连
+void SqlConnPool::markBroken(MYSQL* sql)
+{
+    assert(sql);
+
+    connInfo* info = info_(sql);
+    resetStmts_(info);
+    info->broken = true;
 }
 
 
@@ -56,59 +101,139 @@ int SqlConnPool::getFreeConnCount()
 }
 
 
+// 返回 正在使用（已被取出、尚未放回）的连接数量
+int SqlConnPool::getInUseConnCount()
+{
+    lock_guard<mutex> locker(mtx_);
+    return connCount_ - connQue_.size() - brokenQue_.size();
+}
+
+
+// 返回 当前的连接总数
+int SqlConnPool::getConnCount()
+{
+    lock_guard<mutex> locker(mtx_);
+    return connCount_;
+}
+
+
+// 返回 获取连接超时的次数
+uint64_t SqlConnPool::getTimeoutCount()
+{
+    return timeouts_.load(memory_order_relaxed);
+}
+
+
+// 返回 数据库不可用、未等待就返回空的次数
+uint64_t SqlConnPool::getUnavailableCount()
+{
+    return unavailables_.load(memory_order_relaxed);
+}
+
+
+// 返回 检查失败、被关闭的连接数
+uint64_t SqlConnPool::getBrokenCount()
+{
+    return brokens_.load(memory_order_relaxed);
+}
+
+
+// 返回 连接 sql 上 query 的预处理语句，首次使用时在该连接上预处理并缓存，失败返回空
+// 调用者必须持有 sql（从 getConn 获取、尚未 freeConn）
+MYSQL_STMT* SqlConnPool::getStmt(MYSQL* sql, const char* query)
+{
+    assert(sql && query);
+
+    stmtList& list = info_(sql)->stmts;
+    for (auto& item : list) {
+        if (item.first == query) {
+            return item.second;
+        }
+    }
+
+    MYSQL_STMT* stmt = mysql_stmt_init(sql);
+    if (!stmt) {
+        LOG_ERROR("MySql stmt init error!");
+        return nullptr;
+    }
+    if (mysql_stmt_prepare(stmt, query, strlen(query)) != 0) {
+        LOG_ERROR("MySql prepare error: %s", mysql_stmt_error(stmt));
+        mysql_stmt_close(stmt);
+        return nullptr;
+    }
+
+    list.emplace_back(query, stmt);
+    return stmt;
+}
+
+
 // 初始化
 // void init(
 //         // 主机IP，端口
 //         // 用户名，密码
-//         // 数据库名，连接数
+//         // 数据库名，最多连接数，最少连接数（0 表示与最多连接数相同）
 //         const char* host, int port,
 //         const char* user, const char* pwd,
-//         const char* dbName, int connSize = 10);
+//         const char* dbName, int connSize = 10, int minConn = 0);
+// 先建立最少连接数个连接；连接失败不退出，由后台线程继续重试
 void SqlConnPool::init(
     const char* host, int port,
     const char* user, const char* pwd,
-    const char* dbName, int connSize)
+    const char* dbName, int connSize, int minConn)
 {
     assert(connSize > 0);
 
-    for (int i = 0; i < connSize; ++i) {
-        
-        // 初始化 一个 mysql 连接的实例对象
-        MYSQL* sql = nullptr;
-        sql = mysql_init(sql);
-        if (!sql) {
-            LOG_ERROR("MySql init error!");
-            assert(sql);
-        }
+    host_ = host;
+    port_ = port;
+    user_ = user;
+    pwd_ = pwd;
+    dbName_ = dbName;
+
+    MAX_CONN_ = connSize;                                                   // 设置最多连接数
+    MIN_CONN_ = (minConn <= 0 || minConn > connSize) ? connSize : minConn;  // 设置最少连接数
 
-        // 连接到 mysql 服务器
-        sql = mysql_real_connect(sql, host, user, pwd, dbName, port, nullptr, 0);
+    for (int i = 0; i < MIN_CONN_; ++i) {
+        MYSQL* sql = connect_();
         if (!sql) {
-            LOG_ERROR("MySql connect error!");
-            assert(sql);
+            break;
         }
 
         // 连接成功，将 sql 添加到 连接队列中
-        connQue_.push(sql);
+        lock_guard<mutex> locker(mtx_);
+        conns_[sql].reset(new connInfo{ stmtList(), false, Clock::now(), Clock::now() });
+        connQue_.push_back(sql);
+        ++connCount_;
     }
 
-    MAX_CONN_ = connSize;   // 设置最大可连接数
-
-    // 初始化信号量
-    sem_init(&semId_, 0, static_cast<unsigned int>(MAX_CONN_));
+    // 后台线程：按需建立连接、检查空闲连接、重连
+    maintainer_ = thread(&SqlConnPool::maintain_, this);
 }
 
 
 // 关闭 sql连接池
 void SqlConnPool::closePool()
 {
+    {
+        lock_guard<mutex> locker(mtx_);
+        isClose_ = true;
+    }
+    maintainCond_.notify_all();
+    cond_.notify_all();
+    if (maintainer_.joinable()) {
+        maintainer_.join();
+    }
+
     lock_guard<mutex> locker(mtx_);
 
-    // 关闭当前所有的 mysql 连接
-    while (!connQue_.empty()) {
-        mysql_close(connQue_.front());  // 关闭 mysql 连接
-        connQue_.pop();
+    // 关闭当前所有空闲的 mysql 连接，及其上的预处理语句
+    for (MYSQL* sql : connQue_) {
+        close_(sql);
     }
+    for (MYSQL* sql : brokenQue_) {
+        close_(sql);
+    }
+    connQue_.clear();
+    brokenQue_.clear();
 
     // 关闭 mysql 函数库调用，释放相关内存
     mysql_library_end();
@@ -116,7 +241,8 @@ void SqlConnPool::closePool()
 
 
 
-SqlConnPool::SqlConnPool()
+SqlConnPool::SqlConnPool() : port_(0), MAX_CONN_(0), MIN_CONN_(0), connCount_(0), waiters_(0),
+    isDown_(false), isClose_(false), timeouts_(0), unavailables_(0), brokens_(0)
 { }
 
 
@@ -124,3 +250,163 @@ SqlConnPool::~SqlConnPool()
 {
     closePool();
 }
+
+
+// 建立一个新连接，失败返回空；不加锁，可能阻塞到连接超时
+MYSQL* SqlConnPool::connect_()
+{
+    // 初始化 一个 mysql 连接的实例对象
+    MYSQL* sql = mysql_init(nullptr);
+    if (!sql) {
+        LOG_ERROR("MySql init error!");
+        return nullptr;
+    }
+
+    // 数据库无响应时 连接、ping 不会一直阻塞后台线程
+    unsigned int connectTimeout = 3, rwTimeout = 10;
+    mysql_options(sql, MYSQL_OPT_CONNECT_TIMEOUT, &connectTimeout);
+    mysql_options(sql, MYSQL_OPT_READ_TIMEOUT, &rwTimeout);
+    mysql_options(sql, MYSQL_OPT_WRITE_TIMEOUT, &rwTimeout);
+
+    // 连接到 mysql 服务器
+    if (!mysql_real_connect(sql, host_.data(), user_.data(), pwd_.data(), dbName_.data(), port_, nullptr, 0)) {
+        LOG_ERROR("MySql connect error: %s", mysql_error(sql));
+        mysql_close(sql);
+        return nullptr;
+    }
+    return sql;
+}
+
+
+// 关闭连接 sql 及其上的预处理语句，调用者持有 mtx_
+void SqlConnPool::close_(MYSQL* sql)
+{
+    auto it = conns_.find(sql);
+    if (it != conns_.end()) {
+        resetStmts_(it->second.get());
+        conns_.erase(it);
+    }
+    mysql_close(sql);
+    --connCount_;
+}
+
+
+// 连接 sql 的状态，在连接关闭前地址不变
+SqlConnPool::connInfo* SqlConnPool::info_(MYSQL* sql)
+{
+    lock_guard<mutex> locker(mtx_);
+    return conns_.at(sql).get();
+}
+
+
+// 关闭连接上所有预处理语句（连接断开或重连后 语句在服务器端已失效），下次使用时重新预处理
+void SqlConnPool::resetStmts_(connInfo* info)
+{
+    for (auto& item : info->stmts) {
+        mysql_stmt_close(item.second);
+    }
+    info->stmts.clear();
+}
+
+
+// 后台线程：每 MAINTAIN_MS，或有请求等待连接、有连接出错时
+//   1. 检查出错的连接：ping 成功则放回，否则关闭
+//   2. 关闭空闲过久的多余连接，ping 检查空闲较久的连接，不可用的关闭
+//   3. 连接数少于最少连接数，或有请求在等待且未达到最多连接数时，建立新连接
+// 所有网络操作都在锁外进行；建立连接失败时 等到下一个周期再重试
+void SqlConnPool::maintain_()
+{
+    unique_lock<mutex> locker(mtx_);
+    bool failed = false;
+
+    while (!isClose_) {
+        if (failed) {
+            maintainCond_.wait_for(locker, chrono::milliseconds(MAINTAIN_MS), [this] { return isClose_; });
+        }
+        else {
+            maintainCond_.wait_for(locker, chrono::milliseconds(MAINTAIN_MS), [this] {
+                return isClose_ || !brokenQue_.empty() || (waiters_ > 0 && connQue_.empty() && connCount_ < MAX_CONN_);
+            });
+        }
+        if (isClose_) {
+            break;
+        }
+        failed = false;
+
+        // 取出要检查的连接：出错的，以及空闲超过 PING_IDLE_MS 的；多余的空闲连接直接关闭
+        Clock::time_point now = Clock::now();
+        vector<MYSQL*> checks;
+        checks.swap(brokenQue_);
+
+        while (!connQue_.empty()) {
+            MYSQL* sql = connQue_.front();
+            connInfo* info = conns_.at(sql).get();
+
+            if (connCount_ > MIN_CONN_ && now - info->lastUsed > chrono::milliseconds(SHRINK_IDLE_MS)) {
+                connQue_.pop_front();
+                close_(sql);
+            }
+            else if (now - info->lastCheck > chrono::milliseconds(PING_IDLE_MS)) {
+                connQue_.pop_front();
+                checks.push_back(sql);
+            }
+            else {
+                break;                  // 队头的连接空闲最久，之后的不需要检查
+            }
+        }
+
+        // 锁外 ping
+        if (!checks.empty()) {
+            vector<bool> alive(checks.size());
+            locker.unlock();
+            for (size_t i = 0; i < checks.size(); ++i) {
+                alive[i] = (mysql_ping(checks[i]) == 0);
+            }
+            locker.lock();
+
+            for (size_t i = 0; i < checks.size(); ++i) {
+                MYSQL* sql = checks[i];
+                if (alive[i]) {
+                    connInfo* info = conns_.at(sql).get();
+                    info->broken = false;
+                    info->lastCheck = Clock::now();
+                    connQue_.push_front(sql);       // 仍按空闲时间排在前面
+                }
+                else {
+                    LOG_WARN("SqlConnPool: connection lost, reconnect");
+                    brokens_.fetch_add(1, memory_order_relaxed);
+                    close_(sql);
+                }
+            }
+            cond_.notify_all();
+        }
+
+        // 建立新连接：补足最少连接数，或满足等待的请求
+        while (!isClose_ && (connCount_ < MIN_CONN_ || (waiters_ > 0 && connQue_.empty() && connCount_ < MAX_CONN_))) {
+            ++connCount_;               // 先占位，锁外建立连接
+            locker.unlock();
+            MYSQL* sql = connect_();
+            locker.lock();
+
+            if (!sql) {
+                --connCount_;
+                failed = true;
+                break;
+            }
+            conns_[sql].reset(new connInfo{ stmtList(), false, Clock::now(), Clock::now() });
+            connQue_.push_back(sql);
+            cond_.notify_one();
+        }
+
+        // 建立连接失败、且没有任何连接时 数据库不可用，等待的请求 直接返回
+        // 还有连接在使用中时（如连接数达到数据库的 max_connections）不算不可用，它们放回后 等待的请求仍能取得
+        bool down = failed && connCount_ == 0;
+        if (down != isDown_) {
+            isDown_ = down;
+            LOG_WARN("SqlConnPool: database %s", down ? "unavailable" : "available");
+        }
+        if (isDown_) {
+            cond_.notify_all();
+        }
+    }
+}
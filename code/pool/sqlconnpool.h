@@ -5,29 +5,46 @@
 
 #include<mysql/mysql.h>
 #include<string>
-#include<queue>
+#include<deque>
+#include<vector>
+#include<memory>
+#include<unordered_map>
 #include<mutex>
-#include<semaphore.h>
+#include<condition_variable>
+#include<string.h>
 #include<thread>
+#include<atomic>
+#include<chrono>
 
 #include"../log/log.h"
+#include"../log/metrics.h"
 
 
+// 数据库连接池：连接数在 [最少连接数, 最多连接数] 之间伸缩
+// 建立新连接、检查空闲连接（ping）、重连断开的连接 都由后台线程完成，不在请求的路径上
 class SqlConnPool {
 public:
     static SqlConnPool* instance();
 
-    MYSQL* getConn();
+    MYSQL* getConn(int timeoutMS = -1);
     void freeConn(MYSQL* conn);
+    void markBroken(MYSQL* sql);
     int getFreeConnCount();
+    int getInUseConnCount();
+    int getConnCount();
+    uint64_t getTimeoutCount();
+    uint64_t getUnavailableCount();
+    uint64_t getBrokenCount();
+
+    MYSQL_STMT* getStmt(MYSQL* sql, const char* query);
 
     void init(
         // 主机IP，端口
         // 用户名，密码
-        // 数据库名，连接数
+        // 数据库名，最多连接数，最少连接数（0 表示与最多连接数相同）
         const char* host, int port,
         const char* user, const char* pwd,
-        const char* dbName, int connSize = 10);
+        const char* dbName, int connSize = 10, int minConn = 0);
 
     void closePool();
 
@@ -35,11 +52,56 @@ private:
     SqlConnPool();
     ~SqlConnPool();
 
-    unsigned int MAX_CONN_;                  // 最大连接数
+    typedef std::chrono::steady_clock Clock;
+
+    // 每个连接上已预处理的语句：SQL 文本 To 语句句柄，首次使用时创建
+    typedef std::vector<std::pair<std::string, MYSQL_STMT*>> stmtList;
+
+    // 一个连接的状态；连接同一时刻只被一个线程持有，stmts、broken 只由持有者访问
+    struct connInfo {
+        stmtList stmts;
+        bool broken;                // 使用中出错，放回时交给后台线程检查
+        Clock::time_point lastUsed; // 上次放回连接池的时间
+        Clock::time_point lastCheck;// 上次确认连接可用的时间（放回 或 ping 成功）
+    };
+
+    MYSQL* connect_();
+    void close_(MYSQL* sql);
+    connInfo* info_(MYSQL* sql);
+    void resetStmts_(connInfo* info);
+    void maintain_();
+
+    static constexpr int PING_IDLE_MS = 5000;    // 空闲超过该时间的连接 由后台线程 ping 检查
+    static constexpr int SHRINK_IDLE_MS = 60000; // 多于最少连接数时，空闲超过该时间的连接被关闭
+    static constexpr int MAINTAIN_MS = 1000;     // 后台线程的检查周期
+
+    // 连接参数
+    std::string host_;
+    int port_;
+    std::string user_;
+    std::string pwd_;
+    std::string dbName_;
+
+    int MAX_CONN_;                  // 最多连接数
+    int MIN_CONN_;                  // 最少连接数
+
+    std::deque<MYSQL*> connQue_;    // 空闲连接，从队尾取出、放回队尾，队头的连接空闲最久
+    std::vector<MYSQL*> brokenQue_; // 出错的连接，等待后台线程检查、重连
+    int connCount_;                 // 当前连接数（空闲 + 使用中 + 等待重连 + 后台线程正在检查的）
+    int waiters_;                   // 正在等待空闲连接的线程数，后台线程据此建立新连接
+    bool isDown_;                   // 最近一次建立连接失败、且没有任何连接，此时没有空闲连接的请求 不再等待
+    bool isClose_;
+
+    std::unordered_map<MYSQL*, std::unique_ptr<connInfo>> conns_;   // 所有连接的状态
+
+    std::mutex mtx_;                        // 保护以上所有成员（connInfo 的内容除外）
+    std::condition_variable cond_;          // 有空闲连接
+    std::condition_variable maintainCond_;  // 唤醒后台线程
+    std::thread maintainer_;                // 后台线程
 
-    std::queue<MYSQL*> connQue_;    // 连接队列
-    std::mutex mtx_;                
-    sem_t semId_;                   // 信号量
+    std::atomic<uint64_t> timeouts_;    // 等待超时、未获取到连接的次数
+    std::atomic<uint64_t> unavailables_;// 数据库不可用、未获取到连接的次数
+    std::atomic<uint64_t> brokens_;     // 检查失败、被关闭（之后重新建立）的连接数
 };
 
 
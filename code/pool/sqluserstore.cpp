@@ -0,0 +1,402 @@
+
+#include"sqluserstore.h"
+using namespace std;
+
+
+const char* const SqlUserStore::SELECT_USER_SQL = "SELECT password FROM user WHERE username = ? LIMIT 1";
+const char* const SqlUserStore::ISOLATION_SQL = "SET TRANSACTION ISOLATION LEVEL REPEATABLE READ";
+
+
+SqlUserStore::SqlUserStore() : isClose_(false), batches_(0), batchRows_(0)
+{
+    // 生成 1 ~ BATCH_ROWS 行的语句
+    lockSqls_.resize(BATCH_ROWS + 1);
+    insertSqls_.resize(BATCH_ROWS + 1);
+    string in, values;
+    for (int n = 1; n <= BATCH_ROWS; ++n) {
+        in += (n == 1) ? "?" : ", ?";
+        values += (n == 1) ? "(?, ?)" : ", (?, ?)";
+        lockSqls_[n] = "SELECT username, password FROM user WHERE username IN (" + in + ") FOR UPDATE";
+        insertSqls_[n] = "INSERT IGNORE INTO user(username, password) VALUES" + values;
+    }
+
+    flusher_ = thread(&SqlUserStore::flushLoop_, this);
+}
+
+
+SqlUserStore::~SqlUserStore()
+{
+    {
+        lock_guard<mutex> locker(mtx_);
+        isClose_ = true;
+    }
+    cond_.notify_one();
+    flusher_.join();        // 写完已提交的注册后退出
+}
+
+
+// 检验用户身份：阻塞地访问数据库，只在数据库线程中调用
+// timeoutMS 为等待空闲连接的最长时间（-1 一直等待），超时返回 BUSY
+UserStore::RESULT SqlUserStore::verify(const string& name, const string& pwd, bool isLogin, int timeoutMS)
+{
+    RESULT res;
+    if (lookup_(name, pwd, isLogin, timeoutMS, &res)) {
+        return res;
+    }
+
+    // 等待所在的一批写入完成
+    promise<RESULT> written;
+    future<RESULT> result = written.get_future();
+    insert_(name, pwd, [&written](RESULT r) { written.set_value(r); });
+    return result.get();
+}
+
+
+// 异步检验用户身份：查询在调用线程（数据库线程）中完成；注册提交给批量写入线程后即返回，写入后调用 done
+void SqlUserStore::verifyAsync(const string& name, const string& pwd, bool isLogin, int timeoutMS,
+                               function<void(RESULT)> done)
+{
+    RESULT res;
+    if (lookup_(name, pwd, isLogin, timeoutMS, &res)) {
+        done(res);
+    }
+    else {
+        insert_(name, pwd, std::move(done));
+    }
+}
+
+
+// 查询用户名，能确定结果时返回 true 并设置 *res；注册且用户名未被使用时返回 false，需要写入
+bool SqlUserStore::lookup_(const string& name, const string& pwd, bool isLogin, int timeoutMS, RESULT* res)
+{
+    LOG_INFO("UserVerify name:%s", name.c_str());
+
+    *res = BUSY;
+    bool found = false, match = false;
+    {
+        // 从 mysql池中 获取一个 mysql 连接对象
+        MYSQL* sql = nullptr;
+        // RAII对象：创建对象时 获取mysql连接对象；销毁对象时，自动将连接放回连接池
+        SqlConnRAII sqlConn(&sql, SqlConnPool::instance(), timeoutMS);
+        if (!sql) {             // 没有空闲连接
+            return true;
+        }
+
+        // 用户名、密码只作为参数传给预处理语句，不拼接进 sql 命令
+        // 语句在每个连接上首次使用时预处理，之后复用
+        MYSQL_STMT* stmt = SqlConnPool::instance()->getStmt(sql, SELECT_USER_SQL);
+        if (!stmt) {
+            SqlConnPool::instance()->markBroken(sql);
+            return true;
+        }
+
+        // 参数：username
+        unsigned long nameLen = name.size();
+        MYSQL_BIND param[2];
+        memset(param, 0, sizeof(param));
+        param[0].buffer_type = MYSQL_TYPE_STRING;
+        param[0].buffer = const_cast<char*>(name.data());
+        param[0].buffer_length = nameLen;
+        param[0].length = &nameLen;
+
+        // 结果：password
+        char password[256];
+        unsigned long passwordLen = 0;
+        MYSQL_BIND result[1];
+        memset(result, 0, sizeof(result));
+        result[0].buffer_type = MYSQL_TYPE_STRING;
+        result[0].buffer = password;
+        result[0].buffer_length = sizeof(password);
+        result[0].length = &passwordLen;
+
+        // 执行 查询命令
+        if (mysql_stmt_bind_param(stmt, param) || mysql_stmt_execute(stmt) ||
+            mysql_stmt_bind_result(stmt, result) || mysql_stmt_store_result(stmt)) {   // 执行失败
+
+            LOG_DEBUG("%s", mysql_stmt_error(stmt));        // 生成错误原因
+            // 连接可能已断开，语句随之失效；关闭该连接上的语句，放回后由连接池的后台线程检查、重连
+            SqlConnPool::instance()->markBroken(sql);
+            return true;
+        }
+
+        // 查询到 该用户名 的信息（密码超过缓冲区时被截断，一定与输入不同）
+        int ret = mysql_stmt_fetch(stmt);
+        found = (ret == 0 || ret == MYSQL_DATA_TRUNCATED);
+        match = (ret == 0 && pwd.size() == passwordLen && memcmp(pwd.data(), password, passwordLen) == 0);
+
+        // 释放结果集
+        mysql_stmt_free_result(stmt);
+
+        // 记录查询结果，之后 同一用户的注册/登录 不再访问数据库
+        UserCache* cache = UserCache::instance();
+        if (ret == 0) {
+            cache->putUser(name, string(password, passwordLen));
+        }
+        else if (found) {
+            cache->putTaken(name);
+        }
+        else if (ret == MYSQL_NO_DATA) {
+            cache->putAbsent(name);
+        }
+    }   // 放回连接，注册的写入由批量写入线程 用它自己取得的连接完成
+
+    if (isLogin) {              // 登录操作
+        if (!match) {               // 登录失败，用户不存在或密码错误
+            LOG_DEBUG("pwd error!");
+        }
+        *res = match ? OK : FAIL;
+        return true;
+    }
+
+    if (found) {                // 注册操作，数据库已有该用户名、注册失败
+        LOG_DEBUG("user used!");
+        *res = FAIL;
+        return true;
+    }
+
+    // 未查询到 该用户名 信息、注册行为、且用户名未被使用
+    LOG_DEBUG("regirster!");
+    return false;
+}
+
+
+// 提交一条注册给批量写入线程，所在的一批写入后 以结果调用 done
+void SqlUserStore::insert_(const string& name, const string& pwd, function<void(RESULT)> done)
+{
+    lock_guard<mutex> locker(mtx_);
+    pending_.push_back({ name, pwd, chrono::steady_clock::now(), std::move(done), BUSY });
+    if (pending_.size() == 1 || pending_.size() >= static_cast<size_t>(BATCH_ROWS)) {
+        cond_.notify_one();     // 队列由空变为非空，或已凑满一批
+    }
+}
+
+
+// 批量写入线程：第一条注册到达后 等到凑满 BATCH_ROWS 条或等待满 BATCH_MS，取出一批写入
+// 写入期间到达的注册组成下一批
+void SqlUserStore::flushLoop_()
+{
+    unique_lock<mutex> locker(mtx_);
+    while (true) {
+        cond_.wait(locker, [this] { return isClose_ || !pending_.empty(); });
+        if (pending_.empty()) {     // 关闭，且没有等待写入的注册
+            break;
+        }
+
+        auto deadline = pending_.front().submit + chrono::milliseconds(BATCH_MS);
+        cond_.wait_until(locker, deadline, [this] {
+            return isClose_ || pending_.size() >= static_cast<size_t>(BATCH_ROWS);
+        });
+
+        vector<insertJob> batch;
+        while (!pending_.empty() && batch.size() < static_cast<size_t>(BATCH_ROWS)) {
+            batch.push_back(std::move(pending_.front()));
+            pending_.pop_front();
+        }
+
+        locker.unlock();
+        flush_(batch);
+        for (insertJob& job : batch) {
+            job.done(job.result);
+        }
+        locker.lock();
+    }
+}
+
+
+// 写入一批注册，为每条注册设置结果
+// 同一批中重复的用户名 只有第一条可能成功，与逐条写入的结果相同
+void SqlUserStore::flush_(vector<insertJob>& batch)
+{
+    vector<insertJob*> rows;
+    unordered_set<string> names;
+    for (insertJob& job : batch) {
+        if (names.insert(job.name).second) {
+            rows.push_back(&job);
+        }
+        else {
+            job.result = FAIL;      // 用户名已被同一批中之前的注册使用
+        }
+    }
+
+    ++batches_;
+    batchRows_ += batch.size();
+
+    MYSQL* sql = nullptr;
+    SqlConnRAII sqlConn(&sql, SqlConnPool::instance(), FLUSH_WAIT_MS);
+    if (!sql || !writeBatch_(sql, rows)) {
+        if (sql) {
+            SqlConnPool::instance()->markBroken(sql);
+        }
+        for (insertJob* job : rows) {
+            job->result = BUSY;
+        }
+    }
+}
+
+
+// 在一个事务中写入 rows（用户名互不相同）：
+// 先用 SELECT ... FOR UPDATE 锁定并查询这些用户名，已存在的注册失败；其余用一条多行 INSERT IGNORE 写入，然后提交
+// 用户名唯一 由 user 表 username 上的唯一索引保证（见 README）：同名的行被忽略，不会写入第二条
+// 多行写入的影响行数 少于写入的行数时（查询之后 其他进程写入了同名用户），回滚并逐条写入，按每条的影响行数 确定结果
+bool SqlUserStore::writeBatch_(MYSQL* sql, vector<insertJob*>& rows)
+{
+    size_t n = rows.size();
+    assert(n > 0 && n <= static_cast<size_t>(BATCH_ROWS));
+
+    SqlConnPool* pool = SqlConnPool::instance();
+    UserCache* cache = UserCache::instance();
+
+    // 显式指定隔离级别：FOR UPDATE 在 REPEATABLE READ 下 对不存在的用户名也加间隙锁，提交前其他事务不能插入
+    if (mysql_query(sql, ISOLATION_SQL) || mysql_autocommit(sql, false)) {
+        LOG_DEBUG("Begin error: %s", mysql_error(sql));
+        return false;
+    }
+
+    // 失败时回滚，恢复自动提交
+    auto fail = [sql](MYSQL_STMT* stmt) {
+        LOG_DEBUG("Insert error: %s", stmt ? mysql_stmt_error(stmt) : mysql_error(sql));
+        mysql_rollback(sql);
+        mysql_autocommit(sql, true);
+        return false;
+    };
+
+    // 参数：n 个 username（之后 INSERT 的参数在其后追加 password）
+    vector<MYSQL_BIND> param(2 * n);
+    vector<unsigned long> paramLen(2 * n);
+    memset(param.data(), 0, param.size() * sizeof(MYSQL_BIND));
+    for (size_t i = 0; i < n; ++i) {
+        paramLen[i] = rows[i]->name.size();
+        param[i].buffer_type = MYSQL_TYPE_STRING;
+        param[i].buffer = const_cast<char*>(rows[i]->name.data());
+        param[i].buffer_length = paramLen[i];
+        param[i].length = &paramLen[i];
+    }
+
+    // 结果：username，password
+    char username[256], password[256];
+    unsigned long usernameLen = 0, passwordLen = 0;
+    MYSQL_BIND result[2];
+    memset(result, 0, sizeof(result));
+    result[0].buffer_type = MYSQL_TYPE_STRING;
+    result[0].buffer = username;
+    result[0].buffer_length = sizeof(username);
+    result[0].length = &usernameLen;
+    result[1].buffer_type = MYSQL_TYPE_STRING;
+    result[1].buffer = password;
+    result[1].buffer_length = sizeof(password);
+    result[1].length = &passwordLen;
+
+    MYSQL_STMT* stmt = pool->getStmt(sql, lockSqls_[n].c_str());
+    if (!stmt) {
+        return fail(nullptr);
+    }
+    if (mysql_stmt_bind_param(stmt, param.data()) || mysql_stmt_execute(stmt) ||
+        mysql_stmt_bind_result(stmt, result) || mysql_stmt_store_result(stmt)) {
+        return fail(stmt);
+    }
+
+    // 已存在的用户名（用户名超过缓冲区时被截断，一定与本批的用户名都不同）
+    unordered_set<string> taken;
+    int ret;
+    while ((ret = mysql_stmt_fetch(stmt)) == 0 || ret == MYSQL_DATA_TRUNCATED) {
+        if (usernameLen > sizeof(username)) {
+            continue;
+        }
+        string name(username, usernameLen);
+        if (ret == 0) {
+            cache->putUser(name, string(password, passwordLen));
+        }
+        else {
+            cache->putTaken(name);
+        }
+        taken.insert(std::move(name));
+    }
+    mysql_stmt_free_result(stmt);
+    if (ret != MYSQL_NO_DATA) {
+        return fail(stmt);
+    }
+
+    // 其余用户名 写入：参数依次为 username，password
+    vector<insertJob*> inserts;
+    for (insertJob* job : rows) {
+        if (taken.count(job->name)) {
+            job->result = FAIL;         // 数据库已有该用户名（查询之后 由其他请求写入）
+        }
+        else {
+            inserts.push_back(job);
+        }
+    }
+
+    if (!inserts.empty()) {
+        size_t k = inserts.size();
+        for (size_t i = 0; i < k; ++i) {
+            bindUser_(&param[2 * i], &paramLen[2 * i], inserts[i]);
+        }
+
+        // 写入前先移除缓存项，失败时 之后的请求重新查询数据库
+        for (insertJob* job : inserts) {
+            cache->invalidate(job->name);
+        }
+
+        stmt = pool->getStmt(sql, insertSqls_[k].c_str());
+        if (!stmt) {
+            return fail(nullptr);
+        }
+        if (mysql_stmt_bind_param(stmt, param.data()) || mysql_stmt_execute(stmt)) {
+            return fail(stmt);
+        }
+
+        if (mysql_stmt_affected_rows(stmt) != k) {     // 有用户名已被使用，不能确定是哪些：回滚，逐条写入
+            LOG_WARN("Insert: %llu of %zu rows written, retry one by one", mysql_stmt_affected_rows(stmt), k);
+            if (mysql_rollback(sql) || mysql_query(sql, ISOLATION_SQL)) {
+                return fail(nullptr);
+            }
+
+            stmt = pool->getStmt(sql, insertSqls_[1].c_str());
+            if (!stmt) {
+                return fail(nullptr);
+            }
+            vector<insertJob*> written;
+            for (insertJob* job : inserts) {
+                bindUser_(&param[0], &paramLen[0], job);
+                if (mysql_stmt_bind_param(stmt, param.data()) || mysql_stmt_execute(stmt)) {
+                    return fail(stmt);
+                }
+                if (mysql_stmt_affected_rows(stmt) == 1) {
+                    written.push_back(job);
+                }
+                else {
+                    job->result = FAIL;     // 数据库已有该用户名
+                    cache->putTaken(job->name);
+                }
+            }
+            inserts.swap(written);
+        }
+    }
+
+    if (mysql_commit(sql)) {
+        return fail(nullptr);
+    }
+    mysql_autocommit(sql, true);
+
+    for (insertJob* job : inserts) {
+        job->result = OK;
+        cache->putUser(job->name, job->pwd);
+    }
+    return true;
+}
+
+
+// 绑定一条注册的 username，password 为 INSERT 的两个参数
+void SqlUserStore::bindUser_(MYSQL_BIND* param, unsigned long* len, insertJob* job)
+{
+    len[0] = job->name.size();
+    len[1] = job->pwd.size();
+    param[0].buffer = const_cast<char*>(job->name.data());
+    param[1].buffer = const_cast<char*>(job->pwd.data());
+    for (int j = 0; j < 2; ++j) {
+        param[j].buffer_type = MYSQL_TYPE_STRING;
+        param[j].buffer_length = len[j];
+        param[j].length = &len[j];
+    }
+}
@@ -0,0 +1,84 @@
+
+#ifndef SQL_USER_STORE_H
+#define SQL_USER_STORE_H
+
+#include<string>
+#include<vector>
+#include<deque>
+#include<mutex>
+#include<condition_variable>
+#include<thread>
+#include<atomic>
+#include<chrono>
+#include<future>
+#include<functional>
+#include<unordered_set>
+#include<mysql/mysql.h>
+#include<string.h>
+#include<assert.h>
+
+#include"userstore.hpp"
+#include"usercache.h"
+#include"sqlconnpool.h"
+#include"sqlconnRAII.hpp"
+#include"../log/log.h"
+
+
+// MySQL 后端：user 表，通过连接池中 每个连接上缓存的预处理语句访问；查询结果写入 UserCache
+// 注册的写入交给批量写入线程：凑满 BATCH_ROWS 条或等待 BATCH_MS 后，在一个事务中用一条多行 INSERT IGNORE 写入
+// 要求 user 表的 username 有唯一索引，用户名唯一由数据库保证
+// 异步检验时 数据库线程提交写入后即返回，不等待所在的一批完成
+class SqlUserStore : public UserStore {
+public:
+    SqlUserStore();
+    ~SqlUserStore();
+
+    RESULT verify(const std::string& name, const std::string& pwd, bool isLogin, int timeoutMS) override;
+    void verifyAsync(const std::string& name, const std::string& pwd, bool isLogin, int timeoutMS,
+                     std::function<void(RESULT)> done) override;
+    bool isBlocking() const override { return true; }
+
+    uint64_t getBatchCount() { return batches_; }       // 已提交的批量写入事务数
+    uint64_t getBatchRowCount() { return batchRows_; }  // 批量写入的注册数（含失败的）
+
+private:
+    // 一条等待写入的注册，由数据库线程提交、批量写入线程完成
+    struct insertJob {
+        std::string name;
+        std::string pwd;
+        std::chrono::steady_clock::time_point submit;
+        std::function<void(RESULT)> done;   // 写入完成后 在批量写入线程中调用
+        RESULT result;
+    };
+
+    bool lookup_(const std::string& name, const std::string& pwd, bool isLogin, int timeoutMS, RESULT* res);
+    void insert_(const std::string& name, const std::string& pwd, std::function<void(RESULT)> done);
+    void flushLoop_();
+    void flush_(std::vector<insertJob>& batch);
+    bool writeBatch_(MYSQL* sql, std::vector<insertJob*>& rows);
+    static void bindUser_(MYSQL_BIND* param, unsigned long* len, insertJob* job);
+
+    static const char* const SELECT_USER_SQL;       // 查询用户密码 的预处理语句
+    static const char* const ISOLATION_SQL;         // 批量写入事务的隔离级别
+
+    static constexpr int BATCH_MS = 2;      // 一批中 第一条注册最多等待的时间
+    static const int BATCH_ROWS = 32;       // 一批最多的注册数
+    static const int FLUSH_WAIT_MS = 500;   // 批量写入 等待数据库连接的最长时间，超时整批返回 BUSY
+
+    // 下标为行数 n 的预处理语句（每个连接上按需预处理、缓存）
+    std::vector<std::string> lockSqls_;     // 锁定并查询 n 个用户名：SELECT ... WHERE username IN (?, ...) FOR UPDATE
+    std::vector<std::string> insertSqls_;   // 插入 n 个用户：INSERT IGNORE ... VALUES(?, ?), ...
+
+    std::mutex mtx_;
+    std::condition_variable cond_;          // 唤醒批量写入线程
+    std::deque<insertJob> pending_;         // 等待写入的注册
+    bool isClose_;
+
+    std::atomic<uint64_t> batches_;
+    std::atomic<uint64_t> batchRows_;
+
+    std::thread flusher_;                   // 批量写入线程
+};
+
+
+#endif  // SQL_USER_STORE_H
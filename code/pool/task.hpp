@@ -0,0 +1,123 @@
+
+
+#ifndef TASK_HPP
+#define TASK_HPP
+
+#include<new>
+#include<cstddef>
+#include<utility>
+#include<type_traits>
+
+
+// 线程池任务：固定大小、只能移动的可调用对象，代替 std::function<void()>
+// 可调用对象直接构造在内部缓冲区中，不分配堆内存；放不下时编译报错
+// 对 “对象 + 成员函数 + 参数指针”（如 Reactor 的 onRead_(client)）提供专门的构造函数，不需要 std::bind
+class Task {
+public:
+    static const size_t CAPACITY = 48;      // 内部缓冲区大小，可容纳 std::bind(成员函数, this, 指针)、std::function
+
+    Task() noexcept : ops_(nullptr) {}
+
+    // 任意可调用对象
+    template<class F, class = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Task>::value>::type>
+    Task(F&& f) {
+        typedef typename std::decay<F>::type Fn;
+        static_assert(sizeof(Fn) <= CAPACITY, "Task: callable too large");
+        static_assert(alignof(Fn) <= alignof(std::max_align_t), "Task: callable over-aligned");
+        static_assert(std::is_nothrow_move_constructible<Fn>::value, "Task: callable must be nothrow movable");
+
+        new (buf_) Fn(std::forward<F>(f));
+        ops_ = &OPS<Fn>;
+    }
+
+    // 对象 obj 的成员函数 method(arg)
+    template<class T, class A>
+    Task(T* obj, void (T::*method)(A*), A* arg) : Task(memberCall<T, A>{ obj, method, arg }) {}
+
+    Task(Task&& other) noexcept : ops_(other.ops_) {
+        if (ops_) {
+            ops_->move(buf_, other.buf_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other.ops_) {
+                ops_ = other.ops_;
+                ops_->move(buf_, other.buf_);
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() {
+        reset();
+    }
+
+    void operator()() {
+        ops_->invoke(buf_);
+    }
+
+    explicit operator bool() const {
+        return ops_ != nullptr;
+    }
+
+    // 销毁持有的可调用对象，及时释放它持有的资源
+    void reset() {
+        if (ops_) {
+            ops_->destroy(buf_);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    // 可调用对象类型 Fn 的调用、移动、销毁操作
+    struct ops {
+        void (*invoke)(void* fn);
+        void (*move)(void* dst, void* src);     // 移动构造到 dst，并销毁 src
+        void (*destroy)(void* fn);
+    };
+
+    template<class Fn>
+    static void invoke_(void* fn) {
+        (*static_cast<Fn*>(fn))();
+    }
+
+    template<class Fn>
+    static void move_(void* dst, void* src) {
+        new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+        static_cast<Fn*>(src)->~Fn();
+    }
+
+    template<class Fn>
+    static void destroy_(void* fn) {
+        static_cast<Fn*>(fn)->~Fn();
+    }
+
+    template<class Fn>
+    static constexpr ops OPS = { invoke_<Fn>, move_<Fn>, destroy_<Fn> };
+
+    // 对象 + 成员函数 + 参数指针
+    template<class T, class A>
+    struct memberCall {
+        T* obj;
+        void (T::*method)(A*);
+        A* arg;
+
+        void operator()() {
+            (obj->*method)(arg);
+        }
+    };
+
+    alignas(std::max_align_t) unsigned char buf_[CAPACITY];
+    const ops* ops_;        // 为空表示 不持有可调用对象
+};
+
+
+#endif  // TASK_HPP
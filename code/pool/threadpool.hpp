@@ -5,48 +5,52 @@
 
 #include<mutex>
 #include<condition_variable>
-#include<queue>
+#include<vector>
 #include<thread>
-#include<functional>
+#include<atomic>
+#include<memory>
 #include<assert.h>
 
+#include"task.hpp"
 
+
+// 工作窃取线程池：每个工作线程有自己的任务队列和锁，addTask 轮流放入各线程的队列
+// 工作线程先处理自己队列中的任务，自己的队列空了 就从其他线程的队列中窃取，都没有任务时 休眠等待
+// 任务为 Task（内部缓冲区，不分配内存），任务队列为环形缓冲区 只在容量不够时扩容，稳定运行时 提交任务不分配内存
 class ThreadPool {
 public:
     explicit ThreadPool(size_t threadCount = 8)
-        : pool_(std::make_shared<Pool>()) {
-        
+        : pool_(std::make_shared<Pool>(threadCount)) {
+
         assert(threadCount > 0);
-        
+
         // 循环创建工作线程
         for (size_t i = 0; i < threadCount; ++i) {
 
             // 捕获列表只能显式捕获lambda所在函数的局部变量，或隐式捕获对象的this指针
             std::shared_ptr<Pool> pool(pool_);      // 创建一个局部变量给lambda使用
 
-            //std::thread([pool = pool_] {
-            std::thread([pool] {
+            std::thread([pool, i] {
 
-                std::unique_lock<std::mutex> locker(pool->mtx);         // unique_lock 可随时解锁加锁
+                Task task;
+                int spins = 0;
 
                 // 每个线程的工作流程
                 while (true) {
-                    if (!pool->tasks.empty()) {     // 任务队列不为空，完成任务
-                        auto task = std::move(pool->tasks.front());     // 拿到第一个任务
-                        pool->tasks.pop();
-                        locker.unlock();    // 取出任务后就 解锁
-
-                        task();             // 完成任务
-                        
-                        locker.lock();      // 完成任务后 继续加锁
+                    if (pool->take(i, task)) {      // 拿到任务（自己队列中的 或窃取的），完成任务
+                        task();
+                        task.reset();               // 及时释放任务持有的资源
+                        spins = 0;
                     }
-                    else if (pool->isClosed) {      // 线程池关闭，退出线程工作
-                        break;
+                    else if (spins < SPIN_COUNT) {  // 没有任务，先让出 CPU 再试几次，减少休眠/唤醒的系统调用
+                        ++spins;
+                        std::this_thread::yield();
                     }
-                    else {
-                        pool->cond.wait(locker);    // 没有任务，等待任务，先解锁、有任务来了再加锁 处理
+                    else if (!pool->wait()) {       // 仍没有任务，休眠等待；线程池关闭，退出线程工作
+                        break;
                     }
                 }
+                pool->exit();
             }).detach();    // 线程创建即分离，交给操作系统管理
         }
     }
@@ -56,39 +60,182 @@ public:
 
     ~ThreadPool() {
         if (static_cast<bool>(pool_)) {     // 如果线程池指针不为空
+            pool_->close();                 // 通知所有线程 处理完剩余任务后退出
+        }
+    }
 
-            // 使用"{ }"限定lock_guard作用域，它在自身作用域（生命周期）中具有构造时加锁，析构时解锁的功能
-            {                                                          
-                std::lock_guard<std::mutex> locker(pool_->mtx);
-                pool_->isClosed = true;
-            }
-
-            pool_->cond.notify_all();       // 通知所有线程退出
+    // 关闭线程池，等待所有线程处理完剩余任务后退出；之后不能再提交任务，不能在工作线程中调用
+    // 任务访问的对象 在此之后才能销毁（析构函数只通知退出，不等待）
+    void join() {
+        if (static_cast<bool>(pool_)) {
+            pool_->close();
+            pool_->join();
         }
     }
 
     template<class T>
     void addTask(T&& task) {
+        push_(Task(std::forward<T>(task)));     // forward 完美转发，保持原来的值属性不变；减少内存拷贝
+    }
 
-        {
-            std::lock_guard<std::mutex> locker(pool_->mtx);     // 线程池加锁
-            pool_->tasks.emplace(std::forward<T>(task));        // 加入一个任务到任务队列中
-            // forward 完美转发，保持原来的值属性不变；减少内存拷贝
-        }
+    // 对象 obj 的成员函数 method(arg)，如 addTask(this, &EpollReactor::onRead_, client)
+    template<class T, class A>
+    void addTask(T* obj, void (T::*method)(A*), A* arg) {
+        push_(Task(obj, method, arg));
+    }
 
-        pool_->cond.notify_one();   // 通知一个线程工作
+    // 所有队列中等待执行的任务数
+    size_t queueSize() const {
+        long pending = pool_ ? pool_->pending.load(std::memory_order_relaxed) : 0;
+        return pending > 0 ? static_cast<size_t>(pending) : 0;
     }
 
 private:
+    static const int SPIN_COUNT = 4;            // 休眠前 让出 CPU 重试的次数
+    static const size_t QUEUE_CAPACITY = 256;   // 每个任务队列的初始容量，必须是 2 的幂
+
+    struct alignas(64) Worker {         // 工作线程的任务队列（环形缓冲区），按缓存行对齐 避免伪共享
+        Worker() : tasks(QUEUE_CAPACITY), head(0), count(0) {}
+
+        void pushBack(Task&& task) {
+            if (count == tasks.size()) {    // 满了，容量翻倍
+                std::vector<Task> bigger(tasks.size() * 2);
+                for (size_t k = 0; k < count; ++k) {
+                    bigger[k] = std::move(tasks[(head + k) & (tasks.size() - 1)]);
+                }
+                tasks.swap(bigger);
+                head = 0;
+            }
+
+            tasks[(head + count) & (tasks.size() - 1)] = std::move(task);
+            ++count;
+            size.store(count, std::memory_order_relaxed);
+        }
+
+        Task popFront() {
+            Task task(std::move(tasks[head]));
+            head = (head + 1) & (tasks.size() - 1);
+            --count;
+            size.store(count, std::memory_order_relaxed);
+            return task;
+        }
+
+        Task popBack() {
+            --count;
+            size.store(count, std::memory_order_relaxed);
+            return Task(std::move(tasks[(head + count) & (tasks.size() - 1)]));
+        }
+
+        std::mutex mtx;                                 // 锁
+        std::vector<Task> tasks;                        // 任务队列，容量为 2 的幂
+        size_t head;                                    // 队头位置
+        size_t count;                                   // 任务数
+        std::atomic<size_t> size{ 0 };                  // 任务数，窃取时 不加锁先看一眼，跳过空队列
+    };
+
     struct Pool {                       // 线程池结构体
-        std::mutex mtx;                             // 锁
+        explicit Pool(size_t threadCount)
+            : size(threadCount), workers(new Worker[threadCount]),
+            next(0), pending(0), idle(0), isClosed(false), exited(0) {}
+
+        // 取一个任务：先从自己队列的头部取，再依次从其他线程队列的尾部窃取
+        // 窃取时跳过空队列，正被其他线程加锁的队列 也先跳过（try_lock），都没取到时 再全部加锁确认一遍
+        bool take(size_t self, Task& task) {
+            for (int round = 0; round < 2; ++round) {
+                for (size_t k = 0; k < size; ++k) {
+                    Worker& worker = workers[(self + k) % size];
+                    if (worker.size.load(std::memory_order_relaxed) == 0) {
+                        continue;
+                    }
+
+                    std::unique_lock<std::mutex> locker(worker.mtx, std::defer_lock);
+                    if (k == 0 || round == 1) {
+                        locker.lock();
+                    }
+                    else if (!locker.try_lock()) {
+                        continue;
+                    }
+
+                    if (worker.count == 0) {
+                        continue;
+                    }
+
+                    task = (k == 0) ? worker.popFront() : worker.popBack();
+                    pending.fetch_sub(1);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // 休眠 直到有新任务 或线程池关闭；线程池关闭且没有剩余任务时 返回 false
+        bool wait() {
+            std::unique_lock<std::mutex> locker(mtx);
+            idle.fetch_add(1);      // 先登记休眠 再检查任务数，与 notify 的顺序相反，保证不会错过唤醒
+            while (pending.load() <= 0 && !isClosed) {
+                cond.wait(locker);
+            }
+            idle.fetch_sub(1);
+            return pending.load() > 0;
+        }
+
+        // 新增了一个任务，有线程在休眠时 唤醒一个
+        void notify() {
+            pending.fetch_add(1);
+            if (idle.load() > 0) {
+                std::lock_guard<std::mutex> locker(mtx);
+                cond.notify_one();
+            }
+        }
+
+        void close() {
+            {
+                std::lock_guard<std::mutex> locker(mtx);
+                isClosed = true;
+            }
+            cond.notify_all();      // 通知所有线程退出
+        }
+
+        // 工作线程退出前调用
+        void exit() {
+            std::lock_guard<std::mutex> locker(mtx);
+            ++exited;
+            exitCond.notify_all();
+        }
+
+        // 等待所有工作线程退出
+        void join() {
+            std::unique_lock<std::mutex> locker(mtx);
+            exitCond.wait(locker, [this] { return exited == size; });
+        }
+
+        const size_t size;                          // 工作线程数
+        std::unique_ptr<Worker[]> workers;          // 各工作线程的任务队列
+        std::atomic<size_t> next;                   // 下一个任务放入的队列
+
+        std::atomic<long> pending;                  // 所有队列中的任务总数（任务入队后才增加，可能短暂为负）
+        std::atomic<size_t> idle;                   // 休眠的线程数
+        std::mutex mtx;                             // 休眠用的锁
         std::condition_variable cond;               // 条件变量
-        bool isClosed;                              // 是否关闭
-        std::queue<std::function<void()>> tasks;    // 任务队列
+        bool isClosed;                              // 是否关闭，由 mtx 保护
+        size_t exited;                              // 已退出的线程数，由 mtx 保护
+        std::condition_variable exitCond;           // 有线程退出
     };
 
-    std::shared_ptr<Pool> pool_;        // 线程池指针
+    // 轮流选择一个工作线程，放入它的队列
+    void push_(Task&& task) {
+        size_t i = pool_->next.fetch_add(1, std::memory_order_relaxed) % pool_->size;
+        Worker& worker = pool_->workers[i];
+        {
+            std::lock_guard<std::mutex> locker(worker.mtx);     // 只锁这个工作线程的队列
+            worker.pushBack(std::move(task));
+        }
+
+        pool_->notify();    // 有线程在休眠时 唤醒一个
+    }
+
+    std::shared_ptr<Pool> pool_;        // 线程池指针，只在创建工作线程时复制，提交任务不改变引用计数
 };
 
 
-#endif  // THREADPOOL_HPP
\ No newline at end of file
+#endif  // THREADPOOL_HPP
@@ -0,0 +1,201 @@
+
+#include"usercache.h"
+#include<random>
+#include<string.h>
+using namespace std;
+
+
+UserCache::UserCache() : hits_(0), misses_(0)
+{
+    random_device rd;
+    key_[0] = (static_cast<uint64_t>(rd()) << 32) | rd();
+    key_[1] = (static_cast<uint64_t>(rd()) << 32) | rd();
+}
+
+
+// 单例模式：局部静态变量的懒汉模式
+UserCache* UserCache::instance()
+{
+    static UserCache cache;
+    return &cache;
+}
+
+
+// 查询缓存，判断 注册/登录 的结果；不能确定时返回 MISS，由调用者访问数据库
+UserCache::RESULT UserCache::check(const string& name, const string& pwd, bool isLogin)
+{
+    uint64_t verifier = isLogin ? verifier_(pwd) : 0;    // 在锁外计算
+
+    RESULT res = MISS;
+    {
+        shard& s = shard_(name);
+        lock_guard<mutex> locker(s.mtx);
+
+        auto it = s.map.find(name);
+        if (it != s.map.end()) {
+            entry& e = *it->second;
+
+            if (e.expire <= Clock::now()) {         // 已过期，移除
+                s.order.erase(it->second);
+                s.map.erase(it);
+            }
+            else if (!isLogin) {                    // 注册：用户名已被使用 直接失败，不存在时仍要写数据库
+                res = (e.state == ABSENT) ? MISS : FAIL;
+            }
+            else if (e.state == USER) {             // 登录：比较校验值
+                res = (e.verifier == verifier) ? OK : FAIL;
+            }
+            else if (e.state == ABSENT) {           // 登录：用户不存在
+                res = FAIL;
+            }
+        }
+    }
+
+    if (res == MISS) {
+        misses_.fetch_add(1, memory_order_relaxed);
+    }
+    else {
+        hits_.fetch_add(1, memory_order_relaxed);
+    }
+    return res;
+}
+
+
+// 数据库中 name 的密码为 pwd（查询到，或注册成功）
+void UserCache::putUser(const string& name, const string& pwd)
+{
+    put_(name, USER, verifier_(pwd));
+}
+
+
+// 数据库中存在 name，但密码未知
+void UserCache::putTaken(const string& name)
+{
+    put_(name, TAKEN, 0);
+}
+
+
+// 数据库中不存在 name
+// 已有 USER/TAKEN 项时不覆盖：查询可能在另一个请求的注册提交之前完成，之后才写入缓存（账号不会被删除，存在的项总是更新的结果）
+void UserCache::putAbsent(const string& name)
+{
+    put_(name, ABSENT, 0);
+}
+
+
+// 移除 name 的缓存项：写数据库之前调用，写入结果不确定时 不留下过时的项
+void UserCache::invalidate(const string& name)
+{
+    shard& s = shard_(name);
+    lock_guard<mutex> locker(s.mtx);
+
+    auto it = s.map.find(name);
+    if (it != s.map.end()) {
+        s.order.erase(it->second);
+        s.map.erase(it);
+    }
+}
+
+
+// 缓存项总数（包括已过期、尚未移除的）
+size_t UserCache::size()
+{
+    size_t n = 0;
+    for (shard& s : shards_) {
+        lock_guard<mutex> locker(s.mtx);
+        n += s.map.size();
+    }
+    return n;
+}
+
+
+UserCache::shard& UserCache::shard_(const string& name)
+{
+    return shards_[hash<string>()(name) % SHARDS];
+}
+
+
+// 写入 或更新 name 的缓存项，重新计算过期时间；分片满时淘汰最早写入的项
+// ABSENT 不覆盖 USER/TAKEN 项
+void UserCache::put_(const string& name, STATE state, uint64_t verifier)
+{
+    Clock::time_point expire = Clock::now() + chrono::milliseconds(int(TTL_MS));
+
+    shard& s = shard_(name);
+    lock_guard<mutex> locker(s.mtx);
+
+    auto it = s.map.find(name);
+    if (it != s.map.end()) {
+        entry& e = *it->second;
+        if (state == ABSENT && e.state != ABSENT) {
+            return;
+        }
+        e.state = state;
+        e.verifier = verifier;
+        e.expire = expire;
+        s.order.splice(s.order.begin(), s.order, it->second);   // 移到最前
+        return;
+    }
+
+    if (s.map.size() >= CAPACITY / SHARDS) {    // 所有项的 TTL 相同，最早写入的项 也最早过期
+        s.map.erase(s.order.back().name);
+        s.order.pop_back();
+    }
+
+    s.order.push_front({ name, state, verifier, expire });
+    s.map[name] = s.order.begin();
+}
+
+
+// 密码校验值
+uint64_t UserCache::verifier_(const string& pwd) const
+{
+    return sipHash_(key_, pwd.data(), pwd.size());
+}
+
+
+// SipHash-2-4，key 为 128 位密钥
+uint64_t UserCache::sipHash_(const uint64_t key[2], const char* data, size_t len)
+{
+    uint64_t v0 = 0x736f6d6570736575ULL ^ key[0];
+    uint64_t v1 = 0x646f72616e646f6dULL ^ key[1];
+    uint64_t v2 = 0x6c7967656e657261ULL ^ key[0];
+    uint64_t v3 = 0x7465646279746573ULL ^ key[1];
+
+    auto rotl = [](uint64_t x, int b) { return (x << b) | (x >> (64 - b)); };
+    auto round = [&]() {
+        v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+        v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+        v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+        v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+    };
+
+    // 每次处理 8 字节（小端）
+    size_t end = len - len % 8;
+    for (size_t i = 0; i < end; i += 8) {
+        uint64_t m;
+        memcpy(&m, data + i, 8);
+        v3 ^= m;
+        round();
+        round();
+        v0 ^= m;
+    }
+
+    // 最后不足 8 字节，最高字节为长度
+    uint64_t b = static_cast<uint64_t>(len) << 56;
+    for (size_t i = 0; i < len % 8; ++i) {
+        b |= static_cast<uint64_t>(static_cast<unsigned char>(data[end + i])) << (8 * i);
+    }
+    v3 ^= b;
+    round();
+    round();
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    round();
+    round();
+    round();
+    round();
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
@@ -0,0 +1,84 @@
+#ifndef USER_CACHE_H
+#define USER_CACHE_H
+
+#include<string>
+#include<list>
+#include<unordered_map>
+#include<atomic>
+#include<mutex>
+#include<chrono>
+#include<stdint.h>
+
+
+// 进程内的用户身份缓存，挡在数据库前面：用户名 To 密码校验值
+// 校验值为带随机密钥的 SipHash，不保存明文密码；缓存项超过 TTL 后失效
+// 按用户名哈希分片，每个分片一把锁、容量固定，满时淘汰最早写入（也是最早过期）的项
+// 同时缓存 不存在的用户名（负缓存）：不存在的用户登录、已被使用的用户名注册 都不需要访问数据库
+class UserCache {
+public:
+    // 查询结果
+    enum RESULT {
+        MISS,           // 缓存不能确定，需要访问数据库
+        OK,             // 登录成功
+        FAIL,           // 登录失败（用户不存在或密码错误），或注册的用户名已被使用
+    };
+
+    static UserCache* instance();
+
+    RESULT check(const std::string& name, const std::string& pwd, bool isLogin);
+
+    void putUser(const std::string& name, const std::string& pwd);
+    void putTaken(const std::string& name);
+    void putAbsent(const std::string& name);
+    void invalidate(const std::string& name);
+
+    uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+    size_t size();
+
+private:
+    UserCache();
+    ~UserCache() = default;
+
+    typedef std::chrono::steady_clock Clock;
+
+    // 缓存项的状态
+    enum STATE {
+        USER,           // 用户存在，校验值有效
+        TAKEN,          // 用户存在，密码未知（数据库中的密码过长等）
+        ABSENT,         // 用户不存在
+    };
+
+    struct entry {
+        std::string name;
+        STATE state;
+        uint64_t verifier;          // 密码校验值，仅 USER 有效
+        Clock::time_point expire;   // 过期时间
+    };
+
+    // 一个分片：链表按写入时间排列（新的在前），哈希表由用户名找到链表节点
+    struct alignas(64) shard {
+        std::mutex mtx;
+        std::list<entry> order;
+        std::unordered_map<std::string, std::list<entry>::iterator> map;
+    };
+
+    shard& shard_(const std::string& name);
+    void put_(const std::string& name, STATE state, uint64_t verifier);
+    uint64_t verifier_(const std::string& pwd) const;
+
+    static uint64_t sipHash_(const uint64_t key[2], const char* data, size_t len);
+
+    static const int SHARDS = 16;                   // 分片数
+    static const size_t CAPACITY = 64 * 1024;       // 总容量（项）
+    static const int TTL_MS = 60 * 1000;            // 缓存项的有效时间
+
+    uint64_t key_[2];           // SipHash 密钥，进程启动时随机生成
+    shard shards_[SHARDS];
+
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+};
+
+
+#endif  // USER_CACHE_H
@@ -0,0 +1,36 @@
+
+#ifndef USERSTORE_HPP
+#define USERSTORE_HPP
+
+#include<string>
+#include<functional>
+
+
+// 用户账号的存储后端：注册/登录 由 HttpRequest::userVerify 交给它完成
+// 会阻塞的后端（访问数据库）由 Reactor 交给数据库线程调用；不阻塞的后端 在解析请求时直接调用
+class UserStore {
+public:
+    // 注册/登录的结果
+    enum RESULT {
+        FAIL,           // 注册/登录失败（用户名已被使用，或用户不存在、密码错误）
+        OK,             // 注册/登录成功
+        BUSY,           // 后端繁忙（等待连接超时）或不可用，返回 503
+    };
+
+    virtual ~UserStore() = default;
+
+    // 检验用户身份，isLogin 为 false 时注册；timeoutMS 为等待后端资源的最长时间（-1 一直等待）
+    virtual RESULT verify(const std::string& name, const std::string& pwd, bool isLogin, int timeoutMS) = 0;
+
+    // 异步检验：结果通过 done 给出，done 可能在其他线程中调用；默认直接调用 verify
+    virtual void verifyAsync(const std::string& name, const std::string& pwd, bool isLogin, int timeoutMS,
+                             std::function<void(RESULT)> done) {
+        done(verify(name, pwd, isLogin, timeoutMS));
+    }
+
+    // 是否会阻塞调用线程
+    virtual bool isBlocking() const = 0;
+};
+
+
+#endif  // USERSTORE_HPP
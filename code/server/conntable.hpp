@@ -0,0 +1,96 @@
+
+#ifndef CONNTABLE_HPP
+#define CONNTABLE_HPP
+
+#include<memory>
+#include<atomic>
+#include<mutex>
+#include<assert.h>
+
+
+// 以 fd 为下标的连接表，代替 unordered_map<int, T>
+// 按块（CHUNK_SIZE 个槽位）延迟分配，已分配的块不会移动：查找无需哈希，线程池中持有的指针始终有效
+// fd 在进程内唯一，多个 Reactor 可共用一张表，只有分配新块时加锁
+template<class T>
+class ConnTable {
+public:
+    explicit ConnTable(int maxFd = 65536);
+    ~ConnTable();
+
+    ConnTable(const ConnTable&) = delete;
+    ConnTable& operator=(const ConnTable&) = delete;
+
+    T* find(int fd) const;
+    T& operator[](int fd);
+
+    static const int CHUNK_SIZE = 1024;     // 每块的槽位数
+
+private:
+    int maxFd_;                                     // fd 上限（不含）
+    int chunkNum_;                                  // 块数
+    std::unique_ptr<std::atomic<T*>[]> chunks_;     // 块指针数组，大小固定
+    std::mutex mtx_;                                // 分配新块时使用
+};
+
+
+
+//explicit ConnTable(int maxFd = 65536);
+template<class T>
+ConnTable<T>::ConnTable(int maxFd)
+    : maxFd_(maxFd), chunkNum_((maxFd + CHUNK_SIZE - 1) / CHUNK_SIZE),
+    chunks_(new std::atomic<T*>[(maxFd + CHUNK_SIZE - 1) / CHUNK_SIZE])
+{
+    assert(maxFd > 0);
+
+    for (int i = 0; i < chunkNum_; ++i) {
+        chunks_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+
+template<class T>
+ConnTable<T>::~ConnTable()
+{
+    for (int i = 0; i < chunkNum_; ++i) {
+        delete[] chunks_[i].load(std::memory_order_relaxed);
+    }
+}
+
+
+// 返回 fd 对应的槽位，所在块未分配 或 fd 越界时返回 nullptr
+template<class T>
+T* ConnTable<T>::find(int fd) const
+{
+    if (fd < 0 || fd >= maxFd_) {
+        return nullptr;
+    }
+
+    T* chunk = chunks_[fd / CHUNK_SIZE].load(std::memory_order_acquire);
+    return chunk ? &chunk[fd % CHUNK_SIZE] : nullptr;
+}
+
+
+// 返回 fd 对应的槽位，所在块未分配时先分配
+template<class T>
+T& ConnTable<T>::operator[](int fd)
+{
+    assert(0 <= fd && fd < maxFd_);
+
+    std::atomic<T*>& slot = chunks_[fd / CHUNK_SIZE];
+    T* chunk = slot.load(std::memory_order_acquire);
+
+    if (!chunk) {
+        std::lock_guard<std::mutex> locker(mtx_);
+
+        chunk = slot.load(std::memory_order_relaxed);
+        if (!chunk) {       // 加锁后再检查一次，其他 Reactor 可能已经分配
+            chunk = new T[CHUNK_SIZE];
+            slot.store(chunk, std::memory_order_release);
+        }
+    }
+
+    return chunk[fd % CHUNK_SIZE];
+}
+
+
+#endif  // CONNTABLE_HPP
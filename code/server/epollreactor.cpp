@@ -0,0 +1,315 @@
+
+#include"epollreactor.h"
+using namespace std;
+
+
+// 监听 fd，监听/连接事件模式，超时时间，线程池（为空则在本线程处理读写），数据库线程池，连接表
+EpollReactor::EpollReactor(int listenFd, uint32_t listenEvent, uint32_t connEvent, int timeoutMS,
+                            ThreadPool* threadpool, ThreadPool* sqlExecutor, ConnTable<HttpConn>* users)
+    : Reactor(listenFd, timeoutMS, sqlExecutor), listenEvent_(listenEvent), connEvent_(connEvent),
+    epoller_(new Epoller()), threadpool_(threadpool), users_(users)
+{
+    assert(users_);
+}
+
+
+// 将监听 fd 添加到本 Reactor 的 epoll
+bool EpollReactor::init()
+{
+    if (!epoller_->addFd(listenFd_, listenEvent_ | EPOLLIN)) {
+        LOG_ERROR("Epoll add listen fd error!");
+        return false;
+    }
+
+    // 设置 监听fd 为非阻塞
+    setFdNonblock_(listenFd_);
+
+    // 数据库检验完成的通知，LT 模式
+    if (verifyFd_ < 0 || !epoller_->addFd(verifyFd_, EPOLLIN)) {
+        LOG_ERROR("Epoll add verify eventfd error!");
+        return false;
+    }
+
+    return true;
+}
+
+
+// 事件循环
+void EpollReactor::loop()
+{
+    int timeMS = -1;    // epoll_wait：timeout == -1，无事件时将阻塞
+
+    // 只要 Reactor 正常运行
+    while (!isClose_) {
+
+        // 开启定时器
+        if (timeoutMS_ > 0) {
+            timeMS = timer_->getNextTick();
+        }
+
+        // 处理事件
+        int eventCnt = epoller_->wait(timeMS);  // timeMS：-1阻塞，0不阻塞，>0超时时间
+        for (int i = 0; i < eventCnt; ++i) {
+            int fd = epoller_->getEventFd(i);
+            uint32_t events = epoller_->getEvents(i);
+
+            if (fd == listenFd_) {                                      // 解决监听事件
+                dealListen_();
+            }
+            else if (fd == verifyFd_) {                                 // 数据库检验完成，或线程池线程要关闭连接
+                dealVerified_();
+                dealClosing_();
+            }
+            else if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {     // 检测到对端关闭
+                assert(users_->find(fd));       // 先看看是否存在该fd
+                closeInLoop_(users_->find(fd));
+            }
+            else if (events & EPOLLIN) {                                // 有数据到来，读事件
+                assert(users_->find(fd));
+                dealRead_(users_->find(fd));
+            }
+            else if (events & EPOLLOUT) {                               // 有数据要写，写事件
+                assert(users_->find(fd));
+                dealWrite_(users_->find(fd));
+            }
+            else {                                                      // 出错，不支持的事件发生
+                LOG_ERROR("Unexpected epoll event!");
+            }
+        }
+    }
+}
+
+
+// 添加客户端连接
+// 将新客户端的 fd、addr 添加进来
+void EpollReactor::addClient_(int fd, sockaddr_in addr)
+{
+    assert(fd > 0);
+
+    // 添加到 users_ 连接表中
+    HttpConn* client = &(*users_)[fd];
+    client->init(fd, addr);
+
+    // 如果有设置 超时时间，设置定时器，到期就 关闭客户端连接
+    if (timeoutMS_ > 0) {
+        // 回调函数为 bind：Reactor this->closeInLoop_(client);
+        timer_->add(fd, timeoutMS_, std::bind(&EpollReactor::closeInLoop_, this, client));
+    }
+
+    // 添加到 epoll
+    epoller_->addFd(fd, EPOLLIN | connEvent_);
+
+    // 设置为非阻塞
+    setFdNonblock_(fd);
+
+    LOG_INFO("Client[%d] in!", fd);
+}
+
+
+// 解决监听事件
+void EpollReactor::dealListen_()
+{
+    // 新客户端的地址
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+
+    do {
+        // Accept
+        int fd = accept(listenFd_, (struct sockaddr*)&addr, &len);      // listenFd_ 已被设置为非阻塞
+        if (fd <= 0) {  // 失败直接返回
+            return;
+        }
+        else if (HttpConn::userCount >= MAX_FD || fd >= MAX_FD) {   // 达到最大的客户端容量
+            sendError_(fd, "Server busy!");         // 给客户端发送繁忙信息
+
+            LOG_WARN("Clients is full!");           // 打印日志
+            return;
+        }
+
+        addClient_(fd, addr);           // 正常添加客户端
+
+    } while (listenEvent_ & EPOLLET);   // 如果 监听事件 处于ET模式，一次性处理掉所有新连接请求
+}
+
+
+// 解决读事件
+void EpollReactor::dealRead_(HttpConn* client)
+{
+    assert(client);
+
+    // 更新连接到期时间
+    extentTime_(client);
+
+    if (threadpool_) {      // 线程池添加 读任务
+        threadpool_->addTask(this, &EpollReactor::onRead_, client);
+    }
+    else {                  // 多 Reactor 模式，本线程直接完成
+        onRead_(client);
+    }
+}
+
+
+// 解决写事件
+void EpollReactor::dealWrite_(HttpConn* client)
+{
+    assert(client);
+
+    // 更新连接到期时间
+    extentTime_(client);
+
+    if (threadpool_) {      // 线程池添加 写任务
+        threadpool_->addTask(this, &EpollReactor::onWrite_, client);
+    }
+    else {                  // 多 Reactor 模式，本线程直接完成
+        onWrite_(client);
+    }
+}
+
+
+// 恢复 数据库检验完成的连接，继续处理它的请求
+void EpollReactor::dealVerified_()
+{
+    for (unique_ptr<verifyJob>& job : takeVerified_()) {
+        if (!resumeVerified_(*job)) {   // 等待期间连接已关闭
+            continue;
+        }
+
+        HttpConn* client = job->conn;
+        extentTime_(client);
+
+        if (threadpool_) {      // 线程池添加 处理任务
+            threadpool_->addTask(this, &EpollReactor::onProcess_, client);
+        }
+        else {                  // 多 Reactor 模式，本线程直接完成
+            onProcess_(client);
+        }
+    }
+}
+
+
+// 更新连接到期时间
+void EpollReactor::extentTime_(HttpConn* client)
+{
+    assert(client);
+
+    if (timeoutMS_ > 0) {   // 只要设置了超时时间就更新
+        timer_->adjust(client->getFd(), timeoutMS_);
+    }
+}
+
+
+// 关闭 线程池线程要关闭的连接（在事件循环中，verifyFd_ 可读时调用）
+// 请求之后 连接已被定时器关闭（fd 可能已被新连接复用）时 编号不同，跳过
+void EpollReactor::dealClosing_()
+{
+    vector<pair<HttpConn*, uint64_t>> closing;
+    {
+        lock_guard<mutex> locker(closeMtx_);
+        closing.swap(closing_);
+    }
+
+    for (auto& item : closing) {
+        HttpConn* client = item.first;
+        if (!client->isClosed() && client->getId() == item.second) {
+            closeInLoop_(client);
+        }
+    }
+}
+
+
+// 关闭与客户端的连接（读写任务中调用）
+// 有线程池时 在线程池线程中执行，不能访问定时器：放入 closing_，唤醒事件循环关闭
+// 连接在此之前不关闭，fd 不会被新连接复用；EPOLLONESHOT 未重新注册，期间不会再有该 fd 的事件
+void EpollReactor::closeConn_(HttpConn* client)
+{
+    assert(client);
+
+    if (!threadpool_) {
+        closeInLoop_(client);
+        return;
+    }
+
+    {
+        lock_guard<mutex> locker(closeMtx_);
+        closing_.emplace_back(client, client->getId());
+    }
+
+    uint64_t one = 1;
+    ssize_t ret = write(verifyFd_, &one, sizeof(one));
+    (void)ret;
+}
+
+
+// 在事件循环线程中 关闭与客户端的连接
+void EpollReactor::closeInLoop_(HttpConn* client)
+{
+    assert(client);
+
+    LOG_INFO("Client[%d] quit!", client->getFd());
+
+    // 取消定时器：fd 关闭后可能被新连接复用（多 Reactor 时可能是其他 Reactor 接收的），旧定时器到期时 会关闭那个连接
+    if (timeoutMS_ > 0) {
+        timer_->cancel(client->getFd());
+    }
+
+    epoller_->delFd(client->getFd());               // epoll 删除节点
+    client->Close();                                // 关闭连接
+}
+
+
+// 完成 读事件 的操作，交给线程池线程完成（多 Reactor 时在本线程完成）
+void EpollReactor::onRead_(HttpConn* client)
+{
+    assert(client);
+
+    int readErrno = 0;
+    int ret = client->read(&readErrno);         // 读取客户端发来的数据，保存在缓冲区中
+    if (ret <= 0 && readErrno != EAGAIN) {      // 关闭客户端连接
+        closeConn_(client);
+        return;
+    }
+
+    // 处理客户端请求
+    onProcess_(client);
+}
+
+
+// 完成 写事件 的操作，交给线程池线程完成（多 Reactor 时在本线程完成）
+void EpollReactor::onWrite_(HttpConn* client)
+{
+    assert(client);
+
+    int writeErrno = 0;
+    int ret = client->write(&writeErrno);   // 客户端写入信息，并返回结果
+    if (client->toWriteBytes() == 0) {      // 传输完成
+        if (client->isKeepAlive()) {        // 客户端仍保持长连接
+            onProcess_(client);             // 缓冲区有数据 就继续处理客户端请求，否则将事件改为读事件 监听下一次请求
+            return;
+        }
+    }
+    else if (ret > 0 || writeErrno == EAGAIN) {
+        // 传输中断 暂不可写，或 LT 模式下本次只写了一部分（sendfile 的文件偏移已保存）
+        epoller_->modFd(client->getFd(), connEvent_ | EPOLLOUT);    // 继续传输，重新注册为 写事件
+        return;
+    }
+
+    // 遇到问题，关闭客户端连接（传输完成且客户端已断开连接，或传输失败）
+    closeConn_(client);
+}
+
+
+// 处理保存在缓冲区中的客户端请求 并将事件改为写事件；若缓冲区无内容 则继续保持读事件
+// 遇到注册/登录请求时 交给数据库线程，不注册任何事件，检验完成后由 dealVerified_ 恢复
+void EpollReactor::onProcess_(HttpConn* client)
+{
+    if (client->process()) {            // 成功解析请求，并生成响应信息
+        epoller_->modFd(client->getFd(), connEvent_ | EPOLLOUT);    // 重新注册为 写事件
+    }
+    else if (client->startVerify()) {   // 等待数据库检验，连接挂起
+        verifyAsync_(client);
+    }
+    else {                              // 缓冲区不可读，失败
+        epoller_->modFd(client->getFd(), connEvent_ | EPOLLIN);     // 保持 读事件，监听客户端下一次请求
+    }
+}
+
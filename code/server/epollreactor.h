@@ -0,0 +1,55 @@
+
+#ifndef EPOLL_REACTOR_H
+#define EPOLL_REACTOR_H
+
+#include"reactor.h"
+#include"epoller.h"
+#include"conntable.hpp"
+#include"../pool/threadpool.hpp"
+
+
+// 基于 epoll 的 Reactor：独占一个 Epoller，就绪事件到来后再发起 readv/writev
+// threadpool 不为空时，读写任务交给线程池完成（单 Reactor + 线程池）；
+// threadpool 为空时，读写任务在本 Reactor 所在线程内直接完成（多 Reactor，每个线程一个事件循环）
+// 等待数据库检验的连接 不监听读写事件（EPOLLONESHOT 不再注册），检验完成后 像读事件一样交给线程池 继续处理
+// 定时器只在事件循环线程中访问：线程池线程要关闭的连接 同样经 eventfd 交回事件循环关闭
+class EpollReactor : public Reactor {
+public:
+    EpollReactor(int listenFd, uint32_t listenEvent, uint32_t connEvent, int timeoutMS,
+                ThreadPool* threadpool, ThreadPool* sqlExecutor, ConnTable<HttpConn>* users);
+    ~EpollReactor() = default;
+
+    bool init() override;
+    void loop() override;
+
+private:
+    void addClient_(int fd, sockaddr_in addr);
+
+    void dealListen_();
+    void dealRead_(HttpConn* client);
+    void dealWrite_(HttpConn* client);
+    void dealVerified_();
+    void dealClosing_();
+
+    void extentTime_(HttpConn* client);
+    void closeConn_(HttpConn* client);
+    void closeInLoop_(HttpConn* client);
+
+    void onRead_(HttpConn* client);
+    void onWrite_(HttpConn* client);
+    void onProcess_(HttpConn* client);
+
+    uint32_t listenEvent_;  // 监听事件
+    uint32_t connEvent_;    // 连接事件
+
+    std::unique_ptr<Epoller> epoller_;          // epoll
+    ThreadPool* threadpool_;                    // 线程池，为空则在本线程内处理读写
+
+    ConnTable<HttpConn>* users_;                // 客户端连接表，fd To HttpConn，各 Reactor 共用、只访问自己接收的 fd
+
+    std::mutex closeMtx_;                                   // 保护 closing_
+    std::vector<std::pair<HttpConn*, uint64_t>> closing_;   // 线程池线程要关闭的连接 及其编号，经 verifyFd_ 唤醒事件循环关闭
+};
+
+
+#endif  // EPOLL_REACTOR_H
@@ -0,0 +1,353 @@
+
+#include"iouring.h"
+
+
+// 初始化 io_uring，entries：提交队列大小（完成队列为其 4 倍，多次触发的 accept/recv 会产生大量完成事件）
+IoUring::IoUring(unsigned entries)
+    : ringFd_(-1), sqRing_(MAP_FAILED), sqRingSize_(0), sqeTail_(0), sqes_(nullptr), sqesSize_(0),
+    cqRing_(MAP_FAILED), cqRingSize_(0), bufRing_(nullptr), bufRingSize_(0), bufEntries_(0), bufSize_(0),
+    bufTail_(0), maxEvents_(0)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 4;
+
+    ringFd_ = syscall(__NR_io_uring_setup, entries, &params);
+    if (ringFd_ < 0) {
+        return;
+    }
+
+    // 映射 SQ、CQ 环形队列
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+
+    sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED) {
+        close(ringFd_);
+        ringFd_ = -1;
+        return;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cqRing_ = sqRing_;
+    }
+    else {
+        cqRing_ = mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED) {
+            munmap(sqRing_, sqRingSize_);
+            close(ringFd_);
+            ringFd_ = -1;
+            return;
+        }
+    }
+
+    // 映射 SQE 数组
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = (io_uring_sqe*)mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES);
+    if (sqes_ == MAP_FAILED) {
+        if (cqRing_ != sqRing_) {
+            munmap(cqRing_, cqRingSize_);
+        }
+        munmap(sqRing_, sqRingSize_);
+        close(ringFd_);
+        ringFd_ = -1;
+        return;
+    }
+
+    char* sq = (char*)sqRing_;
+    sqHead_ = (unsigned*)(sq + params.sq_off.head);
+    sqTail_ = (unsigned*)(sq + params.sq_off.tail);
+    sqMask_ = (unsigned*)(sq + params.sq_off.ring_mask);
+    sqArray_ = (unsigned*)(sq + params.sq_off.array);
+    sqEntries_ = params.sq_entries;
+    sqeTail_ = *sqTail_;
+
+    char* cq = (char*)cqRing_;
+    cqHead_ = (unsigned*)(cq + params.cq_off.head);
+    cqTail_ = (unsigned*)(cq + params.cq_off.tail);
+    cqMask_ = (unsigned*)(cq + params.cq_off.ring_mask);
+    cqes_ = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    maxEvents_ = params.cq_entries;
+    events_.reserve(maxEvents_);
+}
+
+
+IoUring::~IoUring()
+{
+    if (ringFd_ < 0) {
+        return;
+    }
+
+    if (bufRing_) {
+        munmap(bufRing_, bufRingSize_);
+    }
+
+    munmap(sqes_, sqesSize_);
+    if (cqRing_ != sqRing_) {
+        munmap(cqRing_, cqRingSize_);
+    }
+    munmap(sqRing_, sqRingSize_);
+
+    close(ringFd_);
+}
+
+
+// 是否初始化成功
+bool IoUring::isValid() const
+{
+    return ringFd_ >= 0;
+}
+
+
+// 检测内核是否支持 io_uring（内核版本过低、或被 seccomp 禁用时返回 false）
+bool IoUring::isSupported()
+{
+    IoUring ring(8);
+    return ring.isValid() && ring.setupBufRing(8, 64);
+}
+
+
+// 注册接收缓冲区环，entries 个大小为 bufSize 的缓冲区，recv 完成时由内核自行挑选缓冲区
+// entries 必须为 2 的幂
+bool IoUring::setupBufRing(unsigned entries, unsigned bufSize)
+{
+    assert(isValid() && !bufRing_);
+    assert(entries > 0 && (entries & (entries - 1)) == 0 && entries <= 32768);
+
+    bufRingSize_ = entries * sizeof(io_uring_buf);
+    void* ring = mmap(nullptr, bufRingSize_, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (ring == MAP_FAILED) {
+        return false;
+    }
+
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)ring;
+    reg.ring_entries = entries;
+    reg.bgid = BUF_GROUP;
+
+    if (syscall(__NR_io_uring_register, ringFd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        munmap(ring, bufRingSize_);
+        return false;
+    }
+
+    bufRing_ = (io_uring_buf*)ring;
+    bufEntries_ = entries;
+    bufSize_ = bufSize;
+    bufTail_ = 0;
+    bufPool_.resize(static_cast<size_t>(entries) * bufSize);
+
+    // 将所有缓冲区交给内核
+    for (unsigned i = 0; i < entries; ++i) {
+        recycleBuf(static_cast<uint16_t>(i));
+    }
+
+    return true;
+}
+
+
+// 返回 bid 号缓冲区的地址
+char* IoUring::getBuf(uint16_t bid)
+{
+    assert(bid < bufEntries_);
+
+    return &bufPool_[static_cast<size_t>(bid) * bufSize_];
+}
+
+
+// 数据取走后，将 bid 号缓冲区归还给内核
+void IoUring::recycleBuf(uint16_t bid)
+{
+    assert(bid < bufEntries_);
+
+    // 只写 addr/len/bid，不能覆盖 resv（bufRing_[0].resv 即环的 tail）
+    io_uring_buf* buf = &bufRing_[bufTail_ & (bufEntries_ - 1)];
+    buf->addr = (uint64_t)getBuf(bid);
+    buf->len = bufSize_;
+    buf->bid = bid;
+
+    __atomic_store_n(&bufRing_[0].resv, ++bufTail_, __ATOMIC_RELEASE);
+}
+
+
+// 多次触发的 accept，一次提交、每来一个新连接产生一个完成事件
+void IoUring::prepAccept(int fd, uint64_t data)
+{
+    io_uring_sqe* sqe = getSqe_();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = data;
+}
+
+
+// 多次触发的 recv，数据由内核写入缓冲区环中的某个缓冲区，完成事件中带回缓冲区 id
+void IoUring::prepRecv(int fd, uint64_t data)
+{
+    io_uring_sqe* sqe = getSqe_();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUF_GROUP;
+    sqe->user_data = data;
+}
+
+
+// 聚集写，MSG_WAITALL 让内核写完全部数据再产生完成事件
+// link 为真时，下一个准备的请求 要等本次发送成功后才执行（发送失败则被取消）
+void IoUring::prepSendmsg(int fd, const struct msghdr* msg, uint64_t data, bool link)
+{
+    io_uring_sqe* sqe = getSqe_();
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)msg;
+    sqe->len = 1;
+    sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+    sqe->flags = link ? IOSQE_IO_LINK : 0;
+    sqe->user_data = data;
+}
+
+
+// 关闭连接的读写两端，仍在等待的 recv 会随之结束
+void IoUring::prepShutdown(int fd, uint64_t data)
+{
+    io_uring_sqe* sqe = getSqe_();
+    sqe->opcode = IORING_OP_SHUTDOWN;
+    sqe->fd = fd;
+    sqe->len = SHUT_RDWR;
+    sqe->user_data = data;
+}
+
+
+// 多次触发的 poll，fd 每次可读时 产生一个完成事件（用于 eventfd 等非 socket 的通知）
+void IoUring::prepPoll(int fd, uint64_t data)
+{
+    io_uring_sqe* sqe = getSqe_();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = data;
+}
+
+
+// 提交所有已准备的请求，并等待完成事件，返回收割到的完成事件数
+// timeoutMs：-1阻塞，0不阻塞，>0超时时间；与 Epoller::wait 相同
+int IoUring::wait(int timeoutMs)
+{
+    unsigned toSubmit = sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    bool hasEvents = !stash_.empty() || (__atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) != *cqHead_);
+
+    // 一次 io_uring_enter 同时完成提交与等待
+    if (timeoutMs != 0 && !hasEvents) {
+        struct __kernel_timespec ts = { timeoutMs / 1000, (timeoutMs % 1000) * 1000000LL };
+        io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = (timeoutMs > 0) ? (uint64_t)&ts : 0;
+
+        enter_(toSubmit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    }
+    else if (toSubmit > 0) {
+        enter_(toSubmit, 0, 0, nullptr, 0);
+    }
+
+    // 收割完成事件：先取 提交队列满时暂存的，再从完成队列取
+    events_.clear();
+    size_t fromStash = std::min(stash_.size(), maxEvents_);
+    events_.insert(events_.end(), stash_.begin(), stash_.begin() + fromStash);
+    stash_.erase(stash_.begin(), stash_.begin() + fromStash);
+    reap_(events_, maxEvents_ - events_.size());
+
+    return static_cast<int>(events_.size());
+}
+
+
+// 返回某个完成事件的 user_data
+uint64_t IoUring::getData(size_t i) const
+{
+    assert(i < events_.size());
+
+    return events_[i].user_data;
+}
+
+
+// 返回某个完成事件的结果（与对应系统调用的返回值相同，出错为 -errno）
+int IoUring::getRes(size_t i) const
+{
+    assert(i < events_.size());
+
+    return events_[i].res;
+}
+
+
+// 返回某个完成事件的标志位（IORING_CQE_F_MORE、IORING_CQE_F_BUFFER 等）
+uint32_t IoUring::getFlags(size_t i) const
+{
+    assert(i < events_.size());
+
+    return events_[i].flags;
+}
+
+
+// 取一个空闲的 SQE；提交队列已满时 先提交，直到内核取走了请求、空出位置
+// 不能覆盖内核尚未取走的 SQE：提交可能失败或只取走一部分（EINTR；完成队列溢出时 EBUSY/EAGAIN），重新读取 SQ 头部再判断
+// 完成队列溢出时 先把完成事件收割到 stash_（之后由 wait 返回），GETEVENTS 让内核把溢出的完成事件移回完成队列
+io_uring_sqe* IoUring::getSqe_()
+{
+    assert(isValid());
+
+    unsigned head;
+    while (sqeTail_ - (head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE)) >= sqEntries_) {
+        int ret = enter_(sqeTail_ - head, 0, IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (ret < 0 && (errno == EBUSY || errno == EAGAIN)) {
+            reap_(stash_, SIZE_MAX);
+        }
+    }
+
+    unsigned index = sqeTail_ & *sqMask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+
+    sqArray_[index] = index;
+    ++sqeTail_;
+    __atomic_store_n(sqTail_, sqeTail_, __ATOMIC_RELEASE);
+
+    return sqe;
+}
+
+
+// 从完成队列收割 最多 max 个完成事件，追加到 out
+size_t IoUring::reap_(std::vector<io_uring_cqe>& out, size_t max)
+{
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    size_t cnt = 0;
+    while (head != tail && cnt < max) {
+        out.push_back(cqes_[head & *cqMask_]);
+        ++head;
+        ++cnt;
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+
+    return cnt;
+}
+
+
+// io_uring_enter 系统调用
+int IoUring::enter_(unsigned toSubmit, unsigned minComplete, unsigned flags, void* arg, size_t argSize)
+{
+    int ret = syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete, flags, arg, argSize);
+    if (ret < 0 && errno != ETIME && errno != EINTR) {
+        return -1;
+    }
+
+    return ret;
+}
@@ -0,0 +1,91 @@
+
+#ifndef IO_URING_H
+#define IO_URING_H
+
+#include<stdint.h>
+#include<linux/io_uring.h>
+#include<sys/syscall.h>
+#include<sys/mman.h>
+#include<sys/uio.h>
+#include<sys/socket.h>
+#include<poll.h>
+#include<signal.h>
+#include<unistd.h>
+#include<assert.h>
+#include<string.h>
+#include<errno.h>
+#include<vector>
+#include<algorithm>
+
+
+// io_uring 的简单封装，直接使用系统调用，不依赖 liburing
+// 与 Epoller 的用法保持一致：先 prep* 准备请求，再 wait 一次性提交并收割完成事件
+class IoUring {
+public:
+    explicit IoUring(unsigned entries = 1024);
+    ~IoUring();
+
+    bool isValid() const;
+    static bool isSupported();
+
+    bool setupBufRing(unsigned entries, unsigned bufSize);
+    char* getBuf(uint16_t bid);
+    void recycleBuf(uint16_t bid);
+
+    void prepAccept(int fd, uint64_t data);
+    void prepRecv(int fd, uint64_t data);
+    void prepSendmsg(int fd, const struct msghdr* msg, uint64_t data, bool link = false);
+    void prepShutdown(int fd, uint64_t data);
+    void prepPoll(int fd, uint64_t data);
+
+    int wait(int timeoutMs = -1);
+
+    uint64_t getData(size_t i) const;
+    int getRes(size_t i) const;
+    uint32_t getFlags(size_t i) const;
+
+    static const uint16_t BUF_GROUP = 0;    // 提供给内核的缓冲区组 id
+
+private:
+    io_uring_sqe* getSqe_();
+    size_t reap_(std::vector<io_uring_cqe>& out, size_t max);
+    int enter_(unsigned toSubmit, unsigned minComplete, unsigned flags, void* arg, size_t argSize);
+
+    int ringFd_;                    // io_uring 实例的 fd
+
+    // 提交队列 SQ
+    void* sqRing_;                  // SQ 环形队列映射地址
+    size_t sqRingSize_;
+    unsigned* sqHead_;
+    unsigned* sqTail_;
+    unsigned* sqMask_;
+    unsigned* sqArray_;
+    unsigned sqEntries_;
+    unsigned sqeTail_;              // 本地已准备好的 SQE 尾位置
+    io_uring_sqe* sqes_;            // SQE 数组映射地址
+    size_t sqesSize_;
+
+    // 完成队列 CQ
+    void* cqRing_;                  // CQ 环形队列映射地址（支持 SINGLE_MMAP 时与 sqRing_ 相同）
+    size_t cqRingSize_;
+    unsigned* cqHead_;
+    unsigned* cqTail_;
+    unsigned* cqMask_;
+    io_uring_cqe* cqes_;
+
+    // 提供给内核的接收缓冲区（provided buffer ring）
+    // C++ 下头文件中 io_uring_buf_ring 的柔性数组会多出一个空结构体，偏移与内核不一致，因此直接按 io_uring_buf 数组访问
+    io_uring_buf* bufRing_;         // 缓冲区环，环的 tail 与 bufRing_[0].resv 重叠
+    size_t bufRingSize_;
+    unsigned bufEntries_;
+    unsigned bufSize_;
+    uint16_t bufTail_;
+    std::vector<char> bufPool_;
+
+    std::vector<io_uring_cqe> events_;  // 本次收割的完成事件
+    size_t maxEvents_;                  // 一次最多收割的完成事件数（完成队列大小）
+    std::vector<io_uring_cqe> stash_;   // 提交队列满、完成队列溢出时 先收割暂存的完成事件，由下一次 wait 返回
+};
+
+
+#endif  // IO_URING_H
@@ -0,0 +1,124 @@
+
+#include"reactor.h"
+using namespace std;
+
+
+// 监听 fd，超时时间，数据库线程池（账号存放在进程内时为空）
+Reactor::Reactor(int listenFd, int timeoutMS, ThreadPool* sqlExecutor)
+    : listenFd_(listenFd), timeoutMS_(timeoutMS), isClose_(false), timer_(new TimingWheel()),
+    sqlExecutor_(sqlExecutor), verifyFd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+}
+
+
+Reactor::~Reactor()
+{
+    close(listenFd_);   // 关闭监听端口
+
+    if (verifyFd_ >= 0) {
+        close(verifyFd_);
+    }
+}
+
+
+// 退出事件循环（下一次等待事件返回后生效）
+void Reactor::stop()
+{
+    isClose_ = true;
+}
+
+
+// 发送错误信息给客户端
+// 客户端 fd，错误信息 info
+void Reactor::sendError_(int fd, const char* info)
+{
+    assert(fd > 0);
+
+    int ret = send(fd, info, strlen(info), 0);
+    if (ret < 0) {
+        LOG_WARN("Send error to client[%d] error!", fd);
+    }
+
+    close(fd);      // 发送错误信息后 关闭客户端
+}
+
+
+// 设置 fd 为非阻塞
+int Reactor::setFdNonblock_(int fd)
+{
+    assert(fd > 0);
+
+    return fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+
+// 把连接中等待检验的注册/登录请求 交给数据库线程，完成后放入完成队列 并唤醒事件循环
+// 调用前 conn->startVerify() 已返回 true，连接挂起
+void Reactor::verifyAsync_(HttpConn* conn)
+{
+    assert(sqlExecutor_);   // 账号存储不阻塞时（没有数据库线程池）请求在解析时已检验，不会到这里
+
+    const HttpRequest& request = conn->request();
+
+    unique_ptr<verifyJob> job(new verifyJob);
+    job->conn = conn;
+    job->connId = conn->getId();
+    job->name = request.getPost("username");
+    job->pwd = request.getPost("password");
+    job->isLogin = request.isLogin();
+    job->submitNS = Metrics::nowNS();
+    job->result = UserStore::FAIL;
+
+    sqlExecutor_->addTask([this, job = std::move(job)]() mutable {
+        // 检验完成（可能在批量写入线程中）时 放入完成队列，唤醒事件循环
+        verifyJob* pending = job.release();
+        auto done = [this, pending](UserStore::RESULT result) {
+            pending->result = result;
+            {
+                lock_guard<mutex> locker(verifyMtx_);
+                verified_.emplace_back(pending);
+            }
+
+            uint64_t one = 1;
+            ssize_t ret = write(verifyFd_, &one, sizeof(one));
+            (void)ret;
+        };
+
+        // 在数据库线程池中排队的时间 也计入等待时间；排队已超时的请求不再访问数据库，直接返回 503
+        int64_t waitedMS = (Metrics::nowNS() - pending->submitNS) / 1000000;
+        if (waitedMS < SQL_WAIT_MS) {
+            HttpRequest::userVerifyAsync(pending->name, pending->pwd, pending->isLogin,
+                                         SQL_WAIT_MS - static_cast<int>(waitedMS), done);
+        }
+        else {
+            done(UserStore::BUSY);
+        }
+    });
+}
+
+
+// 取出所有已完成的检验（在事件循环中，verifyFd_ 可读时调用）
+vector<unique_ptr<Reactor::verifyJob>> Reactor::takeVerified_()
+{
+    uint64_t count;
+    ssize_t ret = read(verifyFd_, &count, sizeof(count));     // 清空 eventfd 计数
+    (void)ret;
+
+    vector<unique_ptr<verifyJob>> jobs;
+    lock_guard<mutex> locker(verifyMtx_);
+    jobs.swap(verified_);
+    return jobs;
+}
+
+
+// 把检验结果交给连接；连接已关闭 或已被新连接复用时返回 false，不需要恢复
+bool Reactor::resumeVerified_(const verifyJob& job)
+{
+    HttpConn* conn = job.conn;
+    if (conn->isClosed() || conn->getId() != job.connId) {
+        return false;
+    }
+
+    conn->onVerified(job.result);
+    return true;
+}
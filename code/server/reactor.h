@@ -0,0 +1,76 @@
+
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include<memory>
+#include<atomic>
+#include<mutex>
+#include<vector>
+#include<string>
+#include<fcntl.h>
+#include<unistd.h>
+#include<assert.h>
+#include<errno.h>
+#include<sys/socket.h>
+#include<netinet/in.h>
+#include<arpa/inet.h>
+#include<sys/eventfd.h>
+
+#include"../log/log.h"
+#include"../log/metrics.h"
+#include"../timer/timingwheel.h"
+#include"../pool/threadpool.hpp"
+#include"../http/httpconn.h"
+
+
+// 一个 Reactor 即一个事件循环：独占一个监听 fd、一个定时器 以及自己接收的那部分客户端连接
+// 具体的 IO 后端（epoll / io_uring）由子类实现，WebServer 启动时选择
+// 注册/登录请求的数据库访问 交给专门的数据库线程池完成，连接在此期间挂起；
+// 完成结果放入本 Reactor 的完成队列，并通过 eventfd 唤醒事件循环，由事件循环恢复连接
+class Reactor {
+public:
+    virtual ~Reactor();
+
+    virtual bool init() = 0;
+    virtual void loop() = 0;
+    void stop();
+
+    static const int MAX_FD = 65536;            // 最大的文件描述符数
+    static const int SQL_WAIT_MS = 500;         // 注册/登录请求 等待数据库连接的最长时间，超时返回 503
+
+protected:
+    // 一次用户身份检验：参数在提交时拷贝，数据库线程不访问连接
+    struct verifyJob {
+        HttpConn* conn;
+        uint64_t connId;        // 提交时的连接编号，完成时连接已关闭或被新连接复用 则丢弃结果
+        std::string name;
+        std::string pwd;
+        bool isLogin;
+        int64_t submitNS;       // 提交时间，排队与等待连接的总时间不超过 SQL_WAIT_MS
+        UserStore::RESULT result;   // 检验结果
+    };
+
+    Reactor(int listenFd, int timeoutMS, ThreadPool* sqlExecutor);
+
+    static void sendError_(int fd, const char* info);
+    static int setFdNonblock_(int fd);
+
+    void verifyAsync_(HttpConn* conn);
+    std::vector<std::unique_ptr<verifyJob>> takeVerified_();
+    static bool resumeVerified_(const verifyJob& job);
+
+    int listenFd_;          // 本 Reactor 的监听 fd
+    int timeoutMS_;         // 超时时间
+
+    std::atomic<bool> isClose_;     // 是否退出事件循环
+
+    std::unique_ptr<TimingWheel> timer_;        // 定时器
+
+    ThreadPool* sqlExecutor_;                   // 数据库线程池，各 Reactor 共用；账号存放在进程内时为空
+    int verifyFd_;                              // eventfd，有检验完成时可读，由子类注册到自己的事件循环（EpollReactor 也用它交回 线程池线程要关闭的连接）
+    std::mutex verifyMtx_;                      // 保护 verified_
+    std::vector<std::unique_ptr<verifyJob>> verified_;  // 已完成、等待事件循环处理的检验
+};
+
+
+#endif  // REACTOR_H
@@ -0,0 +1,350 @@
+
+#include"uringreactor.h"
+using namespace std;
+
+
+// 监听 fd，超时时间，数据库线程池，连接表
+UringReactor::UringReactor(int listenFd, int timeoutMS, ThreadPool* sqlExecutor, ConnTable<Conn>* users)
+    : Reactor(listenFd, timeoutMS, sqlExecutor), ring_(new IoUring(RING_ENTRIES)),
+    acceptArmed_(false), verifyArmed_(false), users_(users)
+{
+    assert(users_);
+}
+
+
+// 注册接收缓冲区
+bool UringReactor::init()
+{
+    if (!ring_->isValid()) {
+        LOG_ERROR("IoUring setup error!");
+        return false;
+    }
+
+    if (!ring_->setupBufRing(BUF_COUNT, BUF_SIZE)) {
+        LOG_ERROR("IoUring register buffer ring error!");
+        return false;
+    }
+
+    if (verifyFd_ < 0) {
+        LOG_ERROR("Create verify eventfd error!");
+        return false;
+    }
+
+    return true;
+}
+
+
+// 事件循环
+void UringReactor::loop()
+{
+    int timeMS = -1;    // timeout == -1，无事件时将阻塞
+
+    while (!isClose_) {
+
+        // 开启定时器
+        if (timeoutMS_ > 0) {
+            timeMS = timer_->getNextTick();
+        }
+
+        // 多次触发的 accept 被内核终止时，重新提交
+        if (!acceptArmed_) {
+            ring_->prepAccept(listenFd_, makeData_(ACCEPT, listenFd_));
+            acceptArmed_ = true;
+        }
+        if (!verifyArmed_) {
+            ring_->prepPoll(verifyFd_, makeData_(VERIFY, verifyFd_));
+            verifyArmed_ = true;
+        }
+
+        // 提交本轮所有请求，并处理完成事件
+        int eventCnt = ring_->wait(timeMS);
+        for (int i = 0; i < eventCnt; ++i) {
+            uint64_t data = ring_->getData(i);
+            int res = ring_->getRes(i);
+            uint32_t flags = ring_->getFlags(i);
+
+            OP_TYPE op = static_cast<OP_TYPE>(data >> 32);
+            int fd = static_cast<int>(data & 0xffffffff);
+
+            switch (op)
+            {
+            case ACCEPT:
+                onAccept_(res, flags);
+                break;
+            case RECV:
+                onRecv_(fd, res, flags);
+                break;
+            case SEND:
+                onSend_(fd, res);
+                break;
+            case SHUTDOWN:
+                onShutdown_(fd, res);
+                break;
+            case VERIFY:
+                onVerified_(flags);
+                break;
+            default:
+                LOG_ERROR("Unexpected io_uring event!");
+                break;
+            }
+        }
+    }
+}
+
+
+// 将 请求类型、fd 编码进 user_data
+uint64_t UringReactor::makeData_(OP_TYPE op, int fd)
+{
+    return (static_cast<uint64_t>(op) << 32) | static_cast<uint32_t>(fd);
+}
+
+
+// 新连接到来
+void UringReactor::onAccept_(int res, uint32_t flags)
+{
+    if (!(flags & IORING_CQE_F_MORE)) {     // accept 已被内核终止，下一轮重新提交
+        acceptArmed_ = false;
+    }
+
+    if (res < 0) {
+        LOG_WARN("Accept error: %s", strerror(-res));
+        return;
+    }
+
+    if (HttpConn::userCount >= MAX_FD || res >= MAX_FD) {   // 达到最大的客户端容量
+        sendError_(res, "Server busy!");
+        LOG_WARN("Clients is full!");
+        return;
+    }
+
+    addClient_(res);
+}
+
+
+// 收到客户端数据
+void UringReactor::onRecv_(int fd, int res, uint32_t flags)
+{
+    Conn* client = users_->find(fd);
+    assert(client);
+
+    if (!(flags & IORING_CQE_F_MORE)) {     // 本次 recv 已结束
+        client->recving = false;
+        --client->inflight;
+    }
+
+    if (res > 0) {
+        // 将数据拷贝到读缓冲区，并马上将缓冲区归还给内核
+        uint16_t bid = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+        client->conn.appendRead(ring_->getBuf(bid), res);
+        ring_->recycleBuf(bid);
+
+        if (!client->closing) {
+            extentTime_(client);
+
+            if (!client->sending) {     // 上一个响应发送完之前，数据先留在读缓冲区
+                onProcess_(client);
+            }
+            if (!client->recving) {
+                submitRecv_(client);
+            }
+        }
+    }
+    else if (res == -ENOBUFS && !client->closing) {     // 缓冲区暂时用完，重新提交
+        submitRecv_(client);
+    }
+    else {                                              // 对端关闭 或出错
+        closeConn_(client);
+    }
+
+    releaseConn_(client);
+}
+
+
+// 响应发送完成
+void UringReactor::onSend_(int fd, int res)
+{
+    Conn* client = users_->find(fd);
+    assert(client);
+
+    --client->inflight;
+    client->sending = false;
+
+    if (res < 0 || client->closing) {   // 发送失败
+        closeConn_(client);
+        releaseConn_(client);
+        return;
+    }
+
+    client->conn.hasWritten(res);
+    extentTime_(client);
+
+    if (client->conn.toWriteBytes() > 0) {  // 未写完，继续发送剩余部分
+        submitSend_(client);
+    }
+    else if (client->conn.isKeepAlive()) {  // 长连接，处理读缓冲区中已到达的下一个请求
+        onProcess_(client);
+    }
+    // 非长连接：已链接的 shutdown 会接着执行
+}
+
+
+// shutdown 完成
+void UringReactor::onShutdown_(int fd, int res)
+{
+    Conn* client = users_->find(fd);
+    assert(client);
+
+    --client->inflight;
+
+    // 链接在前面的 sendmsg 未写完时 shutdown 会被取消，等剩余数据发送时再链接一次
+    if (res != -ECANCELED) {
+        client->closing = true;
+    }
+
+    releaseConn_(client);
+}
+
+
+// 数据库检验完成，恢复等待的连接
+void UringReactor::onVerified_(uint32_t flags)
+{
+    if (!(flags & IORING_CQE_F_MORE)) {     // poll 已被内核终止，下一轮重新提交
+        verifyArmed_ = false;
+    }
+
+    for (unique_ptr<verifyJob>& job : takeVerified_()) {
+        Conn* client = users_->find(job->conn->getFd());
+        if (!client || !client->isOpen || client->closing || !resumeVerified_(*job)) {    // 等待期间连接已关闭
+            continue;
+        }
+
+        extentTime_(client);
+        if (!client->sending) {
+            onProcess_(client);
+        }
+    }
+}
+
+
+// 添加客户端连接
+void UringReactor::addClient_(int fd)
+{
+    assert(fd > 0);
+
+    // 多次触发的 accept 不返回对端地址，单独获取
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    getpeername(fd, (struct sockaddr*)&addr, &len);
+
+    Conn* client = &(*users_)[fd];
+    client->conn.init(fd, addr);
+    client->inflight = 0;
+    client->isOpen = true;
+    client->recving = false;
+    client->sending = false;
+    client->closing = false;
+
+    // 如果有设置 超时时间，设置定时器，到期就 关闭客户端连接
+    if (timeoutMS_ > 0) {
+        timer_->add(fd, timeoutMS_, std::bind(&UringReactor::closeConn_, this, client));
+    }
+
+    submitRecv_(client);
+
+    LOG_INFO("Client[%d] in!", fd);
+}
+
+
+// 提交 多次触发的 recv
+void UringReactor::submitRecv_(Conn* client)
+{
+    int fd = client->conn.getFd();
+    ring_->prepRecv(fd, makeData_(RECV, fd));
+
+    client->recving = true;
+    ++client->inflight;
+}
+
+
+// 提交 响应，非长连接时链接一个 shutdown，发送完成后由内核直接关闭连接
+void UringReactor::submitSend_(Conn* client)
+{
+    int fd = client->conn.getFd();
+    bool link = !client->conn.isKeepAlive();
+
+    memset(&client->msg, 0, sizeof(client->msg));
+    client->msg.msg_iov = client->conn.iov();
+    client->msg.msg_iovlen = client->conn.iovCnt();
+
+    ring_->prepSendmsg(fd, &client->msg, makeData_(SEND, fd), link);
+    client->sending = true;
+    ++client->inflight;
+
+    if (link) {
+        ring_->prepShutdown(fd, makeData_(SHUTDOWN, fd));
+        ++client->inflight;
+    }
+}
+
+
+// 处理保存在读缓冲区中的请求，生成响应后提交发送；遇到注册/登录请求时 交给数据库线程
+void UringReactor::onProcess_(Conn* client)
+{
+    if (client->conn.process()) {
+        submitSend_(client);
+    }
+    else if (client->conn.startVerify()) {
+        verifyAsync_(&client->conn);
+    }
+}
+
+
+// 更新连接到期时间
+void UringReactor::extentTime_(Conn* client)
+{
+    if (timeoutMS_ > 0) {
+        timer_->adjust(client->conn.getFd(), timeoutMS_);
+    }
+}
+
+
+// 关闭与客户端的连接：先 shutdown 结束仍在等待的 recv，所有请求完成后再 close
+void UringReactor::closeConn_(Conn* client)
+{
+    assert(client);
+
+    if (!client->isOpen || client->closing) {
+        return;
+    }
+
+    client->closing = true;
+
+    if (client->recving) {
+        int fd = client->conn.getFd();
+        ring_->prepShutdown(fd, makeData_(SHUTDOWN, fd));
+        ++client->inflight;
+    }
+
+    releaseConn_(client);
+}
+
+
+// 正在关闭 且没有未完成的请求时，关闭 fd
+void UringReactor::releaseConn_(Conn* client)
+{
+    if (!client->closing || client->inflight > 0) {
+        return;
+    }
+
+    LOG_INFO("Client[%d] quit!", client->conn.getFd());
+
+    // 取消定时器：fd 关闭后可能被其他 Reactor 接收的新连接复用，旧定时器不能再关闭那个连接
+    if (timeoutMS_ > 0) {
+        timer_->cancel(client->conn.getFd());
+    }
+
+    client->isOpen = false;
+    client->closing = false;
+    client->conn.Close();
+}
@@ -0,0 +1,73 @@
+
+#ifndef URING_REACTOR_H
+#define URING_REACTOR_H
+
+#include"reactor.h"
+#include"iouring.h"
+#include"conntable.hpp"
+
+
+// 基于 io_uring 的 Reactor：完成事件驱动，所有读写都在本线程内完成
+// 多次触发的 accept 与 recv 只需提交一次；recv 数据由内核写入提供的缓冲区；
+// 响应用 sendmsg 提交，非长连接时再链接一个 shutdown；
+// 一轮事件循环只需一次 io_uring_enter 完成全部提交与等待
+// 等待数据库检验的连接 recv 仍在进行，收到的数据留在读缓冲区，检验完成后再处理
+class UringReactor : public Reactor {
+public:
+    // 一个客户端连接，及其在 io_uring 中尚未完成的请求状态
+    struct Conn {
+        HttpConn conn;
+        int inflight;           // 尚未完成的请求数，为 0 时才能关闭 fd
+        bool isOpen;            // 连接是否打开
+        bool recving;           // 多次触发的 recv 是否仍在等待
+        bool sending;           // 是否有 sendmsg 尚未完成
+        bool closing;           // 是否正在关闭
+        struct msghdr msg;      // sendmsg 参数，请求完成前需保持有效
+    };
+
+    UringReactor(int listenFd, int timeoutMS, ThreadPool* sqlExecutor, ConnTable<Conn>* users);
+    ~UringReactor() = default;
+
+    bool init() override;
+    void loop() override;
+
+private:
+    // 请求类型，与 fd 一起编码进 user_data
+    enum OP_TYPE {
+        ACCEPT,
+        RECV,
+        SEND,
+        SHUTDOWN,
+        VERIFY,         // 数据库检验完成的 eventfd 可读
+    };
+
+    static uint64_t makeData_(OP_TYPE op, int fd);
+
+    void onAccept_(int res, uint32_t flags);
+    void onRecv_(int fd, int res, uint32_t flags);
+    void onSend_(int fd, int res);
+    void onShutdown_(int fd, int res);
+    void onVerified_(uint32_t flags);
+
+    void addClient_(int fd);
+    void submitRecv_(Conn* client);
+    void submitSend_(Conn* client);
+    void onProcess_(Conn* client);
+
+    void extentTime_(Conn* client);
+    void closeConn_(Conn* client);
+    void releaseConn_(Conn* client);
+
+    static const unsigned RING_ENTRIES = 1024;  // 提交队列大小
+    static const unsigned BUF_COUNT = 1024;     // 接收缓冲区数量
+    static const unsigned BUF_SIZE = 4096;      // 单个接收缓冲区大小
+
+    std::unique_ptr<IoUring> ring_;             // io_uring
+    bool acceptArmed_;                          // 多次触发的 accept 是否仍在等待
+    bool verifyArmed_;                          // 多次触发的 eventfd poll 是否仍在等待
+
+    ConnTable<Conn>* users_;                    // 客户端连接表，fd To Conn，各 Reactor 共用、只访问自己接收的 fd
+};
+
+
+#endif  // URING_REACTOR_H
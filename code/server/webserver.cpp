@@ -7,12 +7,15 @@ WebServer::WebServer(
         // 监听端口，ET模式，timeoutMs，优雅退出
         // Mysql：端口，用户名，密码，数据库名
         // 连接池数量，线程池数量，日志开关、等级、异步队列容量
+        // Reactor数量，IO后端，静态文件缓存大小，sendfile 阈值，连接池最少连接数，账号文件
         int port, int trigMode, int timeoutMS, bool optLinger,
         int sqlPort, const char* sqlUser, const char* sqlPwd, const char* dbName, 
-        int connPoolNum, int threadNum, bool openLog, int logLevel, int logQueSize)
+        int connPoolNum, int threadNum, bool openLog, int logLevel, int logQueSize,
+        int reactorNum, int ioMode, int cacheMB, int sendfileKB, int connPoolMin,
+        const char* userFile)
         
         : port_(port), timeoutMS_(timeoutMS), openLinger_(optLinger), isClose_(false),
-        timer_(new HeapTimer()), threadpool_(new ThreadPool(threadNum)), epoller_(new Epoller())
+        reactorNum_(reactorNum > 1 ? reactorNum : 1), ioMode_(ioMode)
 {
     // 生成资源所在的路径
     srcDir_ = getcwd(nullptr, 256);     // getcwd：返回当前工作目录的绝对路径
@@ -24,17 +27,142 @@ WebServer::WebServer(
     HttpConn::srcDir = srcDir_;
     HttpConn::userCount = 0;
 
-    // 初始化 SqlConnPool 的静态成员
-    // 主机IP，端口，用户名，密码，数据库名，连接数
-    SqlConnPool::instance()->init("127.0.0.1", sqlPort, sqlUser, sqlPwd, dbName, connPoolNum);
+    // 初始化 静态文件缓存，所有连接共享
+    FileCache::instance()->init(static_cast<size_t>(cacheMB > 0 ? cacheMB : 0) << 20);
+
+    // 初始化 用户账号的存储后端：指定了账号文件时 使用进程内存储，不连接数据库
+    bool useMemStore = userFile && *userFile;
+    bool userStoreFail = false;
+    if (useMemStore) {
+        MemUserStore* memStore = new MemUserStore();
+        userStore_.reset(memStore);
+        if (!memStore->open(userFile)) {
+            isClose_ = true;
+            userStoreFail = true;
+        }
+    }
+    else {
+        // 初始化 SqlConnPool 的静态成员
+        // 主机IP，端口，用户名，密码，数据库名，最多连接数，最少连接数
+        SqlConnPool::instance()->init("127.0.0.1", sqlPort, sqlUser, sqlPwd, dbName, connPoolNum, connPoolMin);
+        userStore_.reset(new SqlUserStore());
+    }
+    HttpRequest::userStore = userStore_.get();
 
     // 初始化 ET 模式
     initEventMode_(trigMode);
 
-    // 初始化 socket
-    if (!initSocket_()) {
-        isClose_ = true;   // 初始化失败 则关闭服务器
+    // 内核不支持 io_uring 时，退回 epoll
+    bool uringFallback = false;
+    if (ioMode_ == 1 && !IoUring::isSupported()) {
+        ioMode_ = 0;
+        uringFallback = true;
+    }
+
+    // 大文件用 sendfile 发送；io_uring 模式由 sendmsg 提交聚集写，不使用 sendfile
+    HttpResponse::sendfileThreshold = (ioMode_ == 0 && sendfileKB > 0) ? static_cast<size_t>(sendfileKB) << 10 : 0;
+
+    // 只有 epoll 单 Reactor 模式需要线程池；多 Reactor 或 io_uring 模式下 读写都在各自的事件循环线程内完成
+    if (ioMode_ == 0 && reactorNum_ == 1) {
+        threadpool_.reset(new ThreadPool(threadNum));
+    }
+
+    // 数据库线程池：每个线程至多占用一个数据库连接，不会在连接池上等待；事件循环与读写线程不再访问数据库
+    // 账号存放在进程内时 注册/登录在解析请求时直接完成，不需要
+    if (!useMemStore) {
+        sqlExecutor_.reset(new ThreadPool(connPoolNum));
+    }
+
+    // 初始化连接表
+    if (ioMode_ == 1) {
+        uringUsers_.reset(new ConnTable<UringReactor::Conn>(Reactor::MAX_FD));
+    }
+    else {
+        users_.reset(new ConnTable<HttpConn>(Reactor::MAX_FD));
+    }
+
+    // 初始化 Reactor，每个 Reactor 拥有一个独立的监听 socket（多 Reactor 时通过 SO_REUSEPORT 绑定同一端口）
+    for (int i = 0; i < reactorNum_; ++i) {
+        int listenFd = initSocket_();
+        if (listenFd < 0) {
+            isClose_ = true;   // 初始化失败 则关闭服务器
+            break;
+        }
+
+        if (ioMode_ == 1) {
+            reactors_.emplace_back(new UringReactor(listenFd, timeoutMS_, sqlExecutor_.get(), uringUsers_.get()));
+        }
+        else {
+            reactors_.emplace_back(new EpollReactor(listenFd, listenEvent_, connEvent_, timeoutMS_,
+                                                    threadpool_.get(), sqlExecutor_.get(), users_.get()));
+        }
+        if (!reactors_.back()->init()) {
+            isClose_ = true;
+            break;
+        }
+    }
+
+    // 注册运行指标中的当前值，由 /__metrics 输出
+    Metrics* metrics = Metrics::instance();
+    metrics->addGauge("webserver_connections", "Current client connections.", [] {
+        return static_cast<double>(HttpConn::userCount.load());
+    });
+    if (threadpool_) {
+        ThreadPool* pool = threadpool_.get();
+        metrics->addGauge("webserver_threadpool_queue_depth", "Tasks waiting in the thread pool.", [pool] {
+            return static_cast<double>(pool->queueSize());
+        });
+    }
+    // 账号存放在进程内时 没有数据库线程池、连接池与用户身份缓存
+    if (useMemStore) {
+        MemUserStore* memStore = static_cast<MemUserStore*>(userStore_.get());
+        metrics->addGauge("webserver_memuserstore_users", "Accounts held by the in-process user store.", [memStore] {
+            return static_cast<double>(memStore->size());
+        });
     }
+    else {
+        ThreadPool* sqlExecutor = sqlExecutor_.get();
+        metrics->addGauge("webserver_sql_executor_queue_depth", "Login/register requests waiting for a database thread.", [sqlExecutor] {
+            return static_cast<double>(sqlExecutor->queueSize());
+        });
+        metrics->addGauge("webserver_sqlconnpool_free_connections", "Free MySQL connections in the pool.", [] {
+            return static_cast<double>(SqlConnPool::instance()->getFreeConnCount());
+        });
+        metrics->addGauge("webserver_sqlconnpool_in_use_connections", "MySQL connections currently taken from the pool.", [] {
+            return static_cast<double>(SqlConnPool::instance()->getInUseConnCount());
+        });
+        metrics->addGauge("webserver_sqlconnpool_connections", "MySQL connections currently open.", [] {
+            return static_cast<double>(SqlConnPool::instance()->getConnCount());
+        });
+        metrics->addCounter("webserver_sqlconnpool_broken_total", "MySQL connections found dead by the pool and closed.", [] {
+            return static_cast<double>(SqlConnPool::instance()->getBrokenCount());
+        });
+        metrics->addCounter("webserver_sqlconnpool_timeouts_total", "Times no MySQL connection became free within the wait limit.", [] {
+            return static_cast<double>(SqlConnPool::instance()->getTimeoutCount());
+        });
+        metrics->addCounter("webserver_sqlconnpool_unavailable_total", "Times no MySQL connection was returned because the database was unreachable.", [] {
+            return static_cast<double>(SqlConnPool::instance()->getUnavailableCount());
+        });
+        metrics->addCounter("webserver_usercache_hits_total", "Login/register requests answered by the user cache.", [] {
+            return static_cast<double>(UserCache::instance()->hits());
+        });
+        metrics->addCounter("webserver_usercache_misses_total", "Login/register requests that went to the database.", [] {
+            return static_cast<double>(UserCache::instance()->misses());
+        });
+        metrics->addGauge("webserver_usercache_entries", "Entries held by the user cache.", [] {
+            return static_cast<double>(UserCache::instance()->size());
+        });
+        SqlUserStore* sqlStore = static_cast<SqlUserStore*>(userStore_.get());
+        metrics->addCounter("webserver_register_batches_total", "Transactions used to write registrations in batches.", [sqlStore] {
+            return static_cast<double>(sqlStore->getBatchCount());
+        });
+        metrics->addCounter("webserver_register_batch_rows_total", "Registrations written through batches.", [sqlStore] {
+            return static_cast<double>(sqlStore->getBatchRowCount());
+        });
+    }
+    metrics->addGauge("webserver_filecache_bytes", "Bytes held by the static file cache.", [] {
+        return static_cast<double>(FileCache::instance()->usedBytes());
+    });
 
     // 初始化日志系统
     if (openLog) {
@@ -42,6 +170,9 @@ WebServer::WebServer(
         Log::instance()->init(logLevel, "./log", ".log", logQueSize);
         
         if (isClose_) {     // 初始化失败，关闭服务器
+            if (userStoreFail) {
+                LOG_ERROR("Open user file %s error!", userFile);
+            }
             LOG_ERROR("======== Server init error! ========");
         }
         else {
@@ -52,7 +183,23 @@ WebServer::WebServer(
                         (connEvent_ & EPOLLET ? "ET" : "LT"));
             LOG_INFO("LogSys level:%d", logLevel);                                      // 打印日志等级
             LOG_INFO("srcDir:%s", srcDir_);                                             // 打印资源路径
-            LOG_INFO("SqlConnPool num:%d, ThreadPool num:%d", connPoolNum, threadNum);  // 打印 Mysql连接线程数、线程池线程数
+            if (useMemStore) {
+                LOG_INFO("UserStore: memory, file:%s, users:%zu, ThreadPool num:%d",   // 打印账号文件、账号数、线程池线程数
+                            userFile, static_cast<MemUserStore*>(userStore_.get())->size(),
+                            threadpool_ ? threadNum : 0);
+            }
+            else {
+                LOG_INFO("SqlConnPool num:%d-%d, ThreadPool num:%d",                    // 打印 Mysql连接数范围、线程池线程数
+                            connPoolMin > 0 && connPoolMin < connPoolNum ? connPoolMin : connPoolNum, connPoolNum,
+                            threadpool_ ? threadNum : 0);
+            }
+            LOG_INFO("Reactor num:%d, IO Mode:%s", reactorNum_,                         // 打印 Reactor 数量、IO 后端
+                        ioMode_ == 1 ? "io_uring" : "epoll");
+            LOG_INFO("FileCache size:%dMB, Sendfile threshold:%zuKB",                  // 打印静态文件缓存大小、sendfile 阈值
+                        cacheMB > 0 ? cacheMB : 0, HttpResponse::sendfileThreshold >> 10);
+            if (uringFallback) {
+                LOG_WARN("io_uring not supported, fall back to epoll");
+            }
         }
     }
 }
@@ -60,9 +207,15 @@ WebServer::WebServer(
 
 WebServer::~WebServer()
 {
-    close(listenFd_);                       // 关闭监听端口
     isClose_ = true;                        // 设置服务器关闭
+    Metrics::instance()->clearGauges();     // 指标回调引用的线程池即将销毁
     free(srcDir_);                          // free掉 指针指向的空间
+    if (sqlExecutor_) {                     // 等待数据库线程完成排队中的检验（访问 userStore_，完成回调访问 Reactor）
+        sqlExecutor_->join();
+        sqlExecutor_.reset();
+    }
+    HttpRequest::userStore = nullptr;
+    userStore_.reset();                     // 写完等待中的注册（完成回调访问 Reactor，须在其销毁前）
     SqlConnPool::instance()->closePool();   // 关闭 sql 连接池
 }
 
@@ -70,64 +223,43 @@ WebServer::~WebServer()
 // 开启服务器程序
 void WebServer::start()
 {
-    int timeMS = -1;    // epoll_wait：timeout == -1，无事件时将阻塞
-    
-    // 打印日志
-    if (!isClose_) {
-        LOG_INFO("======== Server start ========");
+    // 初始化失败
+    if (isClose_) {
+        return;
     }
 
-    // 只要服务器正常运行
-    while (!isClose_) {
+    // 打印日志
+    LOG_INFO("======== Server start ========");
+
+    // 其余 Reactor 各自开一个线程运行事件循环
+    vector<thread> loopThreads;
+    for (size_t i = 1; i < reactors_.size(); ++i) {
+        loopThreads.emplace_back(&Reactor::loop, reactors_[i].get());
+    }
 
-        // 开启定时器
-        if (timeoutMS_ > 0) {
-            timeMS = timer_->getNextTick();
-        }
+    // 主线程运行第一个 Reactor
+    reactors_[0]->loop();
 
-        // 处理事件
-        int eventCnt = epoller_->wait(timeMS);  // timeMS：-1阻塞，0不阻塞，>0超时时间
-        for (int i = 0; i < eventCnt; ++i) {
-            int fd = epoller_->getEventFd(i);
-            uint32_t events = epoller_->getEvents(i);
-            
-            if (fd == listenFd_) {                                      // 解决监听事件
-                dealListen_();
-            }
-            else if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {     // 检测到对端关闭
-                assert(users_.count(fd) > 0);   // 先看看是否存在该fd
-                closeConn_(&users_[fd]);
-            }
-            else if (events & EPOLLIN) {                                // 有数据到来，读事件
-                assert(users_.count(fd) > 0);
-                dealRead_(&users_[fd]);
-            }
-            else if (events & EPOLLOUT) {                               // 有数据要写，写事件
-                assert(users_.count(fd) > 0);
-                dealWrite_(&users_[fd]);
-            }
-            else {                                                      // 出错，不支持的事件发生
-                LOG_ERROR("Unexpected epoll event!");
-            }
-        }
+    for (auto& t : loopThreads) {
+        t.join();
     }
 }
 
 
-// 初始化 socket
-bool WebServer::initSocket_()
+// 初始化 socket，返回监听 fd，失败返回 -1
+int WebServer::initSocket_()
 {
     // 检测端口范围是否合理
     if (port_ > 65535 || port_ < 1024) {    // 设置的监听端口 超出正常范围
         LOG_ERROR("Port:%d error! Invalid port range.", port_);
-        return false;
+        return -1;
     }
 
     // Socket
-    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);    // 获取监听文件描述符
-    if (listenFd_ < 0) {                            // socket失败
+    int listenFd = socket(AF_INET, SOCK_STREAM, 0);  // 获取监听文件描述符
+    if (listenFd < 0) {                             // socket失败
         LOG_ERROR("Create socket error!");
-        return false;
+        return -1;
     }
 
     // 设置 优雅关闭/强制关闭
@@ -136,20 +268,30 @@ bool WebServer::initSocket_()
         optLinger.l_onoff = 1;
         optLinger.l_linger = 1;     // 允许优雅关闭的时间为 1s，若 1s 内未发送完数据 就通过 RST包 强制关闭
     }
-    int ret = setsockopt(listenFd_, SOL_SOCKET, SO_LINGER, (const void*)&optLinger, sizeof(optLinger));
+    int ret = setsockopt(listenFd, SOL_SOCKET, SO_LINGER, (const void*)&optLinger, sizeof(optLinger));
     if (ret < 0) {
         LOG_ERROR("Init linger error!");
-        close(listenFd_);
-        return false;
+        close(listenFd);
+        return -1;
     }
 
     // 设置端口复用，只有最后一个套接字会正常接收数据
     int optval = 1;
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, (const void*)&optval, sizeof(int));
+    ret = setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, (const void*)&optval, sizeof(int));
     if (ret < 0) {
         LOG_ERROR("Setsockopt reuseaddr error!");
-        close(listenFd_);   // 关闭已经创建好的 监听fd
-        return false;
+        close(listenFd);    // 关闭已经创建好的 监听fd
+        return -1;
+    }
+
+    // 多 Reactor：每个 Reactor 的监听 socket 绑定同一端口，由内核将新连接分散到各个 socket
+    if (reactorNum_ > 1) {
+        ret = setsockopt(listenFd, SOL_SOCKET, SO_REUSEPORT, (const void*)&optval, sizeof(int));
+        if (ret < 0) {
+            LOG_ERROR("Setsockopt reuseport error!");
+            close(listenFd);
+            return -1;
+        }
     }
 
     // 初始化 地址结构体
@@ -159,35 +301,24 @@ bool WebServer::initSocket_()
     addr.sin_port = htons(port_);
 
     // Bind
-    ret = bind(listenFd_, (struct sockaddr*)&addr, sizeof(addr));
+    ret = bind(listenFd, (struct sockaddr*)&addr, sizeof(addr));
     if (ret < 0) {
         LOG_ERROR("Bind port:%d error!", port_);
-        close(listenFd_);
-        return false;
+        close(listenFd);
+        return -1;
     }
 
     // Listen
-    ret = listen(listenFd_, 6);     // 可同时监听6个客户端的连接请求
+    ret = listen(listenFd, 6);      // 可同时监听6个客户端的连接请求
     if (ret < 0) {
         LOG_ERROR("Listen port:%d error!", port_);
-        close(listenFd_);
-        return false;
+        close(listenFd);
+        return -1;
     }
 
-    // 将监听事件添加到 epoll
-    ret = epoller_->addFd(listenFd_, listenFd_ | EPOLLIN);
-    if (ret == 0) {
-        LOG_ERROR("Epoll add listen fd error!");
-        close(listenFd_);
-        return false;
-    }
-
-    // 设置 监听fd 为非阻塞
-    setFdNonblock_(listenFd_);
-
     LOG_INFO("Init Socket success! Server port:%d", port_);  // 打印成功日志
 
-    return true;
+    return listenFd;
 }
 
 
@@ -220,181 +351,3 @@ void WebServer::initEventMode_(int trigMode)
     // 初始化 HttpConn 的静态成员变量
     HttpConn::isET = (connEvent_ & EPOLLET);    // 传入 连接事件是否为 ET
 }
-
-
-// 添加客户端连接
-// 将新客户端的 fd、addr 添加进来
-void WebServer::addClient_(int fd, sockaddr_in addr)
-{
-    assert(fd > 0);
-
-    // 添加到 users_ 哈希表中
-    users_[fd].init(fd, addr);
-
-    // 如果有设置 超时时间，设置定时器，到期就 关闭客户端连接
-    if (timeoutMS_ > 0) {
-        // 回调函数为 bind：WebServer this->closeConn_(&users_[fd]);
-        timer_->add(fd, timeoutMS_, std::bind(&WebServer::closeConn_, this, &users_[fd]));
-    }
-
-    // 添加到 epoll
-    epoller_->addFd(fd, EPOLLIN | connEvent_);
-
-    // 设置为非阻塞
-    setFdNonblock_(fd);
-
-    //LOG_INFO("Client[%d] in!", users_[fd].getFd());   // 通过调用 getFd() 检查 HttpConn 对象是否正常创建？
-    LOG_INFO("Client[%d] in!", fd);
-}
-
-
-// 解决监听事件
-void WebServer::dealListen_()
-{
-    // 新客户端的地址
-    struct sockaddr_in addr;
-    socklen_t len = sizeof(addr);
-
-    do {
-        // Accept
-        int fd = accept(listenFd_, (struct sockaddr*)&addr, &len);      // listenFd_ 已被设置为非阻塞
-        if (fd <= 0) {  // 失败直接返回
-            return;
-        }
-        else if (HttpConn::userCount >= MAX_FD) {   // 达到最大的客户端容量
-            sendError_(fd, "Server busy!");         // 给客户端发送繁忙信息
-
-            LOG_WARN("Clients is full!");           // 打印日志
-            return;
-        }
-
-        addClient_(fd, addr);           // 正常添加客户端
-
-    } while (listenEvent_ & EPOLLET);   // 如果 监听事件 处于ET模式，一次性处理掉所有新连接请求
-}
-
-
-// 解决读事件
-void WebServer::dealRead_(HttpConn* client)
-{
-    assert(client);
-
-    // 更新连接到期时间
-    extentTime_(client);
-
-    // 线程池添加 读任务
-    threadpool_->addTask(std::bind(&WebServer::onRead_, this, client));
-}
-
-
-// 解决写事件
-void WebServer::dealWrite_(HttpConn* client)
-{
-    assert(client);
-
-    // 更新连接到期时间
-    extentTime_(client);
-
-    // 线程池添加 写任务
-    threadpool_->addTask(std::bind(&WebServer::onWrite_, this, client));
-}
-
-
-// 发送错误信息给客户端
-// 客户端 fd，错误信息 info
-void WebServer::sendError_(int fd, const char* info)
-{
-    assert(fd > 0);
-
-    int ret = send(fd, info, strlen(info), 0);
-    if (ret < 0) {
-        LOG_WARN("Send error to client[%d] error!", fd);
-    }
-
-    close(fd);      // 发送错误信息后 关闭客户端
-}
-
-
-// 更新连接到期时间
-void WebServer::extentTime_(HttpConn* client)
-{
-    assert(client);
-
-    if (timeoutMS_ > 0) {   // 只要设置了超时时间就更新
-        timer_->adjust(client->getFd(), timeoutMS_);
-    }
-}
-
-
-// 关闭与客户端的连接
-void WebServer::closeConn_(HttpConn* client)
-{
-    assert(client);
-
-    LOG_INFO("Client[%d] quit!", client->getFd());
-
-    epoller_->delFd(client->getFd());               // epoll 删除节点
-    client->Close();                                // 关闭连接
-}
-
-
-// 完成 读事件 的操作，交给线程池线程完成
-void WebServer::onRead_(HttpConn* client)
-{
-    assert(client);
-
-    int readErrno = 0;
-    int ret = client->read(&readErrno);         // 读取客户端发来的数据，保存在缓冲区中 
-    if (ret <= 0 && readErrno != EAGAIN) {      // 关闭客户端连接
-        closeConn_(client);
-        return;
-    }
-
-    // 处理客户端请求
-    onProcess_(client);
-}
-
-
-// 完成 写事件 的操作，交给线程池线程完成
-void WebServer::onWrite_(HttpConn* client)
-{
-    assert(client);
-
-    int writeErrno = 0;
-    int ret = client->write(&writeErrno);   // 客户端写入信息，并返回结果
-    if (client->toWriteBytes() == 0) {      // 传输完成
-        if (client->isKeepAlive()) {        // 客户端仍保持长连接
-            onProcess_(client);             // 缓冲区有数据 就继续处理客户端请求，否则将事件改为读事件 监听下一次请求
-            return;
-        }
-    }
-    else if (ret < 0) {
-        if (writeErrno == EAGAIN) {     // 传输中断，暂不可写
-            epoller_->modFd(client->getFd(), connEvent_ | EPOLLOUT);    // 继续传输，重新注册为 写事件
-            return;
-        }
-    }
-
-    // 遇到问题，关闭客户端连接（传输完成且客户端已断开连接，或传输失败）
-    closeConn_(client);
-}
-
-
-// 处理保存在缓冲区中的客户端请求 并将事件改为写事件；若缓冲区无内容 则继续保持读事件
-void WebServer::onProcess_(HttpConn* client)
-{
-    if (client->process()) {    // 成功解析请求，并生成响应信息
-        epoller_->modFd(client->getFd(), connEvent_ | EPOLLOUT);    // 重新注册为 写事件
-    } else {                    // 缓冲区不可读，失败
-        epoller_->modFd(client->getFd(), connEvent_ | EPOLLIN);     // 保持 读事件，监听客户端下一次请求
-    }
-}
-
-
-// 设置 fd 为非阻塞
-int WebServer::setFdNonblock_(int fd)
-{
-    assert(fd > 0);
-
-    return fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
-}
@@ -3,7 +3,8 @@
 #ifndef WEBSERVER_H
 #define WEBSERVER_H
 
-#include<unordered_map>
+#include<vector>
+#include<thread>
 #include<fcntl.h>
 #include<unistd.h>
 #include<assert.h>
@@ -12,13 +13,18 @@
 #include<netinet/in.h>
 #include<arpa/inet.h>
 
-#include"epoller.h"
+#include"epollreactor.h"
+#include"uringreactor.h"
 #include"../log/log.h"
-#include"../timer/heaptimer.h"
+#include"../log/metrics.h"
 #include"../pool/sqlconnpool.h"
 #include"../pool/sqlconnRAII.hpp"
+#include"../pool/usercache.h"
+#include"../pool/sqluserstore.h"
+#include"../pool/memuserstore.h"
 #include"../pool/threadpool.hpp"
 #include"../http/httpconn.h"
+#include"../http/filecache.h"
 
 
 class WebServer {
@@ -27,52 +33,45 @@ public:
         // 监听端口，ET模式，timeoutMs，优雅退出
         // Mysql：端口，用户名，密码，数据库名
         // 连接池大小，线程池大小，日志开关、等级、异步队列容量
+        // Reactor数量（1：单Reactor+线程池，>1：每个线程一个事件循环），IO后端（0：epoll，1：io_uring）
+        // 静态文件缓存大小（MB，0：不缓存），不小于该大小（KB，0：不使用）的资源文件用 sendfile 发送
+        // 连接池最少连接数（0：与连接池大小相同，不伸缩）
+        // 账号文件（nullptr 或空串：账号存放在 MySQL；否则账号存放在进程内，注册追加写入该文件，不连接数据库）
         int port, int trigMode, int timeoutMS, bool optLinger,
         int sqlPort, const char* sqlUser, const char* sqlPwd, const char* dbName, 
-        int connPoolNum, int threadNum, bool openLog, int logLevel, int logQueSize
+        int connPoolNum, int threadNum, bool openLog, int logLevel, int logQueSize,
+        int reactorNum = 1, int ioMode = 0, int cacheMB = 64, int sendfileKB = 256, int connPoolMin = 0,
+        const char* userFile = nullptr
     );
     ~WebServer();
 
     void start();
 
 private:
-    bool initSocket_();
+    int initSocket_();
     void initEventMode_(int trigMode);
-    
-    void addClient_(int fd, sockaddr_in addr);
-
-    void dealListen_();
-    void dealRead_(HttpConn* client);
-    void dealWrite_(HttpConn* client);
-
-    void sendError_(int fd, const char* info);
-    void extentTime_(HttpConn* client);
-    void closeConn_(HttpConn* client);
-
-    void onRead_(HttpConn* client);
-    void onWrite_(HttpConn* client);
-    void onProcess_(HttpConn* client);
-
-    static const int MAX_FD = 65536;            // 最大的文件描述符数
-
-    static int setFdNonblock_(int fd);
 
     int port_;              // 监听端口
     int timeoutMS_;         // 超时时间
     bool openLinger_;       // 是否开启 优雅退出
     bool isClose_;          // 是否关闭服务器
+    int reactorNum_;        // Reactor 数量
+    int ioMode_;            // IO 后端，0：epoll，1：io_uring
 
     char* srcDir_;          // 记录服务器资源所在路径   .../resources
-    int listenFd_;          // 记录监听的文件描述符
 
     uint32_t listenEvent_;  // 监听事件
     uint32_t connEvent_;    // 连接事件
 
-    std::unique_ptr<HeapTimer> timer_;          // 定时器
-    std::unique_ptr<ThreadPool> threadpool_;    // 线程池
-    std::unique_ptr<Epoller> epoller_;          // epoll
+    std::unique_ptr<ThreadPool> threadpool_;            // 线程池，仅 epoll 单 Reactor 模式使用
+    std::unique_ptr<UserStore> userStore_;              // 用户账号的存储后端
+    std::unique_ptr<ThreadPool> sqlExecutor_;           // 数据库线程池，注册/登录的数据库访问在这里阻塞，线程数与连接池最多连接数相同；账号存放在进程内时不创建；析构时先等待其线程退出，再销毁 userStore_ 与 Reactor
+
+    // 以 fd 为下标的连接表，所有 Reactor 共用（fd 在进程内唯一）；只创建当前 IO 后端使用的那一张
+    std::unique_ptr<ConnTable<HttpConn>> users_;
+    std::unique_ptr<ConnTable<UringReactor::Conn>> uringUsers_;
 
-    std::unordered_map<int, HttpConn> users_;   // 保存所有客户端连接，fd To HttpConn
+    std::vector<std::unique_ptr<Reactor>> reactors_;    // 事件循环，每个持有自己的监听 fd
 };
 
 
@@ -145,16 +145,15 @@ void HeapTimer::siftup_(size_t index)
     assert(0 <= index && index < heap_.size());
 
     size_t childIndex = index;                         // 当前子节点
-    size_t parentIndex = (childIndex - 1) / 2;         // 父节点
 
-    while (parentIndex >= 0) {
+    while (childIndex > 0) {                           // size_t 无符号，根节点没有父节点，不能用 parentIndex >= 0 判断
+        size_t parentIndex = (childIndex - 1) / 2;     // 父节点
         if (heap_[parentIndex] < heap_[childIndex]) {  // 父节点 比 当前子节点 小
             break;
         }
 
         swapNode_(childIndex, parentIndex);            // 将更小的子节点换上来，原父节点换下去
         childIndex = parentIndex;                      // 重复以上步骤，将 当前子节点 往上 换到合适的位置
-        parentIndex = (childIndex - 1) / 2;
     }
 }
 
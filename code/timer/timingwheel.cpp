@@ -0,0 +1,354 @@
+
+#include"timingwheel.h"
+
+
+TimingWheel::TimingWheel()
+    : start_(Clock::now()), curTick_(0), count_(0)
+{
+    nodes_.reserve(NODE_BASE + 64);
+    clear();
+}
+
+
+// 调整指定 id 的节点，设置新的到期时间
+void TimingWheel::adjust(int id, int newExpires)
+{
+    if (id < 0 || NODE_BASE + id >= static_cast<int>(nodes_.size())) {
+        return;
+    }
+
+    int index = NODE_BASE + id;
+    if (nodes_[index].slot < 0) {   // 节点已到期 或 已删除
+        return;
+    }
+
+    uint64_t expires = nowTick_() + std::max(newExpires, 0);
+    if (expires >= nodes_[index].expires) {     // 延后：只更新到期时间，槽到期时再重新挂入
+        nodes_[index].expires = expires;
+    }
+    else {                                      // 提前：马上挂到新的槽上
+        nodes_[index].expires = expires;
+        unlink_(index);
+        place_(index);
+    }
+}
+
+
+// 添加新的定时器节点，id 已存在时 更新到期时间和回调函数
+void TimingWheel::add(int id, int timeOut, const timeoutCallBack& cb)
+{
+    assert(0 <= id);
+
+    int index = index_(id);
+    if (nodes_[index].slot < 0) {   // 新节点
+        ++count_;
+    }
+    else {                          // 已有节点
+        unlink_(index);
+    }
+
+    nodes_[index].expires = nowTick_() + std::max(timeOut, 0);
+    nodes_[index].cb = cb;
+    place_(index);
+}
+
+
+// 删除指定 id 节点，并触发回调函数
+void TimingWheel::doWork(int id)
+{
+    if (id < 0 || NODE_BASE + id >= static_cast<int>(nodes_.size())) {
+        return;
+    }
+
+    int index = NODE_BASE + id;
+    if (nodes_[index].slot < 0) {
+        return;
+    }
+
+    // 先删除，回调函数中可能重新添加该 id
+    unlink_(index);
+    --count_;
+
+    timeoutCallBack cb = std::move(nodes_[index].cb);
+    nodes_[index].cb = nullptr;
+    cb();
+}
+
+
+// 删除指定 id 节点，不触发回调函数
+void TimingWheel::cancel(int id)
+{
+    if (id < 0 || NODE_BASE + id >= static_cast<int>(nodes_.size())) {
+        return;
+    }
+
+    int index = NODE_BASE + id;
+    if (nodes_[index].slot < 0) {
+        return;
+    }
+
+    unlink_(index);
+    --count_;
+    nodes_[index].cb = nullptr;
+}
+
+
+// 清空 所有定时器节点
+void TimingWheel::clear()
+{
+    nodes_.resize(NODE_BASE);
+    for (int i = 0; i < NODE_BASE; ++i) {
+        nodes_[i].prev = nodes_[i].next = i;
+        nodes_[i].slot = i;
+    }
+
+    std::fill(bitmap_, bitmap_ + sizeof(bitmap_) / sizeof(bitmap_[0]), 0);
+    count_ = 0;
+}
+
+
+// 时钟滴答，处理所有已到期的槽；中间没有节点的滴答直接跳过
+void TimingWheel::tick()
+{
+    uint64_t now = nowTick_();
+
+    while (curTick_ <= now) {
+        uint64_t next = (count_ > 0) ? nextEvent_() : UINT64_MAX;
+        if (next > now) {
+            curTick_ = now + 1;
+            break;
+        }
+        curTick_ = next;
+
+        // 第 0 层转完一圈，将上一层的槽 分散到下层，上一层也转完一圈时继续往上
+        if ((curTick_ & (ROOT_SIZE - 1)) == 0) {
+            for (int level = 1; level < LEVEL_NUM; ++level) {
+                cascade_(level);
+                if (((curTick_ >> (ROOT_BITS + (level - 1) * LEVEL_BITS)) & (LEVEL_SIZE - 1)) != 0) {
+                    break;
+                }
+            }
+        }
+
+        expire_();
+        ++curTick_;
+    }
+}
+
+
+// 返回最近一次 时钟到期所剩时间，没有定时器时返回 -1
+int TimingWheel::getNextTick()
+{
+    // 先执行一次 时钟滴答，清除已经到期的定时器
+    tick();
+
+    if (count_ == 0) {
+        return -1;
+    }
+
+    // 高层的槽 在其起始时刻就要分散到下层，返回的时间可能早于真正的到期时间
+    uint64_t next = nextEvent_();
+    uint64_t now = nowTick_();
+    if (next <= now) {
+        return 0;
+    }
+
+    return static_cast<int>(std::min<uint64_t>(next - now, INT_MAX));
+}
+
+
+// 定时器节点数
+size_t TimingWheel::size() const
+{
+    return count_;
+}
+
+
+// 当前滴答数
+uint64_t TimingWheel::nowTick_() const
+{
+    return std::chrono::duration_cast<MS>(Clock::now() - start_).count();
+}
+
+
+// 返回 id 对应的节点下标，不存在时扩容
+int TimingWheel::index_(int id)
+{
+    size_t index = static_cast<size_t>(NODE_BASE) + id;
+    if (index >= nodes_.size()) {
+        nodes_.resize(std::max(index + 1, nodes_.size() * 2));
+    }
+
+    return static_cast<int>(index);
+}
+
+
+// 将节点挂到 slot 槽的链表尾
+void TimingWheel::link_(int index, int slot)
+{
+    wheelNode& node = nodes_[index];
+    wheelNode& head = nodes_[slot];
+
+    node.prev = head.prev;
+    node.next = slot;
+    nodes_[head.prev].next = index;
+    head.prev = index;
+    node.slot = slot;
+
+    if (slot < SLOT_NUM) {
+        bitmap_[slot >> 6] |= 1ULL << (slot & 63);
+    }
+}
+
+
+// 将节点从所在链表中摘下
+void TimingWheel::unlink_(int index)
+{
+    wheelNode& node = nodes_[index];
+    int slot = node.slot;
+    assert(slot >= 0);
+
+    nodes_[node.prev].next = node.next;
+    nodes_[node.next].prev = node.prev;
+    node.prev = node.next = -1;
+    node.slot = -1;
+
+    if (slot < SLOT_NUM && nodes_[slot].next == slot) {     // 槽已空
+        bitmap_[slot >> 6] &= ~(1ULL << (slot & 63));
+    }
+}
+
+
+// 按到期时间与当前滴答的距离 选择层和槽
+void TimingWheel::place_(int index)
+{
+    uint64_t expires = std::max(nodes_[index].expires, curTick_);
+    uint64_t delta = expires - curTick_;
+
+    if (delta < ROOT_SIZE) {
+        link_(index, static_cast<int>(expires & (ROOT_SIZE - 1)));
+        return;
+    }
+
+    // 超出最高层范围的节点 放在最高层，分散时会再次放回最高层，直到进入范围
+    int level = 1;
+    while (level < LEVEL_NUM - 1 && delta >= (1ULL << (ROOT_BITS + level * LEVEL_BITS))) {
+        ++level;
+    }
+
+    int shift = ROOT_BITS + (level - 1) * LEVEL_BITS;
+    int slot = ROOT_SIZE + (level - 1) * LEVEL_SIZE + static_cast<int>((expires >> shift) & (LEVEL_SIZE - 1));
+    link_(index, slot);
+}
+
+
+// 将 slot 槽的整条链表移到 待处理链表，处理期间新挂入该槽的节点不会被重复处理
+void TimingWheel::moveToPending_(int slot)
+{
+    assert(nodes_[PENDING].next == PENDING);
+
+    while (nodes_[slot].next != slot) {
+        int index = nodes_[slot].next;
+        unlink_(index);
+        link_(index, PENDING);
+    }
+}
+
+
+// 将 level 层当前的槽 按到期时间重新分散到下层
+void TimingWheel::cascade_(int level)
+{
+    int shift = ROOT_BITS + (level - 1) * LEVEL_BITS;
+    int slot = ROOT_SIZE + (level - 1) * LEVEL_SIZE + static_cast<int>((curTick_ >> shift) & (LEVEL_SIZE - 1));
+
+    moveToPending_(slot);
+    while (nodes_[PENDING].next != PENDING) {
+        int index = nodes_[PENDING].next;
+        unlink_(index);
+        place_(index);
+    }
+}
+
+
+// 处理第 0 层当前的槽：到期的节点触发回调函数，被 adjust 延后的节点重新挂入
+void TimingWheel::expire_()
+{
+    moveToPending_(static_cast<int>(curTick_ & (ROOT_SIZE - 1)));
+
+    while (nodes_[PENDING].next != PENDING) {
+        int index = nodes_[PENDING].next;
+        unlink_(index);
+
+        if (nodes_[index].expires > curTick_) {
+            place_(index);
+            continue;
+        }
+
+        // 回调函数中可能添加新节点，nodes_ 扩容后引用失效，先取出回调函数
+        --count_;
+        timeoutCallBack cb = std::move(nodes_[index].cb);
+        nodes_[index].cb = nullptr;
+        cb();
+    }
+}
+
+
+// 返回下一个需要处理的滴答：第 0 层最近的非空槽，或 高层最近一个非空槽的起始时刻
+uint64_t TimingWheel::nextEvent_() const
+{
+    uint64_t next = UINT64_MAX;
+
+    int offset = findSlot_(0, static_cast<int>(curTick_ & (ROOT_SIZE - 1)));
+    if (offset >= 0) {
+        next = curTick_ + offset;
+    }
+
+    for (int level = 1; level < LEVEL_NUM; ++level) {
+        int shift = ROOT_BITS + (level - 1) * LEVEL_BITS;
+        uint64_t start = (curTick_ + (1ULL << shift) - 1) >> shift;     // 当前或下一个 该层槽的起点
+        offset = findSlot_(level, static_cast<int>(start & (LEVEL_SIZE - 1)));
+        if (offset >= 0) {
+            next = std::min(next, (start + offset) << shift);
+        }
+    }
+
+    return next;
+}
+
+
+// 在 level 层中 从 from 号槽开始循环查找第一个非空槽，返回与 from 的距离，没有时返回 -1
+int TimingWheel::findSlot_(int level, int from) const
+{
+    if (level == 0) {
+        // 第 0 层占 4 个字：先查 from 所在字的高位，再依次查后面的字，最后回到 from 所在字的低位
+        int word = from >> 6;
+        int bit = from & 63;
+        for (int i = 0; i <= ROOT_SIZE / 64; ++i) {
+            int w = (word + i) & (ROOT_SIZE / 64 - 1);
+            uint64_t bits = bitmap_[w];
+            if (i == 0) {
+                bits &= ~0ULL << bit;
+            }
+            else if (i == ROOT_SIZE / 64) {
+                bits &= (1ULL << bit) - 1;
+            }
+
+            if (bits) {
+                int slot = w * 64 + __builtin_ctzll(bits);
+                return (slot - from) & (ROOT_SIZE - 1);
+            }
+        }
+        return -1;
+    }
+
+    uint64_t bits = bitmap_[ROOT_SIZE / 64 + level - 1];
+    if (!bits) {
+        return -1;
+    }
+
+    // 循环右移 from 位，最低位即 from 号槽
+    if (from > 0) {
+        bits = (bits >> from) | (bits << (64 - from));
+    }
+    return __builtin_ctzll(bits);
+}
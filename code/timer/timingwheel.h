@@ -0,0 +1,81 @@
+
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include<vector>
+#include<algorithm>
+#include<functional>
+#include<chrono>
+#include<climits>
+#include<stdint.h>
+#include<assert.h>
+
+
+using timeoutCallBack = std::function<void()>;      // 形如 void () 的 function类型
+using Clock = std::chrono::high_resolution_clock;   // 时钟         Clocks      高分辨率的时钟
+using MS = std::chrono::milliseconds;               // 时间间隔      Duration   毫秒
+using timeStamp = Clock::time_point;                // 时间戳/点     Time point
+
+
+// 分层时间轮，接口与 HeapTimer 相同：add / adjust / doWork / tick / getNextTick
+// 1 个滴答为 1ms；第 0 层 256 个槽，其余 4 层各 64 个槽，共可表示 2^32ms（约 49 天）
+// 节点按 id 直接下标存放，以双向链表挂在槽上：add、adjust、cancel 都是 O(1)
+// adjust 只延后到期时间、不移动节点，节点所在的槽到期时 再按新的到期时间重新挂入（惰性刷新）
+class TimingWheel {
+public:
+    TimingWheel();
+    ~TimingWheel() = default;
+
+    void adjust(int id, int newExpires);
+    void add(int id, int timeOut, const timeoutCallBack& cb);
+    void doWork(int id);
+    void cancel(int id);
+
+    void clear();
+    void tick();
+    int getNextTick();
+
+    size_t size() const;
+
+private:
+    // 链表节点，前 SLOT_NUM 个为各槽的头节点，其后一个为 待处理链表 的头节点，再往后为 id 对应的定时器节点
+    struct wheelNode {
+        int prev = -1;
+        int next = -1;
+        int slot = -1;          // 所在的槽，-1 表示 未挂在任何槽上
+        uint64_t expires = 0;   // 到期时间，单位为滴答
+        timeoutCallBack cb;     // 到期时调用的 回调函数
+    };
+
+    static const int LEVEL_NUM = 5;                 // 层数
+    static const int ROOT_BITS = 8;                 // 第 0 层 槽数 2^8
+    static const int LEVEL_BITS = 6;                // 其余层 槽数 2^6
+    static const int ROOT_SIZE = 1 << ROOT_BITS;
+    static const int LEVEL_SIZE = 1 << LEVEL_BITS;
+    static const int SLOT_NUM = ROOT_SIZE + (LEVEL_NUM - 1) * LEVEL_SIZE;
+    static const int PENDING = SLOT_NUM;            // 待处理链表
+    static const int NODE_BASE = SLOT_NUM + 1;      // 第一个定时器节点的下标
+
+    uint64_t nowTick_() const;
+    int index_(int id);
+
+    void link_(int index, int slot);
+    void unlink_(int index);
+    void place_(int index);
+    void moveToPending_(int slot);
+
+    void cascade_(int level);
+    void expire_();
+    uint64_t nextEvent_() const;
+    int findSlot_(int level, int from) const;
+
+    timeStamp start_;                   // 时间轮创建的时刻，滴答的起点
+    uint64_t curTick_;                  // 下一个要处理的滴答
+    size_t count_;                      // 定时器节点数
+
+    std::vector<wheelNode> nodes_;      // 槽头节点 + 定时器节点，下标即 id + NODE_BASE
+    uint64_t bitmap_[(SLOT_NUM + 63) / 64];     // 非空槽位图，用于快速查找下一个到期的槽
+};
+
+
+#endif  // TIMING_WHEEL_H
@@ -0,0 +1,890 @@
+// HTTP 压力测试工具：多线程，每个线程一个 epoll 事件循环，管理若干个非阻塞连接
+// 支持 长连接、流水线深度、按权重混合的请求列表（含 POST 登录/注册）、开环固定速率模式
+// 输出 吞吐量与 p50/p90/p99/p99.9 延迟；开环模式从计划发送时间开始计时，闭环模式另外给出按期望间隔补偿的结果
+// 两种方式都用于修正 协调遗漏（coordinated omission）：服务器变慢时 本该发出却被推迟的请求 不会从统计中消失
+
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<cstdint>
+#include<cmath>
+#include<string>
+#include<vector>
+#include<deque>
+#include<memory>
+#include<thread>
+#include<atomic>
+#include<algorithm>
+#include<fstream>
+#include<sstream>
+#include<getopt.h>
+#include<time.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<netdb.h>
+#include<signal.h>
+#include<sys/epoll.h>
+#include<sys/timerfd.h>
+#include<sys/socket.h>
+#include<netinet/in.h>
+#include<netinet/tcp.h>
+#include<arpa/inet.h>
+
+using namespace std;
+
+
+// 单调时钟，纳秒
+static int64_t nowNS()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+
+// 延迟直方图：对数-线性分桶（HDR 风格），每个 2 的幂区间等分为 SUB_BUCKETS 个桶，相对误差约 3%
+class histogram {
+public:
+    static const int SUB_BITS = 5;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int MIN_EXP = 10;      // < 2^10 ns（约 1us）的值 都计入第一个桶
+    static const int MAX_EXP = 37;      // >= 2^37 ns（约 137s）的值 都计入最后一个桶
+    static const int BUCKETS = 1 + (MAX_EXP - MIN_EXP) * SUB_BUCKETS + 1;
+
+    histogram() : buckets_(BUCKETS, 0), count_(0), sum_(0), max_(0) {}
+
+    void record(int64_t ns, uint64_t count = 1) {
+        if (ns < 0) {
+            ns = 0;
+        }
+        buckets_[bucket_(ns)] += count;
+        count_ += count;
+        sum_ += static_cast<double>(ns) * count;
+        max_ = max(max_, ns);
+    }
+
+    void merge(const histogram& other) {
+        for (int i = 0; i < BUCKETS; ++i) {
+            buckets_[i] += other.buckets_[i];
+        }
+        count_ += other.count_;
+        sum_ += other.sum_;
+        max_ = max(max_, other.max_);
+    }
+
+    // 按期望间隔补偿协调遗漏（同 HdrHistogram 的 copyCorrectedForCoordinatedOmission）：
+    // 耗时 v 大于期望间隔 expected 的请求，补上这段时间内本应发出的请求 v-expected、v-2*expected ... 的记录
+    histogram corrected(int64_t expected) const {
+        histogram h;
+        for (int i = 0; i < BUCKETS; ++i) {
+            if (buckets_[i] == 0) {
+                continue;
+            }
+            int64_t v = value_(i);
+            h.record(v, buckets_[i]);
+            if (expected <= 0) {
+                continue;
+            }
+            for (int64_t missing = v - expected; missing >= expected; missing -= expected) {
+                h.record(missing, buckets_[i]);
+            }
+        }
+        h.max_ = max_;
+        return h;
+    }
+
+    // 第 p 百分位的值（纳秒）
+    int64_t percentile(double p) const {
+        if (count_ == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(ceil(p / 100.0 * count_));
+        rank = max<uint64_t>(rank, 1);
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; ++i) {
+            seen += buckets_[i];
+            if (seen >= rank) {
+                return min(value_(i), max_);
+            }
+        }
+        return max_;
+    }
+
+    uint64_t count() const { return count_; }
+    double mean() const { return count_ ? sum_ / count_ : 0; }
+    int64_t maxValue() const { return max_; }
+
+private:
+    static int bucket_(int64_t ns) {
+        if (ns < (int64_t(1) << MIN_EXP)) {
+            return 0;
+        }
+        int e = 63 - __builtin_clzll(static_cast<uint64_t>(ns));
+        if (e >= MAX_EXP) {
+            return BUCKETS - 1;
+        }
+        int sub = (ns >> (e - SUB_BITS)) & (SUB_BUCKETS - 1);
+        return 1 + (e - MIN_EXP) * SUB_BUCKETS + sub;
+    }
+
+    // 桶的代表值：区间中点
+    static int64_t value_(int idx) {
+        if (idx == 0) {
+            return int64_t(1) << (MIN_EXP - 1);
+        }
+        if (idx == BUCKETS - 1) {
+            return int64_t(1) << MAX_EXP;
+        }
+        int e = MIN_EXP + (idx - 1) / SUB_BUCKETS;
+        int sub = (idx - 1) % SUB_BUCKETS;
+        int64_t width = int64_t(1) << (e - SUB_BITS);
+        return (int64_t(1) << e) + sub * width + width / 2;
+    }
+
+    vector<uint64_t> buckets_;
+    uint64_t count_;
+    double sum_;
+    int64_t max_;
+};
+
+
+// 一种请求及其权重；body 中的 {seq} 替换为本次运行中唯一的序号（注册时用户名不重复）
+struct target {
+    int weight;
+    string method;
+    string path;
+    string body;
+    string request;     // 不含 {seq} 时 预先生成的完整请求报文
+};
+
+
+// 命令行参数
+struct options {
+    string host = "127.0.0.1";
+    int port = 80;
+    int conns = 100;            // 总连接数
+    int threads = 1;            // 线程数
+    double seconds = 10;        // 测试时长
+    int pipeline = 1;           // 每个连接的流水线深度（同时未完成的请求数）
+    double rate = 0;            // 开环模式的总请求速率（请求/秒），0 为闭环模式
+    bool keepAlive = true;      // 是否使用长连接
+    vector<target> targets;
+};
+
+
+// 统计结果，每个线程一份 最后汇总
+struct stats {
+    histogram latency;          // 开环：从计划发送时间开始；闭环：从实际发送时间开始
+    histogram service;          // 从实际发送时间开始（开环模式用于对比）
+    uint64_t responses = 0;
+    uint64_t bytes = 0;
+    uint64_t codes[6] = { 0 };  // 1xx ~ 5xx，[0] 为无法解析的状态码
+    uint64_t connectErrors = 0;
+    uint64_t readErrors = 0;
+    uint64_t reconnects = 0;
+    uint64_t backlogMax = 0;    // 开环模式下 等待空闲连接的请求数最大值
+};
+
+
+// 一个请求：计时起点与报文
+struct pending {
+    int64_t intended;           // 计划发送时间（开环）或 0（闭环：以实际发送时间为起点）
+    int64_t sent;               // 实际发送时间（写入发送缓冲的时间）
+};
+
+
+// 一个连接
+struct conn {
+    int fd = -1;
+    bool connected = false;
+    bool wantOut = false;       // 是否注册了 EPOLLOUT
+
+    string out;                 // 待发送的数据
+    size_t outPos = 0;
+    deque<pending> inflight;    // 已发送、未收到响应的请求，按顺序
+
+    // 响应解析
+    string header;              // 当前响应的头部（收到空行之前）
+    bool inBody = false;
+    size_t bodyLeft = 0;
+    int code = 0;
+    bool closeAfter = false;    // 服务器将在此响应后关闭连接
+};
+
+
+// 工作线程：一个 epoll 事件循环 + 若干连接
+class worker {
+public:
+    worker(const options& opt, const sockaddr_in& addr, int id, int conns, int64_t start, int64_t end)
+        : opt_(opt), addr_(addr), id_(id), conns_(conns), start_(start), end_(end),
+        epfd_(-1), timerfd_(-1), rng_(0x9E3779B97F4A7C15ULL * (id + 1)), seq_(0), nextSend_(start), interval_(0) {
+
+        totalWeight_ = 0;
+        for (const target& t : opt_.targets) {
+            totalWeight_ += t.weight;
+        }
+        if (opt_.rate > 0) {
+            interval_ = static_cast<int64_t>(1e9 * opt_.threads / opt_.rate);
+            nextSend_ = start_ + interval_ * id_ / opt_.threads;     // 各线程错开
+        }
+    }
+
+    void run();
+    const stats& result() const { return stats_; }
+
+private:
+    void connect_(conn& c);
+    void close_(conn& c, bool reconnect);
+    void fill_(conn& c, int64_t now);
+    void enqueue_(conn& c, int64_t intended, int64_t now);
+    void schedule_(int64_t now);
+    bool flush_(conn& c);
+    bool onReadable_(conn& c);
+    bool onResponse_(conn& c, int64_t now);
+    void updateEvents_(conn& c);
+    const target& pick_();
+    uint64_t random_();
+
+    static const uint32_t TIMER_ID = UINT32_MAX;    // 定时器在 epoll 事件中的标识，连接用下标
+
+    const options& opt_;
+    sockaddr_in addr_;
+    int id_;
+    int conns_;
+    int64_t start_;
+    int64_t end_;
+
+    int epfd_;
+    int timerfd_;               // 开环模式：在下一个计划发送时间唤醒（epoll_wait 的超时只有毫秒精度）
+    vector<conn> conn_;
+    stats stats_;
+
+    uint64_t rng_;
+    uint64_t seq_;
+    int totalWeight_;
+
+    int64_t nextSend_;          // 开环：下一个请求的计划发送时间
+    int64_t interval_;          // 开环：本线程两次发送的间隔
+    deque<int64_t> backlog_;    // 开环：已到计划时间、但没有空闲连接的请求
+};
+
+
+// 建立非阻塞连接，连接完成时（EPOLLOUT）开始发送
+void worker::connect_(conn& c)
+{
+    c = conn();
+    c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (c.fd < 0) {
+        ++stats_.connectErrors;
+        return;
+    }
+
+    int one = 1;
+    setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    int ret = ::connect(c.fd, (struct sockaddr*)&addr_, sizeof(addr_));
+    if (ret < 0 && errno != EINPROGRESS) {
+        ++stats_.connectErrors;
+        ::close(c.fd);
+        c.fd = -1;
+        return;
+    }
+
+    struct epoll_event ev = { 0 };
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.u32 = static_cast<uint32_t>(&c - conn_.data());
+    epoll_ctl(epfd_, EPOLL_CTL_ADD, c.fd, &ev);
+    c.wantOut = true;
+}
+
+
+// 关闭连接；reconnect 时重新连接，未收到响应的请求 保留计时起点重新发送
+void worker::close_(conn& c, bool reconnect)
+{
+    deque<pending> lost;
+    lost.swap(c.inflight);
+
+    if (c.fd >= 0) {
+        epoll_ctl(epfd_, EPOLL_CTL_DEL, c.fd, nullptr);
+        ::close(c.fd);
+        c.fd = -1;
+    }
+    if (!reconnect) {
+        return;
+    }
+
+    ++stats_.reconnects;
+    connect_(c);
+    if (c.fd < 0) {
+        return;
+    }
+
+    int64_t now = nowNS();
+    for (const pending& p : lost) {
+        enqueue_(c, p.intended, now);
+    }
+}
+
+
+// 闭环模式：把连接的流水线填满
+void worker::fill_(conn& c, int64_t now)
+{
+    while (static_cast<int>(c.inflight.size()) < opt_.pipeline) {
+        enqueue_(c, 0, now);
+    }
+}
+
+
+// 生成一个请求 放入连接的发送缓冲
+void worker::enqueue_(conn& c, int64_t intended, int64_t now)
+{
+    const target& t = pick_();
+    if (!t.request.empty()) {
+        c.out += t.request;
+    }
+    else {      // 正文含 {seq}，替换为唯一序号
+        string body = t.body;
+        string seq = to_string(time(nullptr) % 100000) + "_" + to_string(id_) + "_" + to_string(seq_++);
+        for (size_t pos = body.find("{seq}"); pos != string::npos; pos = body.find("{seq}", pos + seq.size())) {
+            body.replace(pos, 5, seq);
+        }
+
+        char head[512];
+        snprintf(head, sizeof(head), "%s %s HTTP/1.1\r\nHost: %s:%d\r\nConnection: %s\r\n"
+                "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: %zu\r\n\r\n",
+                t.method.c_str(), t.path.c_str(), opt_.host.c_str(), opt_.port,
+                opt_.keepAlive ? "keep-alive" : "close", body.size());
+        c.out += head;
+        c.out += body;
+    }
+    c.inflight.push_back({ intended, now });
+}
+
+
+// 开环模式：把已到计划发送时间的请求 分配给有空闲流水线位置的连接，没有空闲连接时 进入等待队列
+void worker::schedule_(int64_t now)
+{
+    while (nextSend_ <= now && nextSend_ < end_) {
+        backlog_.push_back(nextSend_);
+        nextSend_ += interval_;
+    }
+    stats_.backlogMax = max<uint64_t>(stats_.backlogMax, backlog_.size());
+
+    for (conn& c : conn_) {
+        if (backlog_.empty()) {
+            break;
+        }
+        if (c.fd < 0 || !c.connected) {
+            continue;
+        }
+        bool added = false;
+        while (!backlog_.empty() && static_cast<int>(c.inflight.size()) < opt_.pipeline) {
+            enqueue_(c, backlog_.front(), now);
+            backlog_.pop_front();
+            added = true;
+        }
+        if (added && !flush_(c)) {
+            close_(c, true);
+        }
+    }
+}
+
+
+// 尽量发送缓冲中的数据，出错时返回 false
+bool worker::flush_(conn& c)
+{
+    while (c.outPos < c.out.size()) {
+        ssize_t n = send(c.fd, c.out.data() + c.outPos, c.out.size() - c.outPos, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN) {
+                break;
+            }
+            return false;
+        }
+        c.outPos += n;
+    }
+
+    if (c.outPos == c.out.size()) {
+        c.out.clear();
+        c.outPos = 0;
+    }
+    updateEvents_(c);
+    return true;
+}
+
+
+// 有待发送数据时 才监听 EPOLLOUT
+void worker::updateEvents_(conn& c)
+{
+    bool wantOut = !c.out.empty();
+    if (wantOut == c.wantOut) {
+        return;
+    }
+
+    struct epoll_event ev = { 0 };
+    ev.events = EPOLLIN | (wantOut ? EPOLLOUT : 0);
+    ev.data.u32 = static_cast<uint32_t>(&c - conn_.data());
+    epoll_ctl(epfd_, EPOLL_CTL_MOD, c.fd, &ev);
+    c.wantOut = wantOut;
+}
+
+
+// 读取并解析响应，连接需要关闭时返回 false
+bool worker::onReadable_(conn& c)
+{
+    char buf[65536];
+
+    while (true) {
+        ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+        if (n == 0) {
+            return false;
+        }
+        if (n < 0) {
+            if (errno == EAGAIN) {
+                return true;
+            }
+            ++stats_.readErrors;
+            return false;
+        }
+
+        int64_t now = nowNS();
+        stats_.bytes += n;
+
+        const char* p = buf;
+        const char* end = buf + n;
+        while (p < end) {
+            if (c.inBody) {                 // 跳过正文，不保存
+                size_t skip = min(c.bodyLeft, static_cast<size_t>(end - p));
+                c.bodyLeft -= skip;
+                p += skip;
+                if (c.bodyLeft == 0) {
+                    c.inBody = false;
+                    if (!onResponse_(c, now)) {
+                        return false;
+                    }
+                }
+                continue;
+            }
+
+            // 头部：累积到空行为止
+            const char* lf = static_cast<const char*>(memchr(p, '\n', end - p));
+            const char* lineEnd = lf ? lf + 1 : end;
+            c.header.append(p, lineEnd - p);
+            p = lineEnd;
+
+            size_t hl = c.header.size();
+            if (!lf || hl < 4 || c.header.compare(hl - 4, 4, "\r\n\r\n") != 0) {
+                continue;
+            }
+
+            // 状态码、正文长度、是否关闭连接
+            c.code = 0;
+            sscanf(c.header.c_str(), "HTTP/%*s %d", &c.code);
+            c.bodyLeft = 0;
+            c.closeAfter = false;
+
+            istringstream lines(c.header);
+            string line;
+            while (getline(lines, line)) {
+                if (strncasecmp(line.c_str(), "Content-length:", 15) == 0) {
+                    c.bodyLeft = strtoul(line.c_str() + 15, nullptr, 10);
+                }
+                else if (strncasecmp(line.c_str(), "Connection:", 11) == 0 && strcasestr(line.c_str() + 11, "close")) {
+                    c.closeAfter = true;
+                }
+            }
+            c.header.clear();
+
+            if (c.bodyLeft > 0) {
+                c.inBody = true;
+            }
+            else if (!onResponse_(c, now)) {
+                return false;
+            }
+        }
+    }
+}
+
+
+// 收到一个完整的响应：记录延迟，闭环模式下 补发一个请求；服务器将关闭连接时 返回 false
+bool worker::onResponse_(conn& c, int64_t now)
+{
+    if (c.inflight.empty()) {       // 多出来的响应，不应出现
+        ++stats_.readErrors;
+        return false;
+    }
+
+    pending p = c.inflight.front();
+    c.inflight.pop_front();
+
+    if (now <= end_) {
+        stats_.latency.record(now - (p.intended ? p.intended : p.sent));
+        stats_.service.record(now - p.sent);
+        ++stats_.responses;
+        ++stats_.codes[(c.code >= 100 && c.code < 600) ? c.code / 100 : 0];
+    }
+
+    if (c.closeAfter || !opt_.keepAlive) {
+        return false;
+    }
+
+    if (opt_.rate <= 0 && now < end_) {
+        fill_(c, now);
+        if (!flush_(c)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// 加权随机选择一种请求
+const target& worker::pick_()
+{
+    if (opt_.targets.size() == 1) {
+        return opt_.targets[0];
+    }
+
+    int r = static_cast<int>(random_() % totalWeight_);
+    for (const target& t : opt_.targets) {
+        if (r < t.weight) {
+            return t;
+        }
+        r -= t.weight;
+    }
+    return opt_.targets.back();
+}
+
+
+// xorshift64
+uint64_t worker::random_()
+{
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 7;
+    rng_ ^= rng_ << 17;
+    return rng_;
+}
+
+
+// 事件循环，直到测试结束
+void worker::run()
+{
+    epfd_ = epoll_create1(0);
+    conn_.resize(conns_);
+    for (conn& c : conn_) {
+        connect_(c);
+    }
+
+    if (opt_.rate > 0) {
+        timerfd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+        struct epoll_event ev = { 0 };
+        ev.events = EPOLLIN;
+        ev.data.u32 = TIMER_ID;
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, timerfd_, &ev);
+    }
+
+    struct epoll_event events[256];
+    int64_t armedAt = 0;
+
+    while (true) {
+        int64_t now = nowNS();
+        if (now >= end_) {
+            break;
+        }
+
+        // 开环模式 定时器设为下一个计划发送时间；已到期的请求在等待空闲连接，由响应事件驱动
+        if (timerfd_ >= 0 && nextSend_ != armedAt && nextSend_ < end_) {
+            struct itimerspec its = { { 0, 0 }, { 0, 0 } };
+            its.it_value.tv_sec = nextSend_ / 1000000000;
+            its.it_value.tv_nsec = nextSend_ % 1000000000;
+            timerfd_settime(timerfd_, TFD_TIMER_ABSTIME, &its, nullptr);
+            armedAt = nextSend_;
+        }
+        int timeoutMS = static_cast<int>((end_ - now + 999999) / 1000000);
+
+        int n = epoll_wait(epfd_, events, 256, timeoutMS);
+        now = nowNS();
+
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.u32 == TIMER_ID) {
+                uint64_t expirations;
+                read(timerfd_, &expirations, sizeof(expirations));
+                continue;
+            }
+
+            conn& c = conn_[events[i].data.u32];
+            if (c.fd < 0) {
+                continue;
+            }
+
+            if (!c.connected && (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err != 0) {
+                    ++stats_.connectErrors;
+                    close_(c, false);
+                    connect_(c);        // 服务器暂时无法连接，重试
+                    continue;
+                }
+                c.connected = true;
+                if (opt_.rate <= 0) {
+                    fill_(c, now);
+                }
+            }
+
+            if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                if (!onReadable_(c)) {
+                    close_(c, now < end_);
+                    continue;
+                }
+            }
+
+            if (!c.out.empty() && !flush_(c)) {
+                close_(c, now < end_);
+            }
+        }
+
+        if (opt_.rate > 0) {
+            schedule_(nowNS());
+        }
+    }
+
+    for (conn& c : conn_) {
+        close_(c, false);
+    }
+    if (timerfd_ >= 0) {
+        ::close(timerfd_);
+    }
+    ::close(epfd_);
+}
+
+
+// 解析 http://host:port/path，返回路径
+static bool parseUrl(const string& url, options& opt, string& path)
+{
+    const string prefix = "http://";
+    if (url.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+
+    string rest = url.substr(prefix.size());
+    size_t slash = rest.find('/');
+    string hostPort = rest.substr(0, slash);
+    path = (slash == string::npos) ? "/" : rest.substr(slash);
+
+    size_t colon = hostPort.find(':');
+    opt.host = hostPort.substr(0, colon);
+    opt.port = (colon == string::npos) ? 80 : atoi(hostPort.c_str() + colon + 1);
+    return !opt.host.empty() && opt.port > 0;
+}
+
+
+// 读取请求列表文件，每行：权重 方法 路径 [正文]，# 开头为注释
+static bool loadTargets(const char* file, options& opt)
+{
+    ifstream in(file);
+    if (!in) {
+        return false;
+    }
+
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        istringstream fields(line);
+        target t;
+        if (!(fields >> t.weight >> t.method >> t.path) || t.weight <= 0) {
+            fprintf(stderr, "bad line in %s: %s\n", file, line.c_str());
+            return false;
+        }
+        fields >> t.body;
+        opt.targets.push_back(t);
+    }
+    return !opt.targets.empty();
+}
+
+
+// 预先生成不含 {seq} 的请求报文
+static void buildRequests(options& opt)
+{
+    for (target& t : opt.targets) {
+        if (t.body.find("{seq}") != string::npos) {
+            continue;
+        }
+        t.request = t.method + " " + t.path + " HTTP/1.1\r\nHost: " + opt.host + ":" + to_string(opt.port)
+                    + "\r\nConnection: " + (opt.keepAlive ? "keep-alive" : "close") + "\r\n";
+        if (t.method == "POST") {
+            t.request += "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: "
+                        + to_string(t.body.size()) + "\r\n";
+        }
+        t.request += "\r\n" + t.body;
+    }
+}
+
+
+static void usage(const char* prog)
+{
+    fprintf(stderr,
+        "usage: %s [options] http://host:port/path ...\n"
+        "  -c, --connections N   total connections (default 100)\n"
+        "  -t, --threads N       worker threads (default 1)\n"
+        "  -d, --duration S      test duration in seconds (default 10)\n"
+        "  -p, --pipeline N      requests in flight per connection (default 1)\n"
+        "  -r, --rate R          open-loop mode: total requests per second (default 0, closed loop)\n"
+        "  -f, --file FILE       weighted request list: \"weight METHOD path [body]\" per line,\n"
+        "                        {seq} in the body becomes a unique number (e.g. register names)\n"
+        "      --close           one request per connection (Connection: close)\n",
+        prog);
+}
+
+
+static void printLatency(const char* name, const histogram& h)
+{
+    printf("  %-22s %9.1f %9.1f %9.1f %9.1f %9.1f %10.1f\n", name,
+           h.percentile(50) / 1e3, h.percentile(90) / 1e3, h.percentile(99) / 1e3,
+           h.percentile(99.9) / 1e3, h.mean() / 1e3, h.maxValue() / 1e3);
+}
+
+
+int main(int argc, char* argv[])
+{
+    options opt;
+    const char* file = nullptr;
+
+    static struct option longOpts[] = {
+        { "connections", required_argument, nullptr, 'c' },
+        { "threads", required_argument, nullptr, 't' },
+        { "duration", required_argument, nullptr, 'd' },
+        { "pipeline", required_argument, nullptr, 'p' },
+        { "rate", required_argument, nullptr, 'r' },
+        { "file", required_argument, nullptr, 'f' },
+        { "close", no_argument, nullptr, 'C' },
+        { "help", no_argument, nullptr, 'h' },
+        { nullptr, 0, nullptr, 0 }
+    };
+
+    int ch;
+    while ((ch = getopt_long(argc, argv, "c:t:d:p:r:f:h", longOpts, nullptr)) != -1) {
+        switch (ch) {
+        case 'c': opt.conns = atoi(optarg); break;
+        case 't': opt.threads = atoi(optarg); break;
+        case 'd': opt.seconds = atof(optarg); break;
+        case 'p': opt.pipeline = atoi(optarg); break;
+        case 'r': opt.rate = atof(optarg); break;
+        case 'f': file = optarg; break;
+        case 'C': opt.keepAlive = false; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+
+    // 命令行中的 URL：权重为 1 的 GET 请求，同时确定目标地址
+    for (int i = optind; i < argc; ++i) {
+        target t;
+        t.weight = 1;
+        t.method = "GET";
+        if (!parseUrl(argv[i], opt, t.path)) {
+            fprintf(stderr, "bad url: %s\n", argv[i]);
+            return 1;
+        }
+        opt.targets.push_back(t);
+    }
+    if (optind == argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (file) {     // 有请求列表时 命令行中的 URL 只用于确定目标地址
+        opt.targets.clear();
+        if (!loadTargets(file, opt)) {
+            fprintf(stderr, "cannot load request list: %s\n", file);
+            return 1;
+        }
+    }
+
+    if (!opt.keepAlive) {
+        opt.pipeline = 1;
+    }
+    opt.threads = max(1, min(opt.threads, opt.conns));
+    opt.pipeline = max(1, opt.pipeline);
+    buildRequests(opt);
+
+    // 解析目标地址
+    struct addrinfo hints = { 0 };
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* res = nullptr;
+    if (getaddrinfo(opt.host.c_str(), nullptr, &hints, &res) != 0 || !res) {
+        fprintf(stderr, "cannot resolve %s\n", opt.host.c_str());
+        return 1;
+    }
+    sockaddr_in addr = *reinterpret_cast<sockaddr_in*>(res->ai_addr);
+    addr.sin_port = htons(opt.port);
+    freeaddrinfo(res);
+
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("%s:%d, %d connections, %d threads, %.0fs, pipeline %d, %s, %zu request types\n",
+           opt.host.c_str(), opt.port, opt.conns, opt.threads, opt.seconds, opt.pipeline,
+           opt.rate > 0 ? ("open loop " + to_string(static_cast<long>(opt.rate)) + " req/s").c_str() : "closed loop",
+           opt.targets.size());
+
+    // 各线程平分连接
+    int64_t start = nowNS();
+    int64_t end = start + static_cast<int64_t>(opt.seconds * 1e9);
+    vector<unique_ptr<worker>> workers;
+    for (int i = 0; i < opt.threads; ++i) {
+        int conns = opt.conns / opt.threads + (i < opt.conns % opt.threads ? 1 : 0);
+        workers.emplace_back(new worker(opt, addr, i, conns, start, end));
+    }
+
+    vector<thread> ts;
+    for (unique_ptr<worker>& w : workers) {
+        ts.emplace_back(&worker::run, w.get());
+    }
+    for (thread& t : ts) {
+        t.join();
+    }
+
+    // 汇总
+    stats total;
+    for (unique_ptr<worker>& w : workers) {
+        const stats& s = w->result();
+        total.latency.merge(s.latency);
+        total.service.merge(s.service);
+        total.responses += s.responses;
+        total.bytes += s.bytes;
+        for (int i = 0; i < 6; ++i) {
+            total.codes[i] += s.codes[i];
+        }
+        total.connectErrors += s.connectErrors;
+        total.readErrors += s.readErrors;
+        total.reconnects += s.reconnects;
+        total.backlogMax += s.backlogMax;
+    }
+
+    double secs = opt.seconds;
+    printf("\n  requests: %lu, %.1f req/s, %.2f MB/s\n", total.responses, total.responses / secs,
+           total.bytes / secs / (1 << 20));
+    printf("  status: 2xx %lu, 3xx %lu, 4xx %lu, 5xx %lu, other %lu\n",
+           total.codes[2], total.codes[3], total.codes[4], total.codes[5], total.codes[0] + total.codes[1]);
+    printf("  errors: connect %lu, read %lu, reconnects %lu\n",
+           total.connectErrors, total.readErrors, total.reconnects);
+
+    printf("\n  latency (us)             %9s %9s %9s %9s %9s %10s\n", "p50", "p90", "p99", "p99.9", "mean", "max");
+    if (opt.rate > 0) {
+        printLatency("from intended send", total.latency);
+        printLatency("from actual send", total.service);
+        printf("\n  max requests waiting for a free connection: %lu\n", total.backlogMax);
+    }
+    else {
+        // 闭环模式：以中位数作为一个连接上 两次请求的期望间隔，补偿服务器停顿期间 本该发出的请求
+        int64_t expected = total.latency.percentile(50);
+        printLatency("measured", total.latency);
+        printLatency("corrected", total.latency.corrected(expected));
+        printf("\n  corrected: HdrHistogram-style, expected interval = p50 (%.1f us)\n", expected / 1e3);
+    }
+
+    return 0;
+}
@@ -0,0 +1,355 @@
+// 1. 多 Reactor 的连接关闭与 fd 复用：各 Reactor 共用以 fd 为下标的连接表，但各有自己的定时器
+//    一批短连接关闭后，马上建立一批长连接（内核复用刚关闭的 fd，新连接多数落在其他 Reactor 上），
+//    长连接在超时时间内持续发送请求，超过 2 倍超时时间后 应全部仍可用；旧连接的定时器不应关闭它们
+//    epoll、io_uring 各测一次，服务器在子进程中运行；epoll 另测一次 单 Reactor + 线程池（关闭连接交回事件循环完成）
+// 2. 用户身份缓存：注册提交后 才写入的过时查询结果（用户不存在）不覆盖新注册的用户
+// 3. 线程池 join：返回时 已提交的任务全部执行完毕（之后才能销毁任务访问的对象）
+// 4. 任务分发不分配内存：替换全局 operator new 计数，线程池预热后 Reactor 使用的几种任务形式 提交、执行都不应分配
+// 全部通过时返回 0
+
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<string>
+#include<vector>
+#include<chrono>
+#include<thread>
+#include<atomic>
+#include<memory>
+#include<functional>
+#include<new>
+#include<unistd.h>
+#include<signal.h>
+#include<sys/wait.h>
+#include<sys/socket.h>
+#include<netinet/in.h>
+#include<arpa/inet.h>
+
+#include"../code/server/webserver.h"
+
+
+// 全局分配计数，只在 testTaskNoAlloc 中检查
+
+static std::atomic<long> allocCount(0);
+
+void* operator new(size_t size)
+{
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+// operator new 与 delete 都被替换为 malloc/free，内联后 GCC 误报两者不匹配
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+#pragma GCC diagnostic pop
+
+
+static const int PORT = 23456;
+static const int REACTOR_NUM = 4;
+static const int TIMEOUT_MS = 600;      // 服务器的连接超时时间
+static const int CONN_NUM = 64;         // 每批连接数
+static const int ROUNDS = 10;           // 长连接的请求轮数，每轮间隔 TIMEOUT_MS / 4，共 2.5 倍超时时间
+
+
+// 在子进程中运行服务器，账号存放在进程内，不连接数据库
+static pid_t startServer(int ioMode, int reactorNum)
+{
+    pid_t pid = fork();
+    if (pid != 0) {
+        return pid;
+    }
+
+    if (chdir("..") < 0) {      // 资源文件在 项目根目录/resources
+        _exit(2);
+    }
+
+    char userFile[] = "/tmp/webserver_test_users_XXXXXX";
+    int fd = mkstemp(userFile);
+    if (fd < 0) {
+        _exit(2);
+    }
+    close(fd);
+
+    WebServer server(
+        PORT, 3, TIMEOUT_MS, false,
+        3306, "root", "", "yourdb",
+        4, 4, false, 1, 1024,
+        reactorNum, ioMode, 8, 0, 0,
+        userFile
+    );
+    unlink(userFile);
+    server.start();
+    _exit(1);
+}
+
+
+// 连接服务器，失败返回 -1
+static int connectServer()
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct timeval tv = { 2, 0 };   // 连接被关闭时 recv 返回 0；服务器无响应时 不一直阻塞
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+
+// 发送一个长连接请求 并读完响应，连接已被关闭 或出错时返回 false
+static bool request(int fd)
+{
+    const char req[] = "GET /index.html HTTP/1.1\r\nHost: test\r\nConnection: keep-alive\r\n\r\n";
+    if (send(fd, req, sizeof(req) - 1, MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(req) - 1)) {
+        return false;
+    }
+
+    std::string resp;
+    char buf[65536];
+    size_t total = std::string::npos;       // 响应的总长度，读完响应头后确定
+    while (resp.size() != total) {
+        ssize_t len = recv(fd, buf, sizeof(buf), 0);
+        if (len <= 0) {
+            return false;
+        }
+        resp.append(buf, len);
+
+        size_t headEnd = resp.find("\r\n\r\n");
+        size_t lenPos = resp.find("Content-length: ");
+        if (total == std::string::npos && headEnd != std::string::npos && lenPos < headEnd) {
+            total = headEnd + 4 + strtoul(resp.c_str() + lenPos + 16, nullptr, 10);
+        }
+    }
+    return resp.compare(0, 12, "HTTP/1.1 200") == 0;
+}
+
+
+// 一种 IO 后端的测试，通过时返回 true
+// 每个连接建立后马上完成一个请求：监听队列很短（listen 6），同时发起大量连接时 多出的 SYN 被丢弃，
+// 重传前 已建立的空闲连接可能先超时
+static bool testFdReuse(int ioMode, int reactorNum)
+{
+    const char* name = ioMode == 1 ? "io_uring" : (reactorNum == 1 ? "epoll+threadpool" : "epoll");
+
+    pid_t server = startServer(ioMode, reactorNum);
+    if (server < 0) {
+        printf("[%s] fork error\n", name);
+        return false;
+    }
+
+    // 等待服务器开始监听
+    int probe = -1;
+    for (int i = 0; i < 100 && probe < 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        probe = connectServer();
+    }
+    bool ok = probe >= 0 && request(probe);
+    if (probe >= 0) {
+        close(probe);
+    }
+
+    // 一批短连接：各完成一个请求后关闭，服务器端关闭连接后 各 Reactor 留下这些 fd 的定时器（修复前）
+    for (int round = 0; ok && round < 3; ++round) {
+        std::vector<int> conns;
+        for (int i = 0; i < CONN_NUM; ++i) {
+            int fd = connectServer();
+            if (fd < 0 || !request(fd)) {
+                ok = false;
+            }
+            if (fd >= 0) {
+                conns.push_back(fd);
+            }
+        }
+        for (int fd : conns) {
+            close(fd);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));     // 等服务器关闭这些连接
+    }
+
+    // 一批长连接：复用刚关闭的 fd，持续发送请求 直到超过旧定时器的到期时间
+    std::vector<int> conns;
+    for (int i = 0; ok && i < CONN_NUM; ++i) {
+        int fd = connectServer();
+        if (fd < 0 || !request(fd)) {
+            ok = false;
+        }
+        if (fd >= 0) {
+            conns.push_back(fd);
+        }
+    }
+
+    int closed = 0;
+    for (int round = 0; ok && round < ROUNDS; ++round) {
+        for (int& fd : conns) {
+            if (fd >= 0 && !request(fd)) {
+                ++closed;
+                close(fd);
+                fd = -1;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(TIMEOUT_MS / 4));
+    }
+    for (int fd : conns) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    kill(server, SIGKILL);
+    waitpid(server, nullptr, 0);
+
+    if (closed > 0) {
+        printf("[%s] %d of %d active connections closed by the server\n", name, closed, CONN_NUM);
+        ok = false;
+    }
+    printf("[%s] fd reuse after close: %s\n", name, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+
+// 查询在注册提交之前完成、在 putUser 之后才 putAbsent：登录仍应成功
+static bool testUserCacheOrder()
+{
+    UserCache* cache = UserCache::instance();
+    cache->putUser("test_user", "pwd");
+    cache->putAbsent("test_user");
+    bool ok = cache->check("test_user", "pwd", true) == UserCache::OK;
+
+    cache->putTaken("test_taken");
+    cache->putAbsent("test_taken");
+    ok = ok && cache->check("test_taken", "", false) == UserCache::FAIL;    // 注册：用户名已被使用
+
+    printf("[usercache] stale absent result ignored: %s\n", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+
+// 提交一批较慢的任务后 join，任务应全部完成
+static bool testThreadPoolJoin()
+{
+    std::atomic<int> done(0);
+    {
+        ThreadPool pool(4);
+        for (int i = 0; i < 32; ++i) {
+            pool.addTask([&done] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                done.fetch_add(1);
+            });
+        }
+        pool.join();
+    }
+
+    bool ok = done.load() == 32;
+    printf("[threadpool] join waits for queued tasks: %s\n", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+
+// 模拟 Reactor 与连接：onRead_ 即线程池要执行的操作
+struct fakeConn {
+    int fd;
+};
+
+struct fakeReactor {
+    void onRead_(fakeConn* client) {
+        if (client->fd >= 0) {
+            done.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<long> done{ 0 };
+};
+
+
+// 用 submit 提交 n 个任务 并等待全部完成，返回其间的分配次数；未完成任务数不超过 256，预热后任务队列不再扩容
+template<class Submit>
+static long countAllocs(ThreadPool& pool, fakeReactor& r, long n, Submit submit)
+{
+    long before = allocCount.load();
+    long target = r.done.load() + n;
+    for (long i = 0; i < n; ++i) {
+        while (target - n + i - r.done.load(std::memory_order_relaxed) >= 256) {
+            std::this_thread::yield();
+        }
+        submit();
+    }
+    while (r.done.load() < target) {
+        std::this_thread::yield();
+    }
+    return allocCount.load() - before;
+}
+
+
+// Reactor 的三种任务：成员函数快速路径（dealRead_/dealWrite_）、std::bind、捕获 this 与 unique_ptr 的 lambda（verifyAsync_）
+static bool testTaskNoAlloc()
+{
+    ThreadPool pool(4);
+    fakeReactor r;
+    fakeConn client = { 5 };
+    const long TASKS = 20000;
+
+    auto member = [&] { pool.addTask(&r, &fakeReactor::onRead_, &client); };
+    auto bound = [&] { pool.addTask(std::bind(&fakeReactor::onRead_, &r, &client)); };
+    std::unique_ptr<fakeConn> owned(new fakeConn{ 7 });
+    auto lambda = [&] {
+        pool.addTask([&r, conn = owned.get(), job = std::unique_ptr<int>()]() mutable {
+            r.onRead_(conn);
+        });
+    };
+
+    countAllocs(pool, r, TASKS, member);        // 预热：任务队列扩容到稳定大小
+
+    long allocs[3] = {
+        countAllocs(pool, r, TASKS, member),
+        countAllocs(pool, r, TASKS, bound),
+        countAllocs(pool, r, TASKS, lambda),
+    };
+    bool ok = allocs[0] == 0 && allocs[1] == 0 && allocs[2] == 0;
+    if (!ok) {
+        printf("[task] allocations: member %ld, bind %ld, lambda %ld\n", allocs[0], allocs[1], allocs[2]);
+    }
+    printf("[task] steady-state dispatch is allocation-free: %s\n", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+
+int main()
+{
+    bool ok = testTaskNoAlloc();
+    ok = testUserCacheOrder() && ok;
+    ok = testThreadPoolJoin() && ok;
+    ok = testFdReuse(0, REACTOR_NUM) && ok;
+    ok = testFdReuse(0, 1) && ok;
+    if (IoUring::isSupported()) {
+        ok = testFdReuse(1, REACTOR_NUM) && ok;
+    }
+    else {
+        printf("[io_uring] not supported, skipped\n");
+    }
+
+    return ok ? 0 : 1;
+}